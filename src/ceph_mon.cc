@@ -807,6 +807,8 @@ int main(int argc, const char **argv)
     exit(1);
   msgr->set_cluster_protocol(CEPH_MON_PROTOCOL);
   msgr->set_default_send_priority(CEPH_MSG_PRIO_HIGH);
+  msgr->set_dispatch_threads(
+    g_conf().get_val<uint64_t>("mon_dispatch_threads"));
 
   msgr->set_default_policy(Messenger::Policy::stateless_server(0));
   msgr->set_policy(entity_name_t::TYPE_MON,
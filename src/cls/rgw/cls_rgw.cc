@@ -705,6 +705,37 @@ static int write_bucket_header(cls_method_context_t hctx, rgw_bucket_dir_header
   return cls_cxx_map_write_header(hctx, &header_bl);
 }
 
+/*
+ * Ops that change the index without a log_op flag still have to reach the
+ * bilog while an online reshard replays it into the new index.  Replay only
+ * looks at the object name; the entry is logged as a completed cancel,
+ * which bucket sync skips, so other zones don't sync the object again.
+ */
+static int log_reshard_change(cls_method_context_t hctx, const string& name)
+{
+  rgw_bucket_dir_header header;
+  int ret = read_bucket_header(hctx, &header);
+  if (ret < 0) {
+    CLS_LOG(1, "ERROR: %s(): failed to read header", __func__);
+    return ret;
+  }
+  if (!header.resharding_in_logrecord()) {
+    return 0;
+  }
+
+  cls_rgw_obj_key key(name);
+  string tag;
+  real_time mtime = real_clock::now();
+  rgw_bucket_entry_ver ver;
+  ret = log_index_operation(hctx, key, CLS_RGW_OP_CANCEL, tag, mtime, ver,
+                            CLS_RGW_STATE_COMPLETE, header.ver,
+                            header.max_marker, 0, NULL, NULL, NULL);
+  if (ret < 0) {
+    return ret;
+  }
+  return write_bucket_header(hctx, &header); /* updates header version */
+}
+
 
 int rgw_bucket_rebuild_index(cls_method_context_t hctx, bufferlist *in, bufferlist *out)
 {
@@ -945,28 +976,20 @@ static int read_key_entry(cls_method_context_t hctx, cls_rgw_obj_key& key,
   return 0;
 }
 
-int rgw_bucket_complete_op(cls_method_context_t hctx, bufferlist *in, bufferlist *out)
+/*
+ * apply a complete op to the index entry and the in-memory header. sets
+ * header_changed if the caller needs to write the header back
+ */
+static int complete_op(cls_method_context_t hctx, rgw_bucket_dir_header& header,
+                       rgw_cls_obj_complete_op& op, bool *header_changed)
 {
-  // decode request
-  rgw_cls_obj_complete_op op;
-  auto iter = in->cbegin();
-  try {
-    decode(op, iter);
-  } catch (ceph::buffer::error& err) {
-    CLS_LOG(1, "ERROR: rgw_bucket_complete_op(): failed to decode request\n");
-    return -EINVAL;
-  }
   CLS_LOG(1, "rgw_bucket_complete_op(): request: op=%d name=%s instance=%s ver=%lu:%llu tag=%s\n",
           op.op, op.key.name.c_str(), op.key.instance.c_str(),
           (unsigned long)op.ver.pool, (unsigned long long)op.ver.epoch,
           op.tag.c_str());
 
-  rgw_bucket_dir_header header;
-  int rc = read_bucket_header(hctx, &header);
-  if (rc < 0) {
-    CLS_LOG(1, "ERROR: rgw_bucket_complete_op(): failed to read header\n");
-    return -EINVAL;
-  }
+  *header_changed = false;
+  int rc;
 
   rgw_bucket_dir_entry entry;
   bool ondisk = true;
@@ -1019,6 +1042,7 @@ int rgw_bucket_complete_op(cls_method_context_t hctx, bufferlist *in, bufferlist
     return 0;
   }
 
+  *header_changed = true;
   if (entry.exists) {
     unaccount_entry(header, entry);
   }
@@ -1065,7 +1089,7 @@ int rgw_bucket_complete_op(cls_method_context_t hctx, bufferlist *in, bufferlist
     break;
   }
 
-  if (op.log_op && !header.syncstopped) {
+  if (header.log_op_required(op.log_op)) {
     rc = log_index_operation(hctx, op.key, op.op, op.tag, entry.meta.mtime, entry.ver,
                              CLS_RGW_STATE_COMPLETE, header.ver, header.max_marker, op.bilog_flags, NULL, NULL, &op.zones_trace);
     if (rc < 0)
@@ -1092,7 +1116,7 @@ int rgw_bucket_complete_op(cls_method_context_t hctx, bufferlist *in, bufferlist
 	    int(remove_entry.meta.category));
     unaccount_entry(header, remove_entry);
 
-    if (op.log_op && !header.syncstopped) {
+    if (header.log_op_required(op.log_op)) {
       ++header.ver; // increment index version, or we'll overwrite keys previously written
       rc = log_index_operation(hctx, remove_key, CLS_RGW_OP_DEL, op.tag, remove_entry.meta.mtime,
                                remove_entry.ver, CLS_RGW_STATE_COMPLETE, header.ver, header.max_marker, op.bilog_flags, NULL, NULL, &op.zones_trace);
@@ -1107,6 +1131,98 @@ int rgw_bucket_complete_op(cls_method_context_t hctx, bufferlist *in, bufferlist
     }
   }
 
+  return 0;
+}
+
+int rgw_bucket_complete_op(cls_method_context_t hctx, bufferlist *in, bufferlist *out)
+{
+  // decode request
+  rgw_cls_obj_complete_op op;
+  auto iter = in->cbegin();
+  try {
+    decode(op, iter);
+  } catch (ceph::buffer::error& err) {
+    CLS_LOG(1, "ERROR: rgw_bucket_complete_op(): failed to decode request\n");
+    return -EINVAL;
+  }
+
+  rgw_bucket_dir_header header;
+  int rc = read_bucket_header(hctx, &header);
+  if (rc < 0) {
+    CLS_LOG(1, "ERROR: rgw_bucket_complete_op(): failed to read header\n");
+    return -EINVAL;
+  }
+
+  bool header_changed;
+  rc = complete_op(hctx, header, op, &header_changed);
+  if (rc < 0 || !header_changed) {
+    return rc;
+  }
+  return write_bucket_header(hctx, &header);
+}
+
+int rgw_bucket_complete_ops(cls_method_context_t hctx, bufferlist *in, bufferlist *out)
+{
+  // decode request
+  rgw_cls_obj_complete_ops ops;
+  auto iter = in->cbegin();
+  try {
+    decode(ops, iter);
+  } catch (ceph::buffer::error& err) {
+    CLS_LOG(1, "ERROR: rgw_bucket_complete_ops(): failed to decode request\n");
+    return -EINVAL;
+  }
+
+  /* omap reads in a cls method see the stored values, not the writes made
+   * earlier in the same method, so an op on an object that an earlier op
+   * in the batch already touched would work from a stale entry */
+  std::set<string> names;
+  for (const auto& op : ops.ops) {
+    std::set<string> op_names{op.key.name};
+    for (const auto& key : op.remove_objs) {
+      op_names.insert(key.name);
+    }
+    for (const auto& name : op_names) {
+      if (!names.insert(name).second) {
+        CLS_LOG(1, "ERROR: rgw_bucket_complete_ops(): more than one op on name=%s\n",
+                name.c_str());
+        return -EINVAL;
+      }
+    }
+  }
+
+  rgw_bucket_dir_header header;
+  int rc = read_bucket_header(hctx, &header);
+  if (rc < 0) {
+    CLS_LOG(1, "ERROR: rgw_bucket_complete_ops(): failed to read header\n");
+    return -EINVAL;
+  }
+
+  // read and write the header once for the whole batch
+  bool write_header = false;
+  bool header_changed = false;
+  for (auto& op : ops.ops) {
+    if (header_changed) {
+      // same index version as if the previous op had written the header
+      header.ver++;
+    }
+    header_changed = false;
+    rc = complete_op(hctx, header, op, &header_changed);
+    if (rc == -EINVAL || rc == -ENOENT) {
+      /* the op was rejected before it changed anything, which only fails
+       * the op itself when it's sent on its own */
+      CLS_LOG(1, "rgw_bucket_complete_ops(): skipping op on name=%s instance=%s, rc=%d\n",
+              op.key.name.c_str(), op.key.instance.c_str(), rc);
+      continue;
+    }
+    if (rc < 0) {
+      return rc;
+    }
+    write_header = write_header || header_changed;
+  }
+  if (!write_header) {
+    return 0;
+  }
   return write_bucket_header(hctx, &header);
 }
 
@@ -1680,17 +1796,13 @@ static int rgw_bucket_link_olh(cls_method_context_t hctx, bufferlist *in, buffer
     return ret;
   }
 
-  if (!op.log_op) {
-   return 0;
-  }
-
   rgw_bucket_dir_header header;
   ret = read_bucket_header(hctx, &header);
   if (ret < 0) {
     CLS_LOG(1, "ERROR: rgw_bucket_link_olh(): failed to read header\n");
     return ret;
   }
-  if (header.syncstopped) {
+  if (!header.log_op_required(op.log_op)) {
     return 0;
   }
 
@@ -1845,17 +1957,13 @@ static int rgw_bucket_unlink_instance(cls_method_context_t hctx, bufferlist *in,
     return ret;
   }
 
-  if (!op.log_op) {
-    return 0;
-  }
-
   rgw_bucket_dir_header header;
   ret = read_bucket_header(hctx, &header);
   if (ret < 0) {
     CLS_LOG(1, "ERROR: rgw_bucket_unlink_instance(): failed to read header\n");
     return ret;
   }
-  if (header.syncstopped) {
+  if (!header.log_op_required(op.log_op)) {
     return 0;
   }
 
@@ -1975,7 +2083,7 @@ static int rgw_bucket_trim_olh_log(cls_method_context_t hctx, bufferlist *in, bu
     return ret;
   }
 
-  return 0;
+  return log_reshard_change(hctx, op.olh.name);
 }
 
 static int rgw_bucket_clear_olh(cls_method_context_t hctx, bufferlist *in, bufferlist *out)
@@ -2016,6 +2124,11 @@ static int rgw_bucket_clear_olh(cls_method_context_t hctx, bufferlist *in, buffe
     return ret;
   }
 
+  ret = log_reshard_change(hctx, op.key.name);
+  if (ret < 0) {
+    return ret;
+  }
+
   rgw_bucket_dir_entry plain_entry;
 
   /* read plain entry, make sure it's a versioned place holder */
@@ -2129,7 +2242,7 @@ int rgw_dir_suggest_changes(cls_method_context_t hctx,
 	ret = cls_cxx_map_remove_key(hctx, cur_change_key);
 	if (ret < 0)
 	  return ret;
-        if (log_op && cur_disk.exists && !header.syncstopped) {
+        if (cur_disk.exists && header.log_op_required(log_op)) {
           ret = log_index_operation(hctx, cur_disk.key, CLS_RGW_OP_DEL, cur_disk.tag, cur_disk.meta.mtime,
                                     cur_disk.ver, CLS_RGW_STATE_COMPLETE, header.ver, header.max_marker, 0, NULL, NULL, NULL);
           if (ret < 0) {
@@ -2153,7 +2266,7 @@ int rgw_dir_suggest_changes(cls_method_context_t hctx,
         ret = cls_cxx_map_set_val(hctx, cur_change_key, &cur_state_bl);
         if (ret < 0)
 	  return ret;
-        if (log_op && !header.syncstopped) {
+        if (header.log_op_required(log_op)) {
           ret = log_index_operation(hctx, cur_change.key, CLS_RGW_OP_ADD, cur_change.tag, cur_change.meta.mtime,
                                     cur_change.ver, CLS_RGW_STATE_COMPLETE, header.ver, header.max_marker, 0, NULL, NULL, NULL);
           if (ret < 0) {
@@ -2440,9 +2553,23 @@ static int rgw_bi_put_op(cls_method_context_t hctx, bufferlist *in, bufferlist *
   int r = cls_cxx_map_set_val(hctx, entry.idx, &entry.data);
   if (r < 0) {
     CLS_LOG(0, "ERROR: %s(): cls_cxx_map_set_val() returned r=%d", __func__, r);
+    return 0;
   }
 
-  return 0;
+  cls_rgw_obj_key key;
+  RGWObjCategory category;
+  rgw_bucket_category_stats stats;
+  try {
+    entry.get_info(&key, &category, &stats);
+  } catch (ceph::buffer::error& err) {
+    // not an entry reshard could copy either
+    CLS_LOG(0, "ERROR: %s(): failed to decode entry %s", __func__, entry.idx.c_str());
+    return 0;
+  }
+  if (key.name.empty()) {
+    return 0;
+  }
+  return log_reshard_change(hctx, key.name);
 }
 
 static int list_plain_entries(cls_method_context_t hctx,
@@ -4069,7 +4196,8 @@ static int rgw_guard_bucket_resharding(cls_method_context_t hctx, bufferlist *in
     return rc;
   }
 
-  if (header.resharding()) {
+  // writes may continue while the new index is built from the bilog
+  if (header.resharding() && !header.resharding_in_logrecord()) {
     return op.ret_err;
   }
 
@@ -4117,6 +4245,7 @@ CLS_INIT(rgw)
   cls_method_handle_t h_rgw_bucket_update_stats;
   cls_method_handle_t h_rgw_bucket_prepare_op;
   cls_method_handle_t h_rgw_bucket_complete_op;
+  cls_method_handle_t h_rgw_bucket_complete_ops;
   cls_method_handle_t h_rgw_bucket_link_olh;
   cls_method_handle_t h_rgw_bucket_unlink_instance_op;
   cls_method_handle_t h_rgw_bucket_read_olh_log;
@@ -4167,6 +4296,7 @@ CLS_INIT(rgw)
   cls_register_cxx_method(h_class, RGW_BUCKET_UPDATE_STATS, CLS_METHOD_RD | CLS_METHOD_WR, rgw_bucket_update_stats, &h_rgw_bucket_update_stats);
   cls_register_cxx_method(h_class, RGW_BUCKET_PREPARE_OP, CLS_METHOD_RD | CLS_METHOD_WR, rgw_bucket_prepare_op, &h_rgw_bucket_prepare_op);
   cls_register_cxx_method(h_class, RGW_BUCKET_COMPLETE_OP, CLS_METHOD_RD | CLS_METHOD_WR, rgw_bucket_complete_op, &h_rgw_bucket_complete_op);
+  cls_register_cxx_method(h_class, RGW_BUCKET_COMPLETE_OPS, CLS_METHOD_RD | CLS_METHOD_WR, rgw_bucket_complete_ops, &h_rgw_bucket_complete_ops);
   cls_register_cxx_method(h_class, RGW_BUCKET_LINK_OLH, CLS_METHOD_RD | CLS_METHOD_WR, rgw_bucket_link_olh, &h_rgw_bucket_link_olh);
   cls_register_cxx_method(h_class, RGW_BUCKET_UNLINK_INSTANCE, CLS_METHOD_RD | CLS_METHOD_WR, rgw_bucket_unlink_instance, &h_rgw_bucket_unlink_instance_op);
   cls_register_cxx_method(h_class, RGW_BUCKET_READ_OLH_LOG, CLS_METHOD_RD, rgw_bucket_read_olh_log, &h_rgw_bucket_read_olh_log);
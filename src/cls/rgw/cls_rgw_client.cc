@@ -215,6 +215,16 @@ void cls_rgw_bucket_complete_op(ObjectWriteOperation& o, RGWModifyOp op, string&
   o.exec(RGW_CLASS, RGW_BUCKET_COMPLETE_OP, in);
 }
 
+void cls_rgw_bucket_complete_ops(ObjectWriteOperation& o,
+                                 const std::vector<rgw_cls_obj_complete_op>& ops)
+{
+  bufferlist in;
+  rgw_cls_obj_complete_ops call;
+  call.ops = ops;
+  encode(call, in);
+  o.exec(RGW_CLASS, RGW_BUCKET_COMPLETE_OPS, in);
+}
+
 void cls_rgw_bucket_list_op(librados::ObjectReadOperation& op,
                             const cls_rgw_obj_key& start_obj,
                             const std::string& filter_prefix,
@@ -261,6 +271,15 @@ int CLSRGWIssueBucketList::issue_op(int shard_id, const string& oid)
 			      &result[shard_id]);
 }
 
+int CLSRGWIssueBucketListShards::issue_op(int shard_id, const string& oid)
+{
+  const auto& req = requests.at(shard_id);
+  return issue_bucket_list_op(io_ctx, oid,
+			      req.start_obj, filter_prefix, delimiter,
+			      req.num_entries, list_versions, &manager,
+			      &result[shard_id]);
+}
+
 void cls_rgw_remove_obj(librados::ObjectWriteOperation& o, list<string>& keep_attr_prefixes)
 {
   bufferlist in;
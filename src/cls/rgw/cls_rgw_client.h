@@ -368,6 +368,11 @@ void cls_rgw_bucket_complete_op(librados::ObjectWriteOperation& o, RGWModifyOp o
                                 rgw_bucket_dir_entry_meta& dir_meta,
 				std::list<cls_rgw_obj_key> *remove_objs, bool log_op,
                                 uint16_t bilog_op, rgw_zone_set *zones_trace);
+// apply several complete ops to the same index shard in one transaction.
+// no two ops may name the same object, either as their key or in their
+// remove_objs; such a batch fails with -EINVAL
+void cls_rgw_bucket_complete_ops(librados::ObjectWriteOperation& o,
+                                 const std::vector<rgw_cls_obj_complete_op>& ops);
 
 void cls_rgw_remove_obj(librados::ObjectWriteOperation& o, std::list<std::string>& keep_attr_prefixes);
 void cls_rgw_obj_store_pg_ver(librados::ObjectWriteOperation& o, const std::string& attr);
@@ -456,6 +461,42 @@ public:
   {}
 };
 
+/**
+ * Like CLSRGWIssueBucketList, but continues listing a subset of the bucket
+ * index shards, each from its own marker and with its own number of entries.
+ *
+ * requests      - the marker and number of entries for each shard, keyed by
+ *                 shard id; must have an entry for each shard in oids.
+*/
+class CLSRGWIssueBucketListShards : public CLSRGWConcurrentIO {
+public:
+  struct Request {
+    cls_rgw_obj_key start_obj;
+    uint32_t num_entries;
+  };
+private:
+  const std::map<int, Request>& requests;
+  std::string filter_prefix;
+  std::string delimiter;
+  bool list_versions;
+  std::map<int, rgw_cls_list_ret>& result;
+protected:
+  int issue_op(int shard_id, const std::string& oid) override;
+public:
+  CLSRGWIssueBucketListShards(librados::IoCtx& io_ctx,
+			      const std::map<int, Request>& _requests,
+			      const std::string& _filter_prefix,
+			      const std::string& _delimiter,
+			      bool _list_versions,
+			      std::map<int, std::string>& oids,
+			      std::map<int, rgw_cls_list_ret>& list_results,
+			      uint32_t max_aio) :
+  CLSRGWConcurrentIO(io_ctx, oids, max_aio),
+    requests(_requests), filter_prefix(_filter_prefix), delimiter(_delimiter),
+    list_versions(_list_versions), result(list_results)
+  {}
+};
+
 void cls_rgw_bucket_list_op(librados::ObjectReadOperation& op,
                             const cls_rgw_obj_key& start_obj,
                             const std::string& filter_prefix,
@@ -58,6 +58,52 @@ static __u32 crush_hash32_rjenkins1_3(__u32 a, __u32 b, __u32 c)
 	return hash;
 }
 
+#if defined(__GNUC__) && !defined(__KERNEL__)
+/*
+ * the mix function only uses add/sub/xor/shift, so the generic vector
+ * extension lets the compiler pick whatever SIMD width the target has
+ * (SSE2/AVX2/NEON) without any ISA specific code here.
+ */
+#define CRUSH_HASH_VEC_WIDTH 8
+typedef __u32 crush_u32_vec __attribute__((vector_size(CRUSH_HASH_VEC_WIDTH * sizeof(__u32))));
+
+static void crush_hash32_rjenkins1_3_vec(__u32 a, const __u32 *bv, __u32 c,
+					 __u32 *out, unsigned int n)
+{
+	const crush_u32_vec zero = {0};
+	unsigned int i = 0;
+
+	for (; i + CRUSH_HASH_VEC_WIDTH <= n; i += CRUSH_HASH_VEC_WIDTH) {
+		crush_u32_vec va = zero + a;
+		crush_u32_vec vb;
+		crush_u32_vec vc = zero + c;
+		crush_u32_vec x = zero + 231232;
+		crush_u32_vec y = zero + 1232;
+		crush_u32_vec hash;
+
+		memcpy(&vb, bv + i, sizeof(vb));
+		hash = (zero + crush_hash_seed) ^ va ^ vb ^ vc;
+		crush_hashmix(va, vb, hash);
+		crush_hashmix(vc, x, hash);
+		crush_hashmix(y, va, hash);
+		crush_hashmix(vb, x, hash);
+		crush_hashmix(y, vc, hash);
+		memcpy(out + i, &hash, sizeof(hash));
+	}
+	for (; i < n; i++)
+		out[i] = crush_hash32_rjenkins1_3(a, bv[i], c);
+}
+#else
+static void crush_hash32_rjenkins1_3_vec(__u32 a, const __u32 *bv, __u32 c,
+					 __u32 *out, unsigned int n)
+{
+	unsigned int i;
+
+	for (i = 0; i < n; i++)
+		out[i] = crush_hash32_rjenkins1_3(a, bv[i], c);
+}
+#endif
+
 static __u32 crush_hash32_rjenkins1_4(__u32 a, __u32 b, __u32 c, __u32 d)
 {
 	__u32 hash = crush_hash_seed ^ a ^ b ^ c ^ d;
@@ -120,6 +166,19 @@ __u32 crush_hash32_3(int type, __u32 a, __u32 b, __u32 c)
 	}
 }
 
+void crush_hash32_3_vec(int type, __u32 a, const __u32 *b, __u32 c,
+			__u32 *out, unsigned int n)
+{
+	switch (type) {
+	case CRUSH_HASH_RJENKINS1:
+		crush_hash32_rjenkins1_3_vec(a, b, c, out, n);
+		break;
+	default:
+		memset(out, 0, n * sizeof(*out));
+		break;
+	}
+}
+
 __u32 crush_hash32_4(int type, __u32 a, __u32 b, __u32 c, __u32 d)
 {
 	switch (type) {
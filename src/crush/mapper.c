@@ -330,11 +330,12 @@ static inline __s32 *get_choose_arg_ids(const struct crush_bucket_straw2 *bucket
  *
  * for reference, see the exponential distribution example at:  
  * https://en.wikipedia.org/wiki/Inverse_transform_sampling#Examples
+ *
+ * @u is crush_hash32_3(type, x, y, z) for the item being drawn.
  */
-static inline __s64 generate_exponential_distribution(int type, int x, int y, int z, 
+static inline __s64 generate_exponential_distribution(unsigned int u,
                                                       int weight)
 {
-	unsigned int u = crush_hash32_3(type, x, y, z);
 	u &= 0xffff;
 
 	/*
@@ -358,25 +359,44 @@ static inline __s64 generate_exponential_distribution(int type, int x, int y, in
 	return div64_s64(ln, weight);
 }
 
+/*
+ * number of item hashes computed per crush_hash32_3_vec() call.  only the
+ * hash is computed in runs: crush_ln() is three table lookups and the draw
+ * a 64-bit division per item, neither of which vectorizes, so both stay
+ * scalar.
+ */
+#define CRUSH_STRAW2_HASH_BATCH 64
+
 static int bucket_straw2_choose(const struct crush_bucket_straw2 *bucket,
 				int x, int r, const struct crush_choose_arg *arg,
                                 int position)
 {
 	unsigned int i, high = 0;
+	unsigned int base, n;
 	__s64 draw, high_draw = 0;
+	__u32 hashes[CRUSH_STRAW2_HASH_BATCH];
         __u32 *weights = get_choose_arg_weights(bucket, arg, position);
         __s32 *ids = get_choose_arg_ids(bucket, arg);
-	for (i = 0; i < bucket->h.size; i++) {
-                dprintk("weight 0x%x item %d\n", weights[i], ids[i]);
-		if (weights[i]) {
-			draw = generate_exponential_distribution(bucket->h.hash, x, ids[i], r, weights[i]);
-		} else {
-			draw = S64_MIN;
-		}
+	for (base = 0; base < bucket->h.size; base += n) {
+		/* hash a run of items at once so the hash can use SIMD */
+		n = bucket->h.size - base;
+		if (n > CRUSH_STRAW2_HASH_BATCH)
+			n = CRUSH_STRAW2_HASH_BATCH;
+		crush_hash32_3_vec(bucket->h.hash, x, (const __u32 *)ids + base,
+				   r, hashes, n);
+		for (i = base; i < base + n; i++) {
+			dprintk("weight 0x%x item %d\n", weights[i], ids[i]);
+			if (weights[i]) {
+				draw = generate_exponential_distribution(
+					hashes[i - base], weights[i]);
+			} else {
+				draw = S64_MIN;
+			}
 
-		if (i == 0 || draw > high_draw) {
-			high = i;
-			high_draw = draw;
+			if (i == 0 || draw > high_draw) {
+				high = i;
+				high_draw = draw;
+			}
 		}
 	}
 
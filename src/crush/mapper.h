@@ -60,6 +60,10 @@ extern int crush_find_rule(const struct crush_map *map, int ruleset, int type, i
  *         char __cwin__[crush_work_size(__map__, __result_max__)];
  *         crush_init_workspace(__map__, __cwin__);
  *
+ * To map many values, call this once per value with the same __cwin__.
+ * Each value takes its own retry and collision path through the rule,
+ * so there is no batched variant to share more than the workspace.
+ *
  * @param map the crush_map
  * @param ruleno a positive integer < __CRUSH_MAX_RULES__
  * @param x the value to map to __result_max__ items
@@ -27,6 +27,7 @@ namespace fs = std::experimental::filesystem;
 #include "rocksdb/merge_operator.h"
 
 #include "common/perf_counters.h"
+#include "common/strtol.h"
 #include "common/PriorityCache.h"
 #include "include/common_fwd.h"
 #include "include/scope_guard.h"
@@ -1209,6 +1210,18 @@ int RocksDBStore::_test_init(const string& dir)
   return status.ok() ? 0 : -EIO;
 }
 
+uint64_t RocksDBStore::get_delete_range_threshold(
+  CephContext *cct, const std::map<std::string,std::string>& opt)
+{
+  // the owner of the store may override the global default
+  if (auto p = opt.find("delete_range_threshold"); p != opt.end()) {
+    if (auto n = ceph::parse<uint64_t>(p->second); n) {
+      return *n;
+    }
+  }
+  return cct->_conf.get_val<uint64_t>("rocksdb_delete_range_threshold");
+}
+
 RocksDBStore::~RocksDBStore()
 {
   close();
@@ -177,6 +177,8 @@ private:
   void compact_range_async(const std::string& start, const std::string& end);
   int tryInterpret(const std::string& key, const std::string& val,
 		   rocksdb::Options& opt);
+  static uint64_t get_delete_range_threshold(
+    CephContext *cct, const std::map<std::string,std::string>& opt);
 
 public:
   /// compact the underlying rocksdb store
@@ -228,7 +230,7 @@ public:
     compact_thread(this),
     compact_on_mount(false),
     disableWAL(false),
-    delete_range_threshold(cct->_conf.get_val<uint64_t>("rocksdb_delete_range_threshold"))
+    delete_range_threshold(get_delete_range_threshold(c, opt))
   {}
 
   ~RocksDBStore() override;
@@ -7,12 +7,18 @@
 
 class MConfig : public Message {
 public:
-  static constexpr int HEAD_VERSION = 1;
+  static constexpr int HEAD_VERSION = 2;
   static constexpr int COMPAT_VERSION = 1;
 
   // use transparent comparator so we can lookup in it by std::string_view keys
   std::map<std::string,std::string,std::less<>> config;
 
+  // if set, config only holds the values added or changed since the previous
+  // MConfig on this session and removed names the ones no longer set.  only
+  // sent to clients that subscribed with CEPH_SUBSCRIBE_CONFIG_DIFF.
+  bool incremental = false;
+  std::set<std::string> removed;
+
   MConfig() : Message{MSG_CONFIG, HEAD_VERSION, COMPAT_VERSION} { }
   MConfig(const std::map<std::string,std::string,std::less<>>& c)
     : Message{MSG_CONFIG, HEAD_VERSION, COMPAT_VERSION},
@@ -21,22 +27,72 @@ public:
     : Message{MSG_CONFIG, HEAD_VERSION, COMPAT_VERSION},
       config{std::move(c)} {}
 
+  /// make this the diff that takes a client holding prev to cur
+  void set_diff(const std::map<std::string,std::string,std::less<>>& prev,
+		const std::map<std::string,std::string,std::less<>>& cur) {
+    incremental = true;
+    config.clear();
+    removed.clear();
+    auto p = prev.begin();
+    auto q = cur.begin();
+    while (p != prev.end() || q != cur.end()) {
+      if (q == cur.end() ||
+	  (p != prev.end() && p->first < q->first)) {
+	removed.insert(p->first);
+	++p;
+      } else if (p == prev.end() || q->first < p->first) {
+	config.insert(*q);
+	++q;
+      } else {
+	if (p->second != q->second) {
+	  config.insert(*q);
+	}
+	++p;
+	++q;
+      }
+    }
+  }
+
+  /// bring the full set a client holds up to date with this message
+  void apply(std::map<std::string,std::string,std::less<>> *full) const {
+    if (!incremental) {
+      *full = config;
+      return;
+    }
+    for (auto& name : removed) {
+      full->erase(name);
+    }
+    for (auto& [name, value] : config) {
+      (*full)[name] = value;
+    }
+  }
+
   std::string_view get_type_name() const override {
     return "config";
   }
   void print(std::ostream& o) const override {
-    o << "config(" << config.size() << " keys" << ")";
+    o << "config(" << config.size() << " keys";
+    if (incremental) {
+      o << " " << removed.size() << " removed, incremental";
+    }
+    o << ")";
   }
 
   void decode_payload() override {
     using ceph::decode;
     auto p = payload.cbegin();
     decode(config, p);
+    if (header.version >= 2) {
+      decode(incremental, p);
+      decode(removed, p);
+    }
   }
 
   void encode_payload(uint64_t) override {
     using ceph::encode;
     encode(config, payload);
+    encode(incremental, payload);
+    encode(removed, payload);
   }
 
 };
@@ -25,7 +25,7 @@
  */
 class MMgrConfigure : public Message {
 private:
-  static constexpr int HEAD_VERSION = 4;
+  static constexpr int HEAD_VERSION = 5;
   static constexpr int COMPAT_VERSION = 1;
 
 public:
@@ -34,6 +34,14 @@ public:
   // Default 0 means if unspecified will include all stats
   uint32_t stats_threshold = 0;
 
+  // Send every Nth MMgrReport with full perf counter values and only the
+  // changed counters in between.  0 (older mgrs) means always full.
+  uint32_t stats_full_sync_period = 0;
+
+  // Set when the mgr could not apply a delta report to its copy of the
+  // previous values; the next report must carry full values.
+  bool stats_resync = false;
+
   std::map<OSDPerfMetricQuery, OSDPerfMetricLimits> osd_perf_metric_queries;
 
   boost::optional<MetricConfigMessage> metric_config_message;
@@ -52,6 +60,10 @@ public:
     if (header.version >= 4) {
       decode(metric_config_message, p);
     }
+    if (header.version >= 5) {
+      decode(stats_full_sync_period, p);
+      decode(stats_resync, p);
+    }
   }
 
   void encode_payload(uint64_t features) override {
@@ -65,12 +77,16 @@ public:
       boost::optional<MetricConfigMessage> empty;
       encode(empty, payload);
     }
+    encode(stats_full_sync_period, payload);
+    encode(stats_resync, payload);
   }
 
   std::string_view get_type_name() const override { return "mgrconfigure"; }
   void print(std::ostream& out) const override {
     out << get_type_name() << "(period=" << stats_period
-			   << ", threshold=" << stats_threshold << ")";
+			   << ", threshold=" << stats_threshold
+			   << ", full_sync=" << stats_full_sync_period
+			   << (stats_resync ? ", resync" : "") << ")";
   }
 
 private:
@@ -77,9 +77,98 @@ public:
 };
 WRITE_CLASS_ENCODER(PerfCounterType)
 
+/// The last value reported for one declared perf counter
+struct PerfCounterValue
+{
+  uint64_t val = 0;
+  uint64_t avgcount = 0;
+  uint64_t avgcount2 = 0;
+};
+
+/**
+ * A perf counter that changed since the previous report on the same
+ * session.  idx is the counter's position in the session's (sorted)
+ * declared set; the value fields are differences modulo 2^64.
+ */
+struct PerfCounterDelta
+{
+  uint32_t idx = 0;
+  bool avg = false;  ///< carries avgcount/avgcount2 (PERFCOUNTER_LONGRUNAVG)
+  uint64_t val = 0;
+  uint64_t avgcount = 0;
+  uint64_t avgcount2 = 0;
+};
+
+typedef std::vector<PerfCounterDelta> PerfCounterDeltas;
+
+// Indices are encoded as varint gaps from the previous entry, with the
+// avg flag in the low bit, and values as zigzag varints, so that a small
+// change to a large counter costs a couple of bytes in either direction.
+// Differences are modulo 2^64; zigzag maps the full range onto uint64_t,
+// so every value fits in a 10 byte varint.
+inline uint64_t perf_counter_delta_zigzag(uint64_t d) {
+  return (d << 1) ^ static_cast<uint64_t>(static_cast<int64_t>(d) >> 63);
+}
+inline uint64_t perf_counter_delta_unzigzag(uint64_t z) {
+  return (z >> 1) ^ (~(z & 1) + 1);
+}
+
+template<>
+struct denc_traits<PerfCounterDeltas> {
+  static constexpr bool supported = true;
+  static constexpr bool bounded = false;
+  static constexpr bool featured = false;
+  static constexpr bool need_contiguous = true;
+  static void bound_encode(const PerfCounterDeltas& v, size_t& p) {
+    p += sizeof(uint64_t) + 2;
+    // one gap and up to three 64-bit varints per entry
+    p += v.size() * 4 * (sizeof(uint64_t) + 2);
+  }
+  static void encode(const PerfCounterDeltas& v,
+		     ceph::buffer::list::contiguous_appender& p) {
+    denc_varint(v.size(), p);
+    uint64_t last = 0;
+    for (const auto& d : v) {
+      denc_varint(((d.idx - last) << 1) | (d.avg ? 1 : 0), p);
+      last = d.idx;
+      denc_varint(perf_counter_delta_zigzag(d.val), p);
+      if (d.avg) {
+	denc_varint(perf_counter_delta_zigzag(d.avgcount), p);
+	denc_varint(perf_counter_delta_zigzag(d.avgcount2), p);
+      }
+    }
+  }
+  static void decode(PerfCounterDeltas& v,
+		     ceph::buffer::ptr::const_iterator& p) {
+    uint64_t num;
+    denc_varint(num, p);
+    v.clear();
+    v.reserve(num);
+    uint64_t last = 0;
+    for (uint64_t i = 0; i < num; ++i) {
+      PerfCounterDelta d;
+      uint64_t gap;
+      denc_varint(gap, p);
+      last += gap >> 1;
+      d.idx = last;
+      d.avg = gap & 1;
+      uint64_t z;
+      denc_varint(z, p);
+      d.val = perf_counter_delta_unzigzag(z);
+      if (d.avg) {
+	denc_varint(z, p);
+	d.avgcount = perf_counter_delta_unzigzag(z);
+	denc_varint(z, p);
+	d.avgcount2 = perf_counter_delta_unzigzag(z);
+      }
+      v.push_back(d);
+    }
+  }
+};
+
 class MMgrReport : public Message {
 private:
-  static constexpr int HEAD_VERSION = 9;
+  static constexpr int HEAD_VERSION = 10;
   static constexpr int COMPAT_VERSION = 1;
 
 public:
@@ -99,6 +188,18 @@ public:
   // the next bytes from the ceph::buffer::list.
   ceph::buffer::list packed;
 
+  // If set, packed carries PerfCounterDeltas against the report numbered
+  // delta_base_seq on this session instead of every declared value.  Only
+  // sent to a mgr that asked for it via
+  // MMgrConfigure::stats_full_sync_period.
+  bool packed_delta = false;
+
+  // Position of this report on the session (starting at 1), and for delta
+  // reports the position of the report the deltas apply to.  A mgr whose
+  // last applied report differs asks for a full report instead.
+  uint64_t stats_seq = 0;
+  uint64_t delta_base_seq = 0;
+
   std::string daemon_name;
   std::string service_name;  // optional; otherwise infer from entity type
 
@@ -143,6 +244,11 @@ public:
     if (header.version >= 9) {
       decode(metric_report_message, p);
     }
+    if (header.version >= 10) {
+      decode(packed_delta, p);
+      decode(stats_seq, p);
+      decode(delta_base_seq, p);
+    }
   }
 
   void encode_payload(uint64_t features) override {
@@ -163,6 +269,9 @@ public:
       boost::optional<MetricReportMessage> empty;
       encode(empty, payload);
     }
+    encode(packed_delta, payload);
+    encode(stats_seq, payload);
+    encode(delta_base_seq, payload);
   }
 
   std::string_view get_type_name() const override { return "mgrreport"; }
@@ -176,7 +285,7 @@ public:
     out << "." << daemon_name
 	<< " +" << declare_types.size()
 	<< "-" << undeclare_types.size()
-        << " packed " << packed.length();
+        << (packed_delta ? " delta " : " packed ") << packed.length();
     if (daemon_status) {
       out << " status=" << daemon_status->size();
     }
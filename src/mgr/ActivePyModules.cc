@@ -27,6 +27,7 @@
 // For ::mgr_store_prefix
 #include "PyModule.h"
 #include "PyModuleRegistry.h"
+#include "PyOSDMap.h"
 #include "PyUtil.h"
 
 #include "ActivePyModules.h"
@@ -51,6 +52,10 @@ ActivePyModules::ActivePyModules(
   monc(mc), clog(clog_), audit_clog(audit_clog_), objecter(objecter_),
   client(client_), finisher(f),
   cmd_finisher(g_ceph_context, "cmd_finisher", "cmdfin"),
+  upmap_tp(g_ceph_context, "calc_pg_upmaps_tp", "upmap_tp",
+	   g_conf().get_val<uint64_t>("osd_calc_pg_upmaps_threads"),
+	   "osd_calc_pg_upmaps_threads"),
+  upmap_mapper(g_ceph_context, &upmap_tp),
   server(server), py_module_registry(pmr)
 {
   store_cache = std::move(store_data);
@@ -59,6 +64,7 @@ ActivePyModules::ActivePyModules(
   have_local_config_map = mon_provides_kv_sub;
   _refresh_config_map();
   cmd_finisher.start();
+  upmap_tp.start();
 }
 
 ActivePyModules::~ActivePyModules() = default;
@@ -72,8 +78,9 @@ void ActivePyModules::dump_server(const std::string &hostname,
   std::string ceph_version;
 
   for (const auto &[key, state] : dmc) {
-    without_gil([&ceph_version, state=state] {
-      std::lock_guard l(state->lock);
+    without_gil([this, &ceph_version, state=state] {
+      auto l = daemon_state.lock_daemon(*state,
+					l_mgr_daemon_state_py_lock_wait);
       // TODO: pick the highest version, and make sure that
       // somewhere else (during health reporting?) we are
       // indicating to the user if we see mixed versions
@@ -132,12 +139,14 @@ PyObject *ActivePyModules::get_metadata_python(
     derr << "Requested missing service " << svc_type << "." << svc_id << dendl;
     Py_RETURN_NONE;
   }
-  auto l = without_gil([&] {
-    return std::lock_guard(lock);
+  auto [hostname, daemon_metadata] = without_gil([&] {
+    auto l = daemon_state.lock_daemon(*metadata,
+				      l_mgr_daemon_state_py_lock_wait);
+    return std::make_pair(metadata->hostname, metadata->metadata);
   });
   PyFormatter f;
-  f.dump_string("hostname", metadata->hostname);
-  for (const auto &[key, val] : metadata->metadata) {
+  f.dump_string("hostname", hostname);
+  for (const auto &[key, val] : daemon_metadata) {
     f.dump_string(key, val);
   }
 
@@ -153,11 +162,13 @@ PyObject *ActivePyModules::get_daemon_status_python(
     derr << "Requested missing service " << svc_type << "." << svc_id << dendl;
     Py_RETURN_NONE;
   }
-  auto l = without_gil([&] {
-    return std::lock_guard(lock);
+  auto service_status = without_gil([&] {
+    auto l = daemon_state.lock_daemon(*metadata,
+				      l_mgr_daemon_state_py_lock_wait);
+    return metadata->service_status;
   });
   PyFormatter f;
-  for (const auto &[daemon, status] : metadata->service_status) {
+  for (const auto &[daemon, status] : service_status) {
     f.dump_string(daemon, status);
   }
   return f.get();
@@ -202,7 +213,8 @@ PyObject *ActivePyModules::get_python(const std::string &what)
     auto all_daemons = daemon_state.get_all();
     set<string> names;
     for (auto& [key, daemon] : all_daemons) {
-      std::lock_guard l(daemon->lock);
+      auto l = daemon_state.lock_daemon(*daemon,
+					l_mgr_daemon_state_py_lock_wait);
       for (auto& [name, valmap] : daemon->config) {
 	names.insert(name);
       }
@@ -237,11 +249,16 @@ PyObject *ActivePyModules::get_python(const std::string &what)
   } else if (what == "osd_metadata") {
     auto dmc = daemon_state.get_by_service("osd");
     for (const auto &[key, state] : dmc) {
-      std::lock_guard l(state->lock);
-      with_gil(no_gil, [&f, &name=key.name, state=state] {
-        f.open_object_section(name.c_str());
-        f.dump_string("hostname", state->hostname);
-        for (const auto &[name, val] : state->metadata) {
+      // copy out so that the daemon isn't locked while we wait for the GIL
+      auto l = daemon_state.lock_daemon(*state,
+					l_mgr_daemon_state_py_lock_wait);
+      auto hostname = state->hostname;
+      auto metadata = state->metadata;
+      l.unlock();
+      with_gil(no_gil, [&] {
+        f.open_object_section(key.name.c_str());
+        f.dump_string("hostname", hostname);
+        for (const auto &[name, val] : metadata) {
           f.dump_string(name.c_str(), val);
         }
         f.close_section();
@@ -251,11 +268,16 @@ PyObject *ActivePyModules::get_python(const std::string &what)
   } else if (what == "mds_metadata") {
     auto dmc = daemon_state.get_by_service("mds");
     for (const auto &[key, state] : dmc) {
-      std::lock_guard l(state->lock);
-      with_gil(no_gil, [&f, &name=key.name, state=state] {
-        f.open_object_section(name.c_str());
-        f.dump_string("hostname", state->hostname);
-        for (const auto &[name, val] : state->metadata) {
+      // copy out so that the daemon isn't locked while we wait for the GIL
+      auto l = daemon_state.lock_daemon(*state,
+					l_mgr_daemon_state_py_lock_wait);
+      auto hostname = state->hostname;
+      auto metadata = state->metadata;
+      l.unlock();
+      with_gil(no_gil, [&] {
+        f.open_object_section(key.name.c_str());
+        f.dump_string("hostname", hostname);
+        for (const auto &[name, val] : metadata) {
           f.dump_string(name.c_str(), val);
         }
         f.close_section();
@@ -506,6 +528,9 @@ void ActivePyModules::shutdown()
   cmd_finisher.wait_for_empty();
   cmd_finisher.stop();
 
+  // no module is left to call calc_pg_upmaps()
+  upmap_tp.stop();
+
   modules.clear();
 }
 
@@ -827,13 +852,17 @@ PyObject* ActivePyModules::with_perf_counters(
   f.open_array_section(path);
   {
     without_gil_t no_gil;
-    std::lock_guard l(lock);
+    std::unique_lock l(lock);
     auto metadata = daemon_state.get(DaemonKey{svc_name, svc_id});
     if (metadata) {
-      std::lock_guard l2(metadata->lock);
+      auto l2 = daemon_state.lock_daemon(*metadata,
+					 l_mgr_daemon_state_py_lock_wait);
       if (metadata->perf_counters.instances.count(path)) {
         auto counter_instance = metadata->perf_counters.instances.at(path);
         auto counter_type = metadata->perf_counters.types.at(path);
+        // format from the copies, without holding up report processing
+        l2.unlock();
+        l.unlock();
         with_gil(no_gil, [&] {
           fct(counter_instance, counter_type, f);
         });
@@ -937,13 +966,26 @@ PyObject* ActivePyModules::get_perf_schema_python(
   });
   if (!daemons.empty()) {
     for (auto& [key, state] : daemons) {
-      std::lock_guard l(state->lock);
-      with_gil(no_gil, [&, key=ceph::to_string(key), state=state] {
+      std::vector<PerfCounterType> types;
+      {
+        auto l = daemon_state.lock_daemon(*state,
+					  l_mgr_daemon_state_py_lock_wait);
+        types.reserve(state->perf_counters.instances.size());
+        for (const auto& [counter_name, instance] :
+	       state->perf_counters.instances) {
+          auto t = state->perf_counters.types.find(counter_name);
+          if (t != state->perf_counters.types.end()) {
+            types.push_back(t->second);
+          } else {
+            types.emplace_back();
+            types.back().path = counter_name;
+          }
+        }
+      }
+      with_gil(no_gil, [&, key=ceph::to_string(key)] {
         f.open_object_section(key.c_str());
-        for (auto ctr_inst_iter : state->perf_counters.instances) {
-          const auto &counter_name = ctr_inst_iter.first;
-          f.open_object_section(counter_name.c_str());
-          auto type = state->perf_counters.types[counter_name];
+        for (const auto& type : types) {
+          f.open_object_section(type.path.c_str());
           f.dump_string("description", type.description);
           if (!type.nick.empty()) {
             f.dump_string("nick", type.nick);
@@ -1029,7 +1071,25 @@ PyObject *ActivePyModules::get_osdmap()
     });
     return newmap;
   });
-  return construct_with_capsule("mgr_module", "OSDMap", (void*)newmap);
+  auto osdmap = construct_with_capsule("mgr_module", "OSDMap", (void*)newmap);
+  set_osdmap_upmap_mapper(osdmap, get_upmap_mapper());
+  return osdmap;
+}
+
+ParallelPGMapper *ActivePyModules::get_upmap_mapper()
+{
+  if (g_conf().get_val<uint64_t>("osd_calc_pg_upmaps_threads") <= 1) {
+    return nullptr;
+  }
+  return &upmap_mapper;
+}
+
+PyObject *ActivePyModules::get_pgmap()
+{
+  auto snapshot = without_gil([&] {
+    return cluster_state.get_pgmap_snapshot();
+  });
+  return construct_with_capsule("mgr_module", "PGMap", (void*)&snapshot);
 }
 
 PyObject *ActivePyModules::get_foreign_config(
@@ -16,6 +16,7 @@
 #include "ActivePyModule.h"
 
 #include "common/Finisher.h"
+#include "common/WorkQueue.h"
 #include "common/ceph_mutex.h"
 
 #include "PyFormatter.h"
@@ -27,6 +28,7 @@
 #include "mon/MonCommand.h"
 #include "mon/mon_types.h"
 #include "mon/ConfigMap.h"
+#include "osd/OSDMapMapping.h"
 
 #include "DaemonState.h"
 #include "ClusterState.h"
@@ -58,6 +60,10 @@ class ActivePyModules
 public:
   Finisher cmd_finisher;
 private:
+  // runs OSDMap::calc_pg_upmaps() for the python OSDMap wrappers; sized
+  // by osd_calc_pg_upmaps_threads
+  ThreadPool upmap_tp;
+  ParallelPGMapper upmap_mapper;
   DaemonServer &server;
   PyModuleRegistry &py_module_registry;
 
@@ -100,6 +106,9 @@ public:
      const std::string &svc_id);
   PyObject *get_context();
   PyObject *get_osdmap();
+  /// nullptr while osd_calc_pg_upmaps_threads is 1
+  ParallelPGMapper *get_upmap_mapper();
+  PyObject *get_pgmap();
   /// @note @c fct is not allowed to acquire locks when holding GIL
   PyObject *with_perf_counters(
       std::function<void(
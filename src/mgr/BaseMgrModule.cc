@@ -674,6 +674,12 @@ ceph_get_osdmap(BaseMgrModule *self, PyObject *args)
   return self->py_modules->get_osdmap();
 }
 
+static PyObject *
+ceph_get_pgmap(BaseMgrModule *self, PyObject *args)
+{
+  return self->py_modules->get_pgmap();
+}
+
 static PyObject*
 ceph_set_uri(BaseMgrModule *self, PyObject *args)
 {
@@ -1467,6 +1473,9 @@ PyMethodDef BaseMgrModule_methods[] = {
   {"_ceph_get_osdmap", (PyCFunction)ceph_get_osdmap, METH_NOARGS,
     "Get an OSDMap* in a python capsule"},
 
+  {"_ceph_get_pgmap", (PyCFunction)ceph_get_pgmap, METH_NOARGS,
+    "Get a read-only view of the current PGMap"},
+
   {"_ceph_set_uri", (PyCFunction)ceph_set_uri, METH_VARARGS,
     "Advertize a service URI served by this module"},
 
@@ -127,6 +127,16 @@ void ClusterState::ingest_pgstats(ref_t<MPGStats> stats)
   }
 }
 
+std::shared_ptr<const PGMap> ClusterState::get_pgmap_snapshot() const
+{
+  std::lock_guard l(lock);
+  if (!pg_map_snapshot ||
+      pg_map_snapshot->get_version() != pg_map.get_version()) {
+    pg_map_snapshot = std::make_shared<const PGMap>(pg_map);
+  }
+  return pg_map_snapshot;
+}
+
 void ClusterState::update_delta_stats()
 {
   pending_inc.stamp = ceph_clock_now();
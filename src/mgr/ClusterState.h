@@ -46,6 +46,8 @@ protected:
   map<int64_t,unsigned> existing_pools; ///< pools that exist, and pg_num, as of PGMap epoch
   PGMap pg_map;
   PGMap::Incremental pending_inc;
+  /// copy of pg_map handed out to python modules, see get_pgmap_snapshot()
+  mutable std::shared_ptr<const PGMap> pg_map_snapshot;
 
   bufferlist health_json;
   bufferlist mon_status_json;
@@ -102,6 +104,15 @@ public:
     return std::forward<Callback>(cb)(pg_map, std::forward<Args>(args)...);
   }
 
+  /**
+   * get an immutable copy of the current pg_map
+   *
+   * The copy is made at most once per PGMap version and shared by every
+   * caller until the next update, so readers never hold our lock while
+   * they walk it.
+   */
+  std::shared_ptr<const PGMap> get_pgmap_snapshot() const;
+
   template<typename Callback, typename...Args>
   auto with_mutable_pgmap(Callback&& cb, Args&&...args) ->
     decltype(cb(pg_map, std::forward<Args>(args)...))
@@ -314,6 +314,7 @@ void DaemonServer::maybe_ready(int32_t osd_id)
 void DaemonServer::tick()
 {
   dout(10) << dendl;
+  daemon_state.publish();
   send_report();
   adjust_pgs();
 
@@ -632,9 +633,19 @@ bool DaemonServer::handle_report(const ref_t<MMgrReport>& m)
     // Update the DaemonState
     ceph_assert(daemon != nullptr);
     {
-      std::lock_guard l(daemon->lock);
+      auto l = daemon_state.lock_daemon(*daemon,
+					l_mgr_daemon_state_report_lock_wait);
       auto &daemon_counters = daemon->perf_counters;
-      daemon_counters.update(*m.get());
+      if (!daemon_counters.update(*m.get())) {
+        // Ask for full values once; further deltas are dropped until
+        // the full report arrives.
+        auto priv = m->get_connection()->get_priv();
+        auto session = static_cast<MgrSession*>(priv.get());
+        if (session && !session->resync_requested) {
+          session->resync_requested = true;
+          _send_configure(m->get_connection(), true);
+        }
+      }
 
       auto p = m->config_bl.cbegin();
       if (p != m->config_bl.end()) {
@@ -2990,6 +3001,7 @@ const char** DaemonServer::get_tracked_conf_keys() const
   static const char *KEYS[] = {
     "mgr_stats_threshold",
     "mgr_stats_period",
+    "mgr_stats_full_sync_period",
     nullptr
   };
 
@@ -3000,7 +3012,8 @@ void DaemonServer::handle_conf_change(const ConfigProxy& conf,
 				      const std::set <std::string> &changed)
 {
 
-  if (changed.count("mgr_stats_threshold") || changed.count("mgr_stats_period")) {
+  if (changed.count("mgr_stats_threshold") || changed.count("mgr_stats_period") ||
+      changed.count("mgr_stats_full_sync_period")) {
     dout(4) << "Updating stats threshold/period on "
             << daemon_connections.size() << " clients" << dendl;
     // Send a fresh MMgrConfigure to all clients, so that they can follow
@@ -3014,13 +3027,16 @@ void DaemonServer::handle_conf_change(const ConfigProxy& conf,
   }
 }
 
-void DaemonServer::_send_configure(ConnectionRef c)
+void DaemonServer::_send_configure(ConnectionRef c, bool stats_resync)
 {
   ceph_assert(ceph_mutex_is_locked_by_me(lock));
 
   auto configure = make_message<MMgrConfigure>();
+  configure->stats_resync = stats_resync;
   configure->stats_period = g_conf().get_val<int64_t>("mgr_stats_period");
   configure->stats_threshold = g_conf().get_val<int64_t>("mgr_stats_threshold");
+  configure->stats_full_sync_period =
+    g_conf().get_val<uint64_t>("mgr_stats_full_sync_period");
 
   if (c->peer_is_osd()) {
     configure->osd_perf_metric_queries =
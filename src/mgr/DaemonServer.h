@@ -285,7 +285,7 @@ public:
   void got_mgr_map();
   void adjust_pgs();
 
-  void _send_configure(ConnectionRef c);
+  void _send_configure(ConnectionRef c, bool stats_resync = false);
 
   MetricQueryID add_osd_perf_query(
       const OSDPerfMetricQuery &query,
@@ -155,10 +155,79 @@ void DeviceState::print(ostream& out) const
   }
 }
 
-void DaemonStateIndex::insert(DaemonStatePtr dm)
+DaemonStateIndex::~DaemonStateIndex()
+{
+  if (logger) {
+    cct->get_perfcounters_collection()->remove(logger);
+    delete logger;
+  }
+}
+
+void DaemonStateIndex::init_perf_counters(CephContext *cct_)
+{
+  ceph_assert(!logger);
+  cct = cct_;
+  PerfCountersBuilder b(cct, "mgr_daemon_state",
+			l_mgr_daemon_state_first, l_mgr_daemon_state_last);
+  b.add_time_avg(l_mgr_daemon_state_report_lock_wait, "report_lock_wait",
+		 "Time report processing waited for daemon state locks");
+  b.add_time_avg(l_mgr_daemon_state_py_lock_wait, "py_lock_wait",
+		 "Time python module reads waited for daemon state locks");
+  b.add_time_avg(l_mgr_daemon_state_index_lock_wait, "index_lock_wait",
+		 "Time waited for the daemon index write lock");
+  b.add_u64_counter(l_mgr_daemon_state_index_publish, "index_publish",
+		    "Daemon index snapshots published after changes");
+  logger = b.create_perf_counters();
+  cct->get_perfcounters_collection()->add(logger);
+}
+
+std::unique_lock<ceph::mutex> DaemonStateIndex::lock_daemon(
+  DaemonState &state, int idx) const
 {
+  if (!logger) {
+    return std::unique_lock{state.lock};
+  }
+  const auto start = ceph::mono_clock::now();
+  std::unique_lock l{state.lock};
+  logger->tinc(idx, ceph::mono_clock::now() - start);
+  return l;
+}
+
+std::unique_lock<ceph::shared_mutex> DaemonStateIndex::_lock_for_write()
+{
+  if (!logger) {
+    return std::unique_lock{lock};
+  }
+  const auto start = ceph::mono_clock::now();
   std::unique_lock l{lock};
+  logger->tinc(l_mgr_daemon_state_index_lock_wait,
+	       ceph::mono_clock::now() - start);
+  return l;
+}
+
+void DaemonStateIndex::publish()
+{
+  if (!snapshot_stale.load(std::memory_order_acquire)) {
+    return;
+  }
+  std::shared_lock l{lock};
+  auto snap = std::make_shared<Snapshot>();
+  snap->all = all;
+  snap->by_server = by_server;
+  std::atomic_store(&snapshot, std::shared_ptr<const Snapshot>(std::move(snap)));
+  // writers are excluded until we drop the lock, so nothing can have
+  // changed since the copy
+  snapshot_stale.store(false, std::memory_order_release);
+  if (logger) {
+    logger->inc(l_mgr_daemon_state_index_publish);
+  }
+}
+
+void DaemonStateIndex::insert(DaemonStatePtr dm)
+{
+  auto l = _lock_for_write();
   _insert(dm);
+  _mark_stale();
 }
 
 void DaemonStateIndex::_insert(DaemonStatePtr dm)
@@ -218,54 +287,56 @@ void DaemonStateIndex::_erase(const DaemonKey& dmk)
 DaemonStateCollection DaemonStateIndex::get_by_service(
   const std::string& svc) const
 {
-  std::shared_lock l{lock};
-
-  DaemonStateCollection result;
+  return _read([&svc](auto& all, auto&) {
+    DaemonStateCollection result;
 
-  for (const auto& [key, state] : all) {
-    if (key.type == svc) {
-      result[key] = state;
+    for (auto p = all.lower_bound({svc, ""});
+	 p != all.end() && p->first.type == svc;
+	 ++p) {
+      result.insert(result.end(), *p);
     }
-  }
 
-  return result;
+    return result;
+  });
 }
 
 DaemonStateCollection DaemonStateIndex::get_by_server(
   const std::string &hostname) const
 {
-  std::shared_lock l{lock};
-
-  if (auto found = by_server.find(hostname); found != by_server.end()) {
-    return found->second;
-  } else {
-    return {};
-  }
+  return _read([&hostname](auto&, auto& by_server) {
+    if (auto found = by_server.find(hostname);
+	found != by_server.end()) {
+      return found->second;
+    } else {
+      return DaemonStateCollection{};
+    }
+  });
 }
 
 bool DaemonStateIndex::exists(const DaemonKey &key) const
 {
-  std::shared_lock l{lock};
-
-  return all.count(key) > 0;
+  return _read([&key](auto& all, auto&) {
+    return all.count(key) > 0;
+  });
 }
 
 DaemonStatePtr DaemonStateIndex::get(const DaemonKey &key)
 {
-  std::shared_lock l{lock};
-
-  auto iter = all.find(key);
-  if (iter != all.end()) {
-    return iter->second;
-  } else {
-    return nullptr;
-  }
+  return _read([&key](auto& all, auto&) {
+    auto iter = all.find(key);
+    if (iter != all.end()) {
+      return iter->second;
+    } else {
+      return DaemonStatePtr{};
+    }
+  });
 }
 
 void DaemonStateIndex::rm(const DaemonKey &key)
 {
-  std::unique_lock l{lock};
+  auto l = _lock_for_write();
   _rm(key);
+  _mark_stale();
 }
 
 void DaemonStateIndex::_rm(const DaemonKey &key)
@@ -280,7 +351,7 @@ void DaemonStateIndex::cull(const std::string& svc_name,
 {
   std::vector<string> victims;
 
-  std::unique_lock l{lock};
+  auto l = _lock_for_write();
   auto begin = all.lower_bound({svc_name, ""});
   auto end = all.end();
   for (auto &i = begin; i != end; ++i) {
@@ -297,13 +368,16 @@ void DaemonStateIndex::cull(const std::string& svc_name,
     dout(4) << "Removing data for " << daemon_key << dendl;
     _erase(daemon_key);
   }
+  if (!victims.empty()) {
+    _mark_stale();
+  }
 }
 
 void DaemonStateIndex::cull_services(const std::set<std::string>& types_exist)
 {
   std::set<DaemonKey> victims;
 
-  std::unique_lock l{lock};
+  auto l = _lock_for_write();
   for (auto it = all.begin(); it != all.end(); ++it) {
     const auto& daemon_key = it->first;
     if (it->second->service_daemon &&
@@ -316,19 +390,26 @@ void DaemonStateIndex::cull_services(const std::set<std::string>& types_exist)
     dout(4) << "Removing data for " << i << dendl;
     _erase(i);
   }
+  if (!victims.empty()) {
+    _mark_stale();
+  }
 }
 
-void DaemonPerfCounters::update(const MMgrReport& report)
+bool DaemonPerfCounters::update(const MMgrReport& report)
+{
+  // Retrieve session state
+  auto priv = report.get_connection()->get_priv();
+  return update(report, static_cast<MgrSession*>(priv.get()));
+}
+
+bool DaemonPerfCounters::update(const MMgrReport& report,
+				MgrSession *session)
 {
   dout(20) << "loading " << report.declare_types.size() << " new types, "
 	   << report.undeclare_types.size() << " old types, had "
 	   << types.size() << " types, got "
            << report.packed.length() << " bytes of data" << dendl;
 
-  // Retrieve session state
-  auto priv = report.get_connection()->get_priv();
-  auto session = static_cast<MgrSession*>(priv.get());
-
   // Load any newly declared types
   for (const auto &t : report.declare_types) {
     types.insert(std::make_pair(t.path, t));
@@ -340,10 +421,54 @@ void DaemonPerfCounters::update(const MMgrReport& report)
   }
 
   const auto now = ceph_clock_now();
+  auto &values = session->reported_values;
 
-  // Parse packed data according to declared set of types
   auto p = report.packed.cbegin();
   DECODE_START(1, p);
+  if (report.packed_delta) {
+    // Apply changed counters onto the previous report's values.  The
+    // client only sends deltas while its declared set is unchanged, and
+    // names the report they are relative to; if that is not the one we
+    // applied last, our values are not the client's baseline.
+    PerfCounterDeltas deltas;
+    decode(deltas, p);
+    if (report.delta_base_seq != session->reported_seq ||
+        !report.declare_types.empty() ||
+        !report.undeclare_types.empty() ||
+        values.size() != session->declared_types.size()) {
+      derr << "dropping delta report " << report.stats_seq << " from "
+           << report.daemon_name << " against report "
+           << report.delta_base_seq << " without a matching baseline (have "
+           << session->reported_seq << ", " << values.size()
+           << " values, " << session->declared_types.size()
+           << " declared)" << dendl;
+      values.clear();
+      session->reported_seq = 0;
+      return false;
+    }
+    for (const auto &d : deltas) {
+      if (d.idx >= values.size()) {
+        derr << "dropping delta report from " << report.daemon_name
+             << " with bad counter index " << d.idx << dendl;
+        values.clear();
+        session->reported_seq = 0;
+        return false;
+      }
+      auto &v = values[d.idx];
+      v.val += d.val;
+      v.avgcount += d.avgcount;
+      v.avgcount2 += d.avgcount2;
+    }
+    dout(20) << "applied " << deltas.size() << " changed counters" << dendl;
+  } else {
+    values.resize(session->declared_types.size());
+    session->resync_requested = false;
+  }
+  session->reported_seq = report.stats_seq;
+
+  // Push a data point for every declared counter, changed or not, so that
+  // the time series (and rates derived from them) stay evenly sampled.
+  size_t idx = 0;
   for (const auto &t_path : session->declared_types) {
     const auto &t = types.at(t_path);
     auto instances_it = instances.find(t_path);
@@ -353,20 +478,23 @@ void DaemonPerfCounters::update(const MMgrReport& report)
     if (instances_it == instances.end()) {
       instances_it = instances.insert({t_path, t.type}).first;
     }
-    uint64_t val = 0;
-    uint64_t avgcount = 0;
-    uint64_t avgcount2 = 0;
-
-    decode(val, p);
+    auto &v = values[idx++];
+    if (!report.packed_delta) {
+      // Parse packed data according to declared set of types
+      decode(v.val, p);
+      if (t.type & PERFCOUNTER_LONGRUNAVG) {
+        decode(v.avgcount, p);
+        decode(v.avgcount2, p);
+      }
+    }
     if (t.type & PERFCOUNTER_LONGRUNAVG) {
-      decode(avgcount, p);
-      decode(avgcount2, p);
-      instances_it->second.push_avg(now, val, avgcount);
+      instances_it->second.push_avg(now, v.val, v.avgcount);
     } else {
-      instances_it->second.push(now, val);
+      instances_it->second.push(now, v.val);
     }
   }
   DECODE_FINISH(p);
+  return true;
 }
 
 void PerfCounterInstance::push(utime_t t, uint64_t const &v)
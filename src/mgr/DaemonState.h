@@ -32,6 +32,17 @@ namespace ceph {
   class Formatter;
 }
 
+struct MgrSession;
+
+enum {
+  l_mgr_daemon_state_first = 1000,
+  l_mgr_daemon_state_report_lock_wait,
+  l_mgr_daemon_state_py_lock_wait,
+  l_mgr_daemon_state_index_lock_wait,
+  l_mgr_daemon_state_index_publish,
+  l_mgr_daemon_state_last,
+};
+
 // An instance of a performance counter type, within
 // a particular daemon.
 class PerfCounterInstance
@@ -107,7 +118,11 @@ class DaemonPerfCounters
 
   std::map<std::string, PerfCounterInstance> instances;
 
-  void update(const MMgrReport& report);
+  /// @return false if a delta report did not match the session's
+  ///         baseline and was dropped
+  bool update(const MMgrReport& report);
+  /// as above, against the session the report arrived on
+  bool update(const MMgrReport& report, MgrSession *session);
 
   void clear()
   {
@@ -258,6 +273,39 @@ private:
   DaemonStateCollection all;
   std::set<DaemonKey> updating;
 
+  // Immutable copy of `all` and `by_server`, republished by publish() on
+  // the mgr tick if anything changed since.  While it is current, lookups
+  // load it without taking `lock`, so python modules walking the daemons
+  // never wait behind (or hold up) report and metadata processing.  After
+  // a change they read the live maps under the shared lock until the next
+  // publish, so writers never pay for a copy and bursts of registrations
+  // cost one copy per tick.
+  struct Snapshot {
+    DaemonStateCollection all;
+    std::map<std::string, DaemonStateCollection> by_server;
+  };
+  std::shared_ptr<const Snapshot> snapshot = std::make_shared<Snapshot>();
+  std::atomic<bool> snapshot_stale = false;
+
+  CephContext *cct = nullptr;
+  PerfCounters *logger = nullptr;
+
+  // call f(all, by_server) on the snapshot, or on the live maps under the
+  // shared lock if the snapshot is stale
+  template<typename Func>
+  auto _read(Func&& f) const {
+    if (!snapshot_stale.load(std::memory_order_acquire)) {
+      const auto snap = std::atomic_load(&snapshot);
+      return std::forward<Func>(f)(snap->all, snap->by_server);
+    }
+    std::shared_lock l{lock};
+    return std::forward<Func>(f)(all, by_server);
+  }
+  void _mark_stale() {
+    snapshot_stale.store(true, std::memory_order_release);
+  }
+  std::unique_lock<ceph::shared_mutex> _lock_for_write();
+
   std::map<std::string,ceph::ref_t<DeviceState>> devices;
 
   void _erase(const DaemonKey& dmk);
@@ -276,6 +324,15 @@ private:
 
 public:
   DaemonStateIndex() {}
+  ~DaemonStateIndex();
+
+  void init_perf_counters(CephContext *cct);
+
+  /**
+   * Lock a daemon's state, accounting the time spent waiting to perf
+   * counter `idx` (one of the l_mgr_daemon_state_*_lock_wait counters).
+   */
+  std::unique_lock<ceph::mutex> lock_daemon(DaemonState &state, int idx) const;
 
   // FIXME: shouldn't really be public, maybe construct DaemonState
   // objects internally to avoid this.
@@ -293,16 +350,25 @@ public:
   // still take the individual DaemonState::lock on each entry though.
   DaemonStateCollection get_by_server(const std::string &hostname) const;
   DaemonStateCollection get_by_service(const std::string &svc_name) const;
-  DaemonStateCollection get_all() const {return all;}
+  DaemonStateCollection get_all() const {
+    return _read([](auto& all, auto&) { return all; });
+  }
 
+  // cb sees a consistent view of the index; no lock is held unless it
+  // changed since the last publish()
   template<typename Callback, typename...Args>
   auto with_daemons_by_server(Callback&& cb, Args&&... args) const ->
     decltype(cb(by_server, std::forward<Args>(args)...)) {
-    std::shared_lock l{lock};
-    
-    return std::forward<Callback>(cb)(by_server, std::forward<Args>(args)...);
+    return _read([&](auto&, auto& by_server) {
+      return std::forward<Callback>(cb)(by_server,
+					std::forward<Args>(args)...);
+    });
   }
 
+  // bring the lock-free snapshot up to date if the index changed since
+  // the last call; called periodically
+  void publish();
+
   template<typename Callback, typename...Args>
   bool with_device(const std::string& dev,
 		   Callback&& cb, Args&&... args) const {
@@ -318,7 +384,7 @@ public:
   template<typename Callback, typename...Args>
   bool with_device_write(const std::string& dev,
 			 Callback&& cb, Args&&... args) {
-    std::unique_lock l{lock};
+    auto l = _lock_for_write();
     auto p = devices.find(dev);
     if (p == devices.end()) {
       return false;
@@ -333,7 +399,7 @@ public:
   template<typename Callback, typename...Args>
   void with_device_create(const std::string& dev,
 			  Callback&& cb, Args&&... args) {
-    std::unique_lock l{lock};
+    auto l = _lock_for_write();
     auto d = _get_or_create_device(dev);
     std::forward<Callback>(cb)(*d, std::forward<Args>(args)...);
   }
@@ -369,11 +435,11 @@ public:
   }
 
   void notify_updating(const DaemonKey &k) {
-    std::unique_lock l{lock};
+    auto l = _lock_for_write();
     updating.insert(k);
   }
   void clear_updating(const DaemonKey &k) {
-    std::unique_lock l{lock};
+    auto l = _lock_for_write();
     updating.erase(k);
   }
   bool is_updating(const DaemonKey &k) {
@@ -384,13 +450,14 @@ public:
   void update_metadata(DaemonStatePtr state,
 		       const map<string,string>& meta) {
     // remove and re-insert in case the device metadata changed
-    std::unique_lock l{lock};
+    auto l = _lock_for_write();
     _rm(state->key);
     {
       std::lock_guard l2{state->lock};
       state->set_metadata(meta);
     }
     _insert(state);
+    _mark_stale();
   }
 
   /**
@@ -229,6 +229,8 @@ void Mgr::init()
   ceph_assert(initializing);
   ceph_assert(!initialized);
 
+  daemon_state.init_perf_counters(g_ceph_context);
+
   // Enable signal handlers
   register_async_signal_handler_oneshot(SIGINT, handle_mgr_signal);
   register_async_signal_handler_oneshot(SIGTERM, handle_mgr_signal);
@@ -295,6 +295,60 @@ void MgrClient::_send_stats()
   }
 }
 
+bool MgrSessionState::pack_values(MMgrReport *report,
+				  std::vector<PerfCounterValue>&& values,
+				  const std::vector<bool>& avg,
+				  uint32_t full_sync_period)
+{
+  // Deltas are indexed by position in the declared set, so any change
+  // to that set (including a fresh session) needs a full report.
+  const bool send_full =
+    full_sync_period == 0 ||
+    need_full_report ||
+    reports_since_full + 1 >= full_sync_period ||
+    !report->declare_types.empty() ||
+    !report->undeclare_types.empty() ||
+    sent_values.size() != values.size();
+
+  report->stats_seq = ++last_report_seq;
+  ENCODE_START(1, 1, report->packed);
+  if (send_full) {
+    for (size_t i = 0; i < values.size(); ++i) {
+      encode(values[i].val, report->packed);
+      if (avg[i]) {
+        encode(values[i].avgcount, report->packed);
+        encode(values[i].avgcount2, report->packed);
+      }
+    }
+    reports_since_full = 0;
+    need_full_report = false;
+  } else {
+    PerfCounterDeltas deltas;
+    for (size_t i = 0; i < values.size(); ++i) {
+      const auto &v = values[i];
+      const auto &last = sent_values[i];
+      if (v.val != last.val ||
+          v.avgcount != last.avgcount ||
+          v.avgcount2 != last.avgcount2) {
+        PerfCounterDelta d;
+        d.idx = i;
+        d.avg = avg[i];
+        d.val = v.val - last.val;
+        d.avgcount = v.avgcount - last.avgcount;
+        d.avgcount2 = v.avgcount2 - last.avgcount2;
+        deltas.push_back(d);
+      }
+    }
+    encode(deltas, report->packed);
+    report->packed_delta = true;
+    report->delta_base_seq = report->stats_seq - 1;
+    ++reports_since_full;
+  }
+  ENCODE_FINISH(report->packed);
+  sent_values = std::move(values);
+  return send_full;
+}
+
 void MgrClient::_send_report()
 {
   ceph_assert(ceph_mutex_is_locked_by_me(lock));
@@ -323,7 +377,11 @@ void MgrClient::_send_report()
       session->declared.erase(path);
     };
 
-    ENCODE_START(1, 1, report->packed);
+    // Current values of the included counters, in declared order
+    std::vector<PerfCounterValue> values;
+    std::vector<bool> avg;
+    values.reserve(session->sent_values.size());
+    avg.reserve(session->sent_values.size());
 
     // Find counters that no longer exist, and undeclare them
     for (auto p = session->declared.begin(); p != session->declared.end(); ) {
@@ -364,18 +422,24 @@ void MgrClient::_send_report()
 	session->declared.insert(path);
       }
 
-      encode(static_cast<uint64_t>(data.u64), report->packed);
+      PerfCounterValue v;
+      v.val = data.u64;
       if (data.type & PERFCOUNTER_LONGRUNAVG) {
-        encode(static_cast<uint64_t>(data.avgcount), report->packed);
-        encode(static_cast<uint64_t>(data.avgcount2), report->packed);
+        v.avgcount = data.avgcount;
+        v.avgcount2 = data.avgcount2;
       }
+      values.push_back(v);
+      avg.push_back(data.type & PERFCOUNTER_LONGRUNAVG);
     }
-    ENCODE_FINISH(report->packed);
+
+    const bool full = session->pack_values(
+      report.get(), std::move(values), avg, stats_full_sync_period);
 
     ldout(cct, 20) << "sending " << session->declared.size() << " counters ("
                       "of possible " << by_path.size() << "), "
 		   << report->declare_types.size() << " new, "
                    << report->undeclare_types.size() << " removed"
+                   << (full ? " (full)" : " (changes only)")
                    << dendl;
   });
 
@@ -448,6 +512,18 @@ bool MgrClient::handle_mgr_configure(ref_t<MMgrConfigure> m)
     boost::apply_visitor(HandlePayloadVisitor(this), message.payload);
   }
 
+  if (m->stats_resync) {
+    ldout(cct, 4) << "mgr lost our perf counter baseline, sending full values"
+		  << dendl;
+    session->need_full_report = true;
+  }
+
+  if (stats_full_sync_period != m->stats_full_sync_period) {
+    ldout(cct, 4) << "updated stats full sync period: "
+		  << m->stats_full_sync_period << dendl;
+    stats_full_sync_period = m->stats_full_sync_period;
+  }
+
   bool starting = (stats_period == 0) && (m->stats_period != 0);
   stats_period = m->stats_period;
   if (starting) {
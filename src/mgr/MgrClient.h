@@ -43,8 +43,27 @@ class MgrSessionState
   // Which performance counters have we already transmitted schema for?
   std::set<std::string> declared;
 
+  // Values sent in the last report, in declared order, and how many
+  // delta reports have followed the last full one
+  std::vector<PerfCounterValue> sent_values;
+  uint32_t reports_since_full = 0;
+
+  // Sequence number of the last report sent on this session, and whether
+  // the mgr has asked for a full report because it lost our baseline
+  uint64_t last_report_seq = 0;
+  bool need_full_report = false;
+
   // Our connection to the mgr
   ConnectionRef con;
+
+  // Pack the current values of the declared counters, in declared order,
+  // into report->packed: as changes since the last report while the mgr
+  // can apply them to what it has, in full otherwise.  avg flags the
+  // PERFCOUNTER_LONGRUNAVG ones.  Returns true if they went in full.
+  bool pack_values(MMgrReport *report,
+		   std::vector<PerfCounterValue>&& values,
+		   const std::vector<bool>& avg,
+		   uint32_t full_sync_period);
 };
 
 class MgrCommand : public CommandOp
@@ -72,6 +91,7 @@ protected:
 
   uint32_t stats_period = 0;
   uint32_t stats_threshold = 0;
+  uint32_t stats_full_sync_period = 0;
   SafeTimer timer;
 
   CommandTable<MgrCommand> command_table;
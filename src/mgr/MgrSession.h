@@ -7,6 +7,7 @@
 #include "common/RefCountedObj.h"
 #include "common/entity_name.h"
 #include "msg/msg_types.h"
+#include "messages/MMgrReport.h"
 #include "MgrCap.h"
 
 
@@ -24,6 +25,15 @@ struct MgrSession : public RefCountedObject {
 
   std::set<std::string> declared_types;
 
+  // Last reported values, in declared_types order; the baseline that
+  // delta-encoded reports are applied to.
+  std::vector<PerfCounterValue> reported_values;
+  // MMgrReport::stats_seq of the report reported_values came from (0 if
+  // there is no usable baseline), and whether we have asked the daemon
+  // for a full report since losing it
+  uint64_t reported_seq = 0;
+  bool resync_requested = false;
+
   const entity_addr_t& get_peer_addr() const {
     return inst.addr;
   }
@@ -4,6 +4,7 @@
 #include "Mgr.h"
 
 #include "osd/OSDMap.h"
+#include "osd/OSDMapMapping.h"
 #include "common/errno.h"
 #include "common/version.h"
 #include "include/stringify.h"
@@ -19,6 +20,7 @@
 typedef struct {
   PyObject_HEAD
   OSDMap *osdmap;
+  ParallelPGMapper *upmap_mapper;
 } BasePyOSDMap;
 
 typedef struct {
@@ -82,7 +84,9 @@ static PyObject *osdmap_apply_incremental(BasePyOSDMap *self,
   dout(10) << __func__ << " map " << self->osdmap << " inc " << incobj->inc
 	   << " next " << next << dendl;
 
-  return construct_with_capsule("mgr_module", "OSDMap", (void*)next);
+  auto nextobj = construct_with_capsule("mgr_module", "OSDMap", (void*)next);
+  set_osdmap_upmap_mapper(nextobj, self->upmap_mapper);
+  return nextobj;
 }
 
 static PyObject *osdmap_get_crush(BasePyOSDMap* self, PyObject *obj)
@@ -152,7 +156,8 @@ static PyObject *osdmap_calc_pg_upmaps(BasePyOSDMap* self, PyObject *args)
 				 max_deviation,
 				 max_iterations,
 				 pools,
-				 incobj->inc);
+				 incobj->inc,
+				 self->upmap_mapper);
   PyEval_RestoreThread(tstate);
   dout(10) << __func__ << " r = " << r << dendl;
   return PyLong_FromLong(r);
@@ -202,6 +207,7 @@ BasePyOSDMap_init(BasePyOSDMap *self, PyObject *args, PyObject *kwds)
     self->osdmap = (OSDMap*)PyCapsule_GetPointer(
         osdmap_capsule, nullptr);
     ceph_assert(self->osdmap);
+    self->upmap_mapper = nullptr;
 
     return 0;
 }
@@ -337,6 +343,12 @@ PyTypeObject BasePyOSDMapType = {
   0,     /* tp_new */
 };
 
+void set_osdmap_upmap_mapper(PyObject *osdmap, ParallelPGMapper *mapper)
+{
+  ceph_assert(PyObject_TypeCheck(osdmap, &BasePyOSDMapType));
+  ((BasePyOSDMap*)osdmap)->upmap_mapper = mapper;
+}
+
 // ----------
 
 
@@ -7,6 +7,8 @@
 
 #include <string>
 
+class ParallelPGMapper;
+
 extern PyTypeObject BasePyOSDMapType;
 extern PyTypeObject BasePyOSDMapIncrementalType;
 extern PyTypeObject BasePyCRUSHType;
@@ -16,3 +18,6 @@ PyObject *construct_with_capsule(
     const std::string &clsname,
     void *wrapped);
 
+/// the mapper used by calc_pg_upmaps() on this OSDMap and on the maps
+/// apply_incremental() derives from it; without one the work is serial
+void set_osdmap_upmap_mapper(PyObject *osdmap, ParallelPGMapper *mapper);
@@ -0,0 +1,339 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include "PyPGMap.h"
+
+#include <memory>
+#include <vector>
+
+#include "mon/PGMap.h"
+#include "include/stringify.h"
+
+#include "PyFormatter.h"
+
+#define dout_context g_ceph_context
+#define dout_subsys ceph_subsys_mgr
+
+/**
+ * A read-only view of a PGMap snapshot shared with ClusterState (and
+ * any other view of the same version).  Unlike get('pg_dump') and
+ * friends, nothing is converted to python objects until it is asked
+ * for, and queries can be narrowed down by pool and pg state first.
+ */
+typedef struct {
+  PyObject_HEAD
+  std::shared_ptr<const PGMap> pgmap;
+} BasePyPGMap;
+
+// a pool < 0 and an empty state match every pg
+struct pg_filter_t {
+  int64_t pool = -1;
+  uint64_t state = 0;
+
+  bool matches(pg_t pgid, const pg_stat_t& s) const {
+    if (pool >= 0 && (int64_t)pgid.pool() != pool) {
+      return false;
+    }
+    return (s.state & state) == state;
+  }
+};
+
+static bool parse_pg_filter(PyObject *args, const char *fmt,
+			    pg_filter_t *filter)
+{
+  const char *state = "";
+  if (!PyArg_ParseTuple(args, fmt, &filter->pool, &state)) {
+    return false;
+  }
+  // accept "active+clean" style states, as printed by pg_state_string()
+  std::string s(state);
+  size_t begin = 0;
+  while (begin < s.size()) {
+    size_t end = s.find('+', begin);
+    if (end == std::string::npos) {
+      end = s.size();
+    }
+    auto part = s.substr(begin, end - begin);
+    auto bit = pg_string_state(part);
+    if (!bit) {
+      PyErr_Format(PyExc_ValueError, "unknown pg state '%s'", part.c_str());
+      return false;
+    }
+    filter->state |= *bit;
+    begin = end + 1;
+  }
+  return true;
+}
+
+static PyObject *pgmap_get_version(BasePyPGMap *self, PyObject *obj)
+{
+  return PyLong_FromUnsignedLongLong(self->pgmap->get_version());
+}
+
+static PyObject *pgmap_get_num_pg(BasePyPGMap *self, PyObject *obj)
+{
+  return PyLong_FromUnsignedLongLong(self->pgmap->pg_stat.size());
+}
+
+static PyObject *pgmap_get_pg_ids(BasePyPGMap *self, PyObject *args)
+{
+  pg_filter_t filter;
+  if (!parse_pg_filter(args, "Ls:get_pg_ids", &filter)) {
+    return nullptr;
+  }
+  std::vector<pg_t> pgids;
+  PyThreadState *tstate = PyEval_SaveThread();
+  for (auto& [pgid, s] : self->pgmap->pg_stat) {
+    if (filter.matches(pgid, s)) {
+      pgids.push_back(pgid);
+    }
+  }
+  PyEval_RestoreThread(tstate);
+  PyObject *ls = PyList_New(pgids.size());
+  for (size_t i = 0; i < pgids.size(); ++i) {
+    PyList_SET_ITEM(ls, i, PyUnicode_FromString(stringify(pgids[i]).c_str()));
+  }
+  return ls;
+}
+
+static PyObject *pgmap_get_pg_stats(BasePyPGMap *self, PyObject *args)
+{
+  const char *id = nullptr;
+  if (!PyArg_ParseTuple(args, "s:get_pg_stats", &id)) {
+    return nullptr;
+  }
+  pg_t pgid;
+  if (!pgid.parse(id)) {
+    PyErr_Format(PyExc_ValueError, "invalid pgid '%s'", id);
+    return nullptr;
+  }
+  auto p = self->pgmap->pg_stat.find(pgid);
+  if (p == self->pgmap->pg_stat.end()) {
+    Py_RETURN_NONE;
+  }
+  PyFormatter f;
+  f.dump_stream("pgid") << p->first;
+  p->second.dump(&f);
+  return f.get();
+}
+
+static PyObject *pgmap_dump_pg_stats(BasePyPGMap *self, PyObject *args)
+{
+  pg_filter_t filter;
+  if (!parse_pg_filter(args, "Ls:dump_pg_stats", &filter)) {
+    return nullptr;
+  }
+  // same layout as get('pg_stats')['pg_stats']
+  PyFormatter f(false, true);
+  for (auto& [pgid, s] : self->pgmap->pg_stat) {
+    if (!filter.matches(pgid, s)) {
+      continue;
+    }
+    f.open_object_section("pg_stat");
+    f.dump_stream("pgid") << pgid;
+    s.dump(&f);
+    f.close_section();
+  }
+  return f.get();
+}
+
+static PyObject *pgmap_get_pg_stat_sums(BasePyPGMap *self, PyObject *args)
+{
+  pg_filter_t filter;
+  if (!parse_pg_filter(args, "Ls:get_pg_stat_sums", &filter)) {
+    return nullptr;
+  }
+  // just the stat_sum of each pg, keyed by pgid
+  PyFormatter f;
+  for (auto& [pgid, s] : self->pgmap->pg_stat) {
+    if (!filter.matches(pgid, s)) {
+      continue;
+    }
+    f.open_object_section(stringify(pgid).c_str());
+    s.stats.sum.dump(&f);
+    f.close_section();
+  }
+  return f.get();
+}
+
+static PyObject *pgmap_count_by_state(BasePyPGMap *self, PyObject *args)
+{
+  pg_filter_t filter;
+  if (!parse_pg_filter(args, "Ls:count_by_state", &filter)) {
+    return nullptr;
+  }
+  std::map<uint64_t, uint32_t> by_state;
+  PyThreadState *tstate = PyEval_SaveThread();
+  for (auto& [pgid, s] : self->pgmap->pg_stat) {
+    if (filter.matches(pgid, s)) {
+      by_state[s.state]++;
+    }
+  }
+  PyEval_RestoreThread(tstate);
+  PyFormatter f;
+  for (auto& [state, num] : by_state) {
+    f.dump_unsigned(pg_state_string(state).c_str(), num);
+  }
+  return f.get();
+}
+
+static PyObject *pgmap_count_by_pool_and_state(BasePyPGMap *self,
+						PyObject *obj)
+{
+  std::map<int64_t, std::map<uint64_t, uint32_t>> by_pool;
+  PyThreadState *tstate = PyEval_SaveThread();
+  for (auto& [pgid, s] : self->pgmap->pg_stat) {
+    by_pool[pgid.pool()][s.state]++;
+  }
+  PyEval_RestoreThread(tstate);
+  // same layout as get('pg_summary')['by_pool']
+  PyFormatter f;
+  for (auto& [pool, by_state] : by_pool) {
+    f.open_object_section(stringify(pool).c_str());
+    for (auto& [state, num] : by_state) {
+      f.dump_unsigned(pg_state_string(state).c_str(), num);
+    }
+    f.close_section();
+  }
+  return f.get();
+}
+
+static PyObject *pgmap_get_pg_sum(BasePyPGMap *self, PyObject *obj)
+{
+  PyFormatter f;
+  self->pgmap->pg_sum.dump(&f);
+  return f.get();
+}
+
+static PyObject *pgmap_get_pool_stats(BasePyPGMap *self, PyObject *args)
+{
+  int64_t poolid;
+  if (!PyArg_ParseTuple(args, "L:get_pool_stats", &poolid)) {
+    return nullptr;
+  }
+  auto p = self->pgmap->pg_pool_sum.find(poolid);
+  if (p == self->pgmap->pg_pool_sum.end()) {
+    Py_RETURN_NONE;
+  }
+  PyFormatter f;
+  f.dump_int("poolid", p->first);
+  auto q = self->pgmap->num_pg_by_pool.find(p->first);
+  if (q != self->pgmap->num_pg_by_pool.end())
+    f.dump_unsigned("num_pg", q->second);
+  p->second.dump(&f);
+  return f.get();
+}
+
+static PyObject *pgmap_get_osd_stats(BasePyPGMap *self, PyObject *args)
+{
+  int osd;
+  if (!PyArg_ParseTuple(args, "i:get_osd_stats", &osd)) {
+    return nullptr;
+  }
+  auto p = self->pgmap->osd_stat.find(osd);
+  if (p == self->pgmap->osd_stat.end()) {
+    Py_RETURN_NONE;
+  }
+  PyFormatter f;
+  f.dump_int("osd", p->first);
+  p->second.dump(&f, false);
+  return f.get();
+}
+
+static int
+BasePyPGMap_init(BasePyPGMap *self, PyObject *args, PyObject *kwds)
+{
+    PyObject *pgmap_capsule = nullptr;
+    static const char *kwlist[] = {"pgmap_capsule", NULL};
+
+    if (! PyArg_ParseTupleAndKeywords(args, kwds, "O",
+                                      const_cast<char**>(kwlist),
+                                      &pgmap_capsule)) {
+      ceph_abort();
+      return -1;
+    }
+    ceph_assert(PyObject_TypeCheck(pgmap_capsule, &PyCapsule_Type));
+
+    // as with BasePyCRUSH, the capsule holds a pointer to the caller's
+    // shared pointer; take our own reference to the snapshot
+    auto ptr_ref = (std::shared_ptr<const PGMap>*)(
+        PyCapsule_GetPointer(pgmap_capsule, nullptr));
+    self->pgmap = *ptr_ref;
+    ceph_assert(self->pgmap);
+
+    return 0;
+}
+
+static void
+BasePyPGMap_dealloc(BasePyPGMap *self)
+{
+  self->pgmap.reset();
+  Py_TYPE(self)->tp_free(self);
+}
+
+PyMethodDef BasePyPGMap_methods[] = {
+  {"_get_version", (PyCFunction)pgmap_get_version, METH_NOARGS,
+   "Get PGMap version"},
+  {"_get_num_pg", (PyCFunction)pgmap_get_num_pg, METH_NOARGS,
+   "Get the number of PGs"},
+  {"_get_pg_ids", (PyCFunction)pgmap_get_pg_ids, METH_VARARGS,
+   "Get the PG IDs in a pool and/or state"},
+  {"_get_pg_stats", (PyCFunction)pgmap_get_pg_stats, METH_VARARGS,
+   "Get the stats of a single PG"},
+  {"_dump_pg_stats", (PyCFunction)pgmap_dump_pg_stats, METH_VARARGS,
+   "Dump the stats of the PGs in a pool and/or state"},
+  {"_get_pg_stat_sums", (PyCFunction)pgmap_get_pg_stat_sums, METH_VARARGS,
+   "Get the stat_sum of the PGs in a pool and/or state, by PG ID"},
+  {"_count_by_state", (PyCFunction)pgmap_count_by_state, METH_VARARGS,
+   "Count PGs by state"},
+  {"_count_by_pool_and_state", (PyCFunction)pgmap_count_by_pool_and_state,
+   METH_NOARGS, "Count PGs by pool and state"},
+  {"_get_pg_sum", (PyCFunction)pgmap_get_pg_sum, METH_NOARGS,
+   "Get the stats summed over all PGs"},
+  {"_get_pool_stats", (PyCFunction)pgmap_get_pool_stats, METH_VARARGS,
+   "Get the stats of a single pool"},
+  {"_get_osd_stats", (PyCFunction)pgmap_get_osd_stats, METH_VARARGS,
+   "Get the stats of a single OSD"},
+  {NULL, NULL, 0, NULL}
+};
+
+PyTypeObject BasePyPGMapType = {
+  PyVarObject_HEAD_INIT(NULL, 0)
+  "ceph_module.BasePyPGMap", /* tp_name */
+  sizeof(BasePyPGMap),       /* tp_basicsize */
+  0,                         /* tp_itemsize */
+  (destructor)BasePyPGMap_dealloc,      /* tp_dealloc */
+  0,                         /* tp_print */
+  0,                         /* tp_getattr */
+  0,                         /* tp_setattr */
+  0,                         /* tp_compare */
+  0,                         /* tp_repr */
+  0,                         /* tp_as_number */
+  0,                         /* tp_as_sequence */
+  0,                         /* tp_as_mapping */
+  0,                         /* tp_hash */
+  0,                         /* tp_call */
+  0,                         /* tp_str */
+  0,                         /* tp_getattro */
+  0,                         /* tp_setattro */
+  0,                         /* tp_as_buffer */
+  Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE,        /* tp_flags */
+  "Ceph PGMap",              /* tp_doc */
+  0,                         /* tp_traverse */
+  0,                         /* tp_clear */
+  0,                         /* tp_richcompare */
+  0,                         /* tp_weaklistoffset */
+  0,                         /* tp_iter */
+  0,                         /* tp_iternext */
+  BasePyPGMap_methods,       /* tp_methods */
+  0,                         /* tp_members */
+  0,                         /* tp_getset */
+  0,                         /* tp_base */
+  0,                         /* tp_dict */
+  0,                         /* tp_descr_get */
+  0,                         /* tp_descr_set */
+  0,                         /* tp_dictoffset */
+  (initproc)BasePyPGMap_init,                         /* tp_init */
+  0,                         /* tp_alloc */
+  0,     /* tp_new */
+};
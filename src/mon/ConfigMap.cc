@@ -251,6 +251,111 @@ void ConfigMap::parse_key(
 }
 
 
+// --------------
+
+void EntityConfigCache::reset(const ConfigMap& config_map)
+{
+  entries.clear();
+  host_crush_location.clear();
+  mask_location_types.clear();
+  mask_device_class = false;
+  auto note_masks = [this](const Section& section) {
+    for (auto& [name, mopt] : section.options) {
+      if (mopt.mask.location_type.size()) {
+	mask_location_types.insert(mopt.mask.location_type);
+      }
+      if (mopt.mask.device_class.size()) {
+	mask_device_class = true;
+      }
+    }
+  };
+  note_masks(config_map.global);
+  for (auto& [name, section] : config_map.by_type) {
+    note_masks(section);
+  }
+  for (auto& [name, section] : config_map.by_id) {
+    note_masks(section);
+  }
+}
+
+std::string EntityConfigCache::get_key(
+  const ConfigMap& config_map,
+  const EntityName& name,
+  const map<string,string>& crush_location,
+  const string& device_class) const
+{
+  // type, matching by-id sections, relevant location and class
+  string key = name.get_type_name();
+  key += '\n';
+  vector<string> name_bits;
+  boost::split(name_bits, name.to_str(), [](char c){ return c == '.'; });
+  string tname;
+  for (unsigned i = 0; i < name_bits.size(); ++i) {
+    if (i) {
+      tname += '.';
+    }
+    tname += name_bits[i];
+    if (config_map.by_id.count(tname)) {
+      key += tname;
+      key += '\n';
+    }
+  }
+  for (auto& type : mask_location_types) {
+    auto p = crush_location.find(type);
+    if (p != crush_location.end()) {
+      key += type + "=" + p->second + "\n";
+    }
+  }
+  key += device_class;
+  return key;
+}
+
+const EntityConfigCache::config_t& EntityConfigCache::get(
+  ConfigMap& config_map,
+  epoch_t e,
+  CrushWrapper *crush,
+  const EntityName& name,
+  int osd,
+  const string& remote_host)
+{
+  if (e != epoch) {
+    entries.clear();
+    host_crush_location.clear();
+    epoch = e;
+  }
+
+  // only look up what some mask can actually match on
+  map<string,string> crush_location;
+  if (remote_host.size() && !mask_location_types.empty()) {
+    auto [p, inserted] = host_crush_location.try_emplace(remote_host);
+    if (inserted) {
+      crush->get_full_location(remote_host, &p->second);
+    }
+    crush_location = p->second;
+  }
+
+  string device_class;
+  if (osd >= 0 && mask_device_class) {
+    const char *c = crush->get_item_class(osd);
+    if (c) {
+      device_class = c;
+    }
+  }
+
+  auto key = get_key(config_map, name, crush_location, device_class);
+  auto p = entries.find(key);
+  if (p == entries.end()) {
+    p = entries.emplace(
+      key,
+      config_map.generate_entity_map(
+	name,
+	crush_location,
+	crush,
+	device_class)).first;
+  }
+  return p->second;
+}
+
 // --------------
 
 void ConfigChangeSet::dump(Formatter *f) const
@@ -5,8 +5,10 @@
 
 #include <map>
 #include <ostream>
+#include <set>
 #include <string>
 
+#include "include/types.h"
 #include "include/utime.h"
 #include "common/options.h"
 #include "common/entity_name.h"
@@ -139,6 +141,44 @@ struct ConfigMap {
     OptionMask *mask);
 };
 
+/// generate_entity_map() results, shared by the entities that a ConfigMap
+/// can't tell apart: same type and matching by-id sections, and the same
+/// crush location and device class where some option mask looks at them
+class EntityConfigCache {
+public:
+  using config_t = std::map<std::string,std::string,std::less<>>;
+
+  /// drop everything and note which masks config_map uses; call whenever
+  /// the config is reloaded
+  void reset(const ConfigMap& config_map);
+
+  /// the config of an entity, with osd its id or -1 if it is no osd.  what
+  /// was generated against an older osdmap epoch is dropped first.
+  const config_t& get(
+    ConfigMap& config_map,
+    epoch_t epoch,
+    CrushWrapper *crush,
+    const EntityName& name,
+    int osd,
+    const std::string& remote_host);
+
+  size_t size() const {
+    return entries.size();
+  }
+
+private:
+  std::set<std::string> mask_location_types;
+  bool mask_device_class = false;
+  epoch_t epoch = 0;
+  std::map<std::string,config_t> entries;
+  std::map<std::string,std::map<std::string,std::string>> host_crush_location;
+
+  std::string get_key(
+    const ConfigMap& config_map,
+    const EntityName& name,
+    const std::map<std::string,std::string>& crush_location,
+    const std::string& device_class) const;
+};
 
 struct ConfigChangeSet {
   version_t version;
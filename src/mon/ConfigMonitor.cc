@@ -859,6 +859,7 @@ void ConfigMonitor::load_config()
     it->next();
   }
   dout(10) << __func__ << " got " << num << " keys" << dendl;
+  entity_config.reset(config_map);
 
   // refresh our own config
   {
@@ -904,32 +905,28 @@ void ConfigMonitor::load_changeset(version_t v, ConfigChangeSet *ch)
   }
 }
 
-bool ConfigMonitor::refresh_config(MonSession *s)
+const std::map<std::string,std::string,std::less<>>&
+ConfigMonitor::get_entity_config(MonSession *s)
 {
   const OSDMap& osdmap = mon.osdmon()->osdmap;
-  map<string,string> crush_location;
-  if (s->remote_host.size()) {
-    osdmap.crush->get_full_location(s->remote_host, &crush_location);
-    dout(10) << __func__ << " crush_location for remote_host " << s->remote_host
-	     << " is " << crush_location << dendl;
-  }
-
-  string device_class;
-  if (s->name.is_osd()) {
-    const char *c = osdmap.crush->get_item_class(s->name.num());
-    if (c) {
-      device_class = c;
-      dout(10) << __func__ << " device_class " << device_class << dendl;
-    }
-  }
-
-  dout(20) << __func__ << " " << s->entity_name << " crush " << crush_location
-	   << " device_class " << device_class << dendl;
-  auto out = config_map.generate_entity_map(
-    s->entity_name,
-    crush_location,
+  auto& out = entity_config.get(
+    config_map,
+    osdmap.get_epoch(),
     osdmap.crush.get(),
-    device_class);
+    s->entity_name,
+    s->name.is_osd() ? s->name.num() : -1,
+    s->remote_host);
+  dout(20) << __func__ << " " << s->entity_name << " remote_host "
+	   << s->remote_host << ", " << entity_config.size()
+	   << " distinct configs" << dendl;
+  return out;
+}
+
+bool ConfigMonitor::refresh_config(
+  MonSession *s,
+  std::map<std::string,std::string,std::less<>> *prev)
+{
+  auto& out = get_entity_config(s);
 
   if (out == s->last_config && s->any_config) {
     dout(20) << __func__ << " no change, " << out << dendl;
@@ -938,27 +935,44 @@ bool ConfigMonitor::refresh_config(MonSession *s)
   // removing this to hide sensitive data going into logs
   // leaving this for debugging purposes
  //  dout(20) << __func__ << " " << out << dendl;
-  s->last_config = std::move(out);
+  if (prev) {
+    *prev = std::move(s->last_config);
+  }
+  s->last_config = out;
   s->any_config = true;
   return true;
 }
 
 bool ConfigMonitor::maybe_send_config(MonSession *s)
 {
-  bool changed = refresh_config(s);
+  std::map<std::string,std::string,std::less<>> prev;
+  bool had_config = s->any_config;
+  bool changed = refresh_config(s, &prev);
   dout(10) << __func__ << " to " << s->name << " "
 	   << (changed ? "(changed)" : "(unchanged)")
 	   << dendl;
   if (changed) {
-    send_config(s);
+    send_config(s, had_config ? &prev : nullptr);
   }
   return changed;
 }
 
-void ConfigMonitor::send_config(MonSession *s)
+void ConfigMonitor::send_config(
+  MonSession *s,
+  const std::map<std::string,std::string,std::less<>> *prev)
 {
-  dout(10) << __func__ << " to " << s->name << dendl;
-  auto m = new MConfig(s->last_config);
+  if (!prev || !s->config_diff) {
+    dout(10) << __func__ << " to " << s->name << dendl;
+    auto m = new MConfig(s->last_config);
+    s->con->send_message(m);
+    return;
+  }
+
+  // only what changed since the previous MConfig on this session
+  auto m = new MConfig;
+  m->set_diff(*prev, s->last_config);
+  dout(10) << __func__ << " to " << s->name << " " << m->config.size()
+	   << " changed, " << m->removed.size() << " removed" << dendl;
   s->con->send_message(m);
 }
 
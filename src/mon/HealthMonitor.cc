@@ -451,10 +451,13 @@ bool HealthMonitor::check_mutes()
   return changed;
 }
 
-void HealthMonitor::gather_all_health_checks(health_check_map_t *all)
+void HealthMonitor::gather_all_health_checks(health_check_map_t *all,
+					     bool with_detail)
 {
+  // the detail lists can be long (one line per pg or osd); leave them
+  // behind when only the summary is wanted
   for (auto& svc : mon.paxos_service) {
-    all->merge(svc->get_health_checks());
+    all->merge(svc->get_health_checks(), with_detail);
   }
 }
 
@@ -466,7 +469,7 @@ health_status_t HealthMonitor::get_health_status(
   const char *sep2)
 {
   health_check_map_t all;
-  gather_all_health_checks(&all);
+  gather_all_health_checks(&all, want_detail);
   health_status_t r = HEALTH_OK;
   for (auto& p : all.checks) {
     if (!mutes.count(p.first)) {
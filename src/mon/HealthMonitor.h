@@ -47,7 +47,8 @@ public:
 
   void tick() override;
 
-  void gather_all_health_checks(health_check_map_t *all);
+  void gather_all_health_checks(health_check_map_t *all,
+				bool with_detail = true);
   health_status_t get_health_status(
     bool want_detail,
     ceph::Formatter *f,
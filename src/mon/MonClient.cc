@@ -458,6 +458,15 @@ void MonClient::handle_config(MConfig *m)
 {
   ldout(cct,10) << __func__ << " " << *m << dendl;
 
+  // turn a diff into the full set so that everything below sees the same
+  // message as before
+  m->apply(&mon_config);
+  if (m->incremental) {
+    m->config = mon_config;
+    m->incremental = false;
+    m->removed.clear();
+  }
+
   if (want_bootstrap_config) {
     // get_monmap_and_config is waiting for config which it will apply
     // synchronously
@@ -568,7 +577,7 @@ int MonClient::authenticate(double timeout)
     return 0;
   }
   sub.want("monmap", monmap.get_epoch() ? monmap.get_epoch() + 1 : 0, 0);
-  sub.want("config", 0, 0);
+  sub.want("config", 0, CEPH_SUBSCRIBE_CONFIG_DIFF);
   if (!_opened())
     _reopen_session();
 
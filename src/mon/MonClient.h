@@ -329,6 +329,9 @@ private:
 
   bool want_bootstrap_config = false;
   ceph::ref_t<MConfig> bootstrap_config;
+  /// config last received from the mon, to apply incremental MConfigs to
+  std::map<std::string,std::string,std::less<>> mon_config;
+  friend class MonClientConfigTest;
 
   // authenticate
   std::unique_ptr<AuthClientHandler> auth;
@@ -5265,6 +5265,7 @@ void Monitor::handle_subscribe(MonOpRequestRef op)
     } else if (p->first == "servicemap") {
       mgrstatmon()->check_sub(s->sub_map[p->first]);
     } else if (p->first == "config") {
+      s->config_diff = p->second.flags & CEPH_SUBSCRIBE_CONFIG_DIFF;
       configmon()->check_sub(s);
     } else if (p->first.find("kv:") == 0) {
       kvmon()->check_sub(s->sub_map[p->first]);
@@ -944,6 +944,8 @@ public:
 public: // for AuthMonitor msgr1:
   int ms_handle_authentication(Connection *con) override;
 private:
+  // with mon_dispatch_threads > 1 these may run concurrently, though never
+  // for the same connection; shared state is under lock or session_map_lock
   void ms_handle_accept(Connection *con) override;
   bool ms_handle_reset(Connection *con) override;
   void ms_handle_remote_reset(Connection *con) override {}
@@ -21,6 +21,7 @@
 #include <boost/scoped_ptr.hpp>
 #include <sstream>
 #include <fstream>
+#include <functional>
 #include "kv/KeyValueDB.h"
 
 #include "include/ceph_assert.h"
@@ -173,6 +174,72 @@ class MonitorDBStore
       bytes += ops.back().approx_size();
     }
 
+    /**
+     * Erase the keys @p key_prefix<v> of @p prefix for versions [from, to),
+     * where versions [to, last] may still exist.
+     *
+     * Version keys are not zero padded, so a lexicographic range of
+     * same-width versions also covers longer keys starting with the same
+     * digits.  Each run of same-width versions becomes a single ERASE_RANGE
+     * unless it would cover one of the remaining keys, in which case the
+     * run is erased key by key (skipping keys for which @p exists, if
+     * given, returns false).
+     */
+    void erase_versions(const std::string& prefix,
+			const std::string& key_prefix,
+			version_t from, version_t to, version_t last,
+			const std::function<bool(version_t)>& exists = nullptr) {
+      auto width = [](version_t v) {
+	int w = 1;
+	for (; v >= 10; v /= 10)
+	  ++w;
+	return w;
+      };
+      auto pow10 = [](int n) {
+	version_t p = 1;
+	while (n-- > 0)
+	  p *= 10;
+	return p;
+      };
+      auto key = [&key_prefix](version_t v) {
+	return key_prefix + std::to_string(v);
+      };
+      const int last_width = width(last);
+      for (version_t v = from; v < to; ) {
+	const int w = width(v);
+	const version_t end = std::min(to, pow10(w));
+	// [key(v), key(end - 1) + '\0') also covers every longer key whose
+	// first w digits fall in [v, end - 1)
+	bool covers_live = false;
+	for (int lw = w + 1; lw <= last_width && !covers_live; ++lw) {
+	  const version_t lo = std::max(to, pow10(lw - 1));
+	  const version_t hi = std::min(last, pow10(lw) - 1);
+	  const version_t d = pow10(lw - w);
+	  covers_live = lo <= hi && lo / d < end - 1 && hi / d >= v;
+	}
+	if (!covers_live && end - v > 1) {
+	  erase_range(prefix, key(v), key(end - 1) + '\0');
+	  v = end;
+	} else {
+	  for (; v < end; ++v) {
+	    if (!exists || exists(v))
+	      erase(prefix, key(v));
+	  }
+	}
+      }
+    }
+
+    /// count point (@p erases) and range (@p ranges) deletions
+    void count_erases(uint64_t *erases, uint64_t *ranges) const {
+      *erases = *ranges = 0;
+      for (auto& op : ops) {
+	if (op.type == OP_ERASE)
+	  ++*erases;
+	else if (op.type == OP_ERASE_RANGE)
+	  ++*ranges;
+      }
+    }
+
     void compact_prefix(const std::string& prefix) {
       ops.push_back(Op(OP_COMPACT, prefix, {}));
     }
@@ -620,9 +687,17 @@ class MonitorDBStore
     os << path.substr(0, path.size() - pos) << "/store.db";
     std::string full_path = os.str();
 
+    // trims issue many small range deletes; let rocksdb turn them into
+    // tombstones well below the threshold used by the other daemons
+    std::map<std::string,std::string> kv_options = {
+      {"delete_range_threshold",
+       std::to_string(g_conf().get_val<uint64_t>(
+	 "mon_rocksdb_delete_range_threshold"))},
+    };
     KeyValueDB *db_ptr = KeyValueDB::create(g_ceph_context,
 					    kv_type,
-					    full_path);
+					    full_path,
+					    kv_options);
     if (!db_ptr) {
       derr << __func__ << " error initializing "
 	   << kv_type << " db back storage in "
@@ -450,6 +450,7 @@ OSDMonitor::OSDMonitor(
    cct(cct),
    inc_osd_cache(g_conf()->mon_osd_cache_size),
    full_osd_cache(g_conf()->mon_osd_cache_size),
+   osdmap_encode_features(g_conf()->mon_osd_cache_size),
    has_osdmap_manifest(false),
    mapper(mn.cct, &mn.cpu_tp)
 {
@@ -776,6 +777,7 @@ void OSDMonitor::update_from_paxos(bool *need_bootstrap)
     dout(7) << __func__ << " loading latest full map e" << latest_full << dendl;
     osdmap = OSDMap();
     osdmap.decode(latest_bl);
+    mapping.invalidate();
   }
 
   bufferlist bl;
@@ -814,6 +816,14 @@ void OSDMonitor::update_from_paxos(bool *need_bootstrap)
     dout(7) << "update_from_paxos  applying incremental " << osdmap.epoch+1
 	    << dendl;
     OSDMap::Incremental inc(inc_bl);
+    if (inc.encode_features) {
+      osdmap_encode_features.add(
+	inc.epoch, OSDMap::get_significant_features(inc.encode_features));
+    }
+    // the mapping job was canceled above, so it can't complete and throw
+    // away what is noted here
+    ceph_assert(!mapping_job);
+    mapping.note_incremental(osdmap, inc);
     err = osdmap.apply_incremental(inc);
     ceph_assert(err == 0);
 
@@ -858,6 +868,7 @@ void OSDMonitor::update_from_paxos(bool *need_bootstrap)
 
 	osdmap = OSDMap();
 	osdmap.decode(orig_full_bl);
+	mapping.invalidate();
 
 	dout(20) << __func__ << " canonical full osdmap:\n";
 	JSONFormatter jf(true);
@@ -928,6 +939,7 @@ void OSDMonitor::update_from_paxos(bool *need_bootstrap)
   }
   // XXX: need to trim MonSession connected with a osd whose id > max_osd?
 
+  preencode_osdmap(osdmap.get_epoch());
   check_osdmap_subs();
   check_pg_creates_subs();
 
@@ -1057,8 +1069,10 @@ void OSDMonitor::start_mapping()
   }
   if (!osdmap.get_pools().empty()) {
     auto fin = new C_UpdateCreatingPGs(this, osdmap.get_epoch());
-    mapping_job = mapping.start_update(osdmap, mapper,
-				       g_conf()->mon_osd_mapping_pgs_per_chunk);
+    mapping_job = mapping.start_update(
+      osdmap, mapper,
+      g_conf()->mon_osd_mapping_pgs_per_chunk,
+      g_conf().get_val<bool>("mon_osd_mapping_incremental"));
     dout(10) << __func__ << " started mapping job " << mapping_job.get()
 	     << " at " << fin->start << dendl;
     mapping_job->set_finish_event(fin);
@@ -4418,6 +4432,7 @@ void OSDMonitor::send_latest(MonOpRequestRef op, epoch_t start)
 
 MOSDMap *OSDMonitor::build_latest_full(uint64_t features)
 {
+  note_osdmap_feature_demand(features);
   MOSDMap *r = new MOSDMap(mon.monmap->fsid, features);
   get_version_full(osdmap.get_epoch(), features, r->maps[osdmap.get_epoch()]);
   r->oldest_map = get_first_committed();
@@ -4499,6 +4514,7 @@ void OSDMonitor::send_incremental(epoch_t first,
   // use quorum_con_features, if it's an anonymous connection.
   uint64_t features = session->con_features ? session->con_features :
     mon.get_quorum_con_features();
+  note_osdmap_feature_demand(features);
 
   if (first <= session->osd_epoch) {
     dout(10) << __func__ << " " << session->name << " should already have epoch "
@@ -4562,6 +4578,10 @@ void OSDMonitor::reencode_incremental_map(bufferlist& bl, uint64_t features)
   inc.decode(q);
   // always encode with subset of osdmap's canonical features
   uint64_t f = features & inc.encode_features;
+  if (inc.encode_features) {
+    osdmap_encode_features.add(
+      inc.epoch, OSDMap::get_significant_features(inc.encode_features));
+  }
   dout(20) << __func__ << " " << inc.epoch << " with features " << f
 	   << dendl;
   bl.clear();
@@ -4590,31 +4610,44 @@ void OSDMonitor::reencode_full_map(bufferlist& bl, uint64_t features)
   m.decode(q);
   // always encode with subset of osdmap's canonical features
   uint64_t f = features & m.get_encoding_features();
+  osdmap_encode_features.add(
+    m.get_epoch(), OSDMap::get_significant_features(m.get_encoding_features()));
   dout(20) << __func__ << " " << m.get_epoch() << " with features " << f
 	   << dendl;
   bl.clear();
   m.encode(bl, f | CEPH_FEATURE_RESERVED);
 }
 
-int OSDMonitor::get_version(version_t ver, uint64_t features, bufferlist& bl)
+uint64_t OSDMonitor::get_osdmap_cache_features(version_t ver,
+						uint64_t features)
 {
   uint64_t significant_features = OSDMap::get_significant_features(features);
-  if (inc_osd_cache.lookup({ver, significant_features}, &bl)) {
+  uint64_t encode_features;
+  if (osdmap_encode_features.lookup(ver, &encode_features)) {
+    return significant_features & encode_features;
+  }
+  return significant_features;
+}
+
+int OSDMonitor::get_version(version_t ver, uint64_t features, bufferlist& bl)
+{
+  uint64_t cache_features = get_osdmap_cache_features(ver, features);
+  if (inc_osd_cache.lookup({ver, cache_features}, &bl)) {
     return 0;
   }
   int ret = PaxosService::get_version(ver, bl);
   if (ret < 0) {
     return ret;
   }
-  // NOTE: this check is imprecise; the OSDMap encoding features may
-  // be a subset of the latest mon quorum features, but worst case we
-  // reencode once and then cache the (identical) result under both
-  // feature masks.
-  if (significant_features !=
-      OSDMap::get_significant_features(mon.get_quorum_con_features())) {
+  // NOTE: if we don't know the features this epoch was stored with, this
+  // check is imprecise: they may be a subset of the latest mon quorum
+  // features, but worst case we reencode once and learn them.
+  if (cache_features !=
+      get_osdmap_cache_features(ver, mon.get_quorum_con_features())) {
     reencode_incremental_map(bl, features);
+    cache_features = get_osdmap_cache_features(ver, features);
   }
-  inc_osd_cache.add_bytes({ver, significant_features}, bl);
+  inc_osd_cache.add_bytes({ver, cache_features}, bl);
   return 0;
 }
 
@@ -4654,8 +4687,9 @@ int OSDMonitor::get_full_from_pinned_map(version_t ver, bufferlist& bl)
   bufferlist osdm_bl;
   bool has_cached_osdmap = false;
   for (version_t v = ver-1; v >= closest_pinned; --v) {
-    if (full_osd_cache.lookup({v, mon.get_quorum_con_features()},
-                                &osdm_bl)) {
+    if (full_osd_cache.lookup(
+	  {v, get_osdmap_cache_features(v, mon.get_quorum_con_features())},
+	  &osdm_bl)) {
       dout(10) << __func__ << " found map in cache ver " << v << dendl;
       closest_pinned = v;
       has_cached_osdmap = true;
@@ -4743,8 +4777,8 @@ int OSDMonitor::get_version_full(version_t ver, bufferlist& bl)
 int OSDMonitor::get_version_full(version_t ver, uint64_t features,
 				 bufferlist& bl)
 {
-  uint64_t significant_features = OSDMap::get_significant_features(features);
-  if (full_osd_cache.lookup({ver, significant_features}, &bl)) {
+  uint64_t cache_features = get_osdmap_cache_features(ver, features);
+  if (full_osd_cache.lookup({ver, cache_features}, &bl)) {
     return 0;
   }
   int ret = PaxosService::get_version_full(ver, bl);
@@ -4755,18 +4789,51 @@ int OSDMonitor::get_version_full(version_t ver, uint64_t features,
   if (ret < 0) {
     return ret;
   }
-  // NOTE: this check is imprecise; the OSDMap encoding features may
-  // be a subset of the latest mon quorum features, but worst case we
-  // reencode once and then cache the (identical) result under both
-  // feature masks.
-  if (significant_features !=
-      OSDMap::get_significant_features(mon.get_quorum_con_features())) {
+  // NOTE: see get_version() on how precise this check is
+  if (cache_features !=
+      get_osdmap_cache_features(ver, mon.get_quorum_con_features())) {
     reencode_full_map(bl, features);
+    cache_features = get_osdmap_cache_features(ver, features);
   }
-  full_osd_cache.add_bytes({ver, significant_features}, bl);
+  full_osd_cache.add_bytes({ver, cache_features}, bl);
   return 0;
 }
 
+void OSDMonitor::preencode_osdmap(epoch_t e)
+{
+  // pick the most requested feature sets, then decay the counts so that
+  // those of departed peers age out
+  std::vector<std::pair<uint64_t, uint64_t>> top;  // (requests, features)
+  for (auto p = osdmap_feature_demand.begin();
+       p != osdmap_feature_demand.end(); ) {
+    top.emplace_back(p->second, p->first);
+    p->second /= 2;
+    if (p->second == 0) {
+      p = osdmap_feature_demand.erase(p);
+    } else {
+      ++p;
+    }
+  }
+  auto max = g_conf().get_val<uint64_t>("mon_osd_cache_preencode");
+  std::sort(top.begin(), top.end(), std::greater<>());
+  if (top.size() > max) {
+    top.resize(max);
+  }
+  const auto stored_features =
+    get_osdmap_cache_features(e, mon.get_quorum_con_features());
+  for (auto& [requests, features] : top) {
+    if (get_osdmap_cache_features(e, features) == stored_features) {
+      // served from the stored encoding
+      continue;
+    }
+    dout(20) << __func__ << " e" << e << " for features " << std::hex
+	     << features << std::dec << " (" << requests << " requests)"
+	     << dendl;
+    bufferlist bl;
+    get_version(e, features, bl);
+  }
+}
+
 epoch_t OSDMonitor::blocklist(const entity_addrvec_t& av, utime_t until)
 {
   dout(10) << "blocklist " << av << " until " << until << dendl;
@@ -4804,11 +4871,98 @@ void OSDMonitor::check_osdmap_subs()
   if (osdmap_subs == mon.session_map.subs.end()) {
     return;
   }
+
+  // Subscribers that need the same epochs and share connection features get
+  // byte-identical MOSDMaps.  Group them so that each message is built and
+  // encoded once, and the payload is shared by reference across sessions.
+  // Anything unusual (anonymous or proxied sessions, maps older than
+  // first_committed, nothing to send) takes the per-subscriber path.
+  map<std::tuple<epoch_t, uint64_t, bool>, vector<Subscription*>> groups;
   auto p = osdmap_subs->second->begin();
   while (!p.end()) {
     auto sub = *p;
     ++p;
-    check_osdmap_sub(sub);
+    MonSession *s = sub->session;
+    if (sub->next > osdmap.get_epoch() ||
+	!s->con_features || s->proxy_con) {
+      check_osdmap_sub(sub);
+      continue;
+    }
+    epoch_t first = 0;  // 0: latest full map
+    if (sub->next >= 1) {
+      first = std::max<epoch_t>(sub->next, s->osd_epoch + 1);
+      if (first < get_first_committed() || first > osdmap.get_epoch()) {
+	check_osdmap_sub(sub);
+	continue;
+      }
+    }
+    groups[std::make_tuple(first, s->con_features, sub->incremental_onetime)]
+      .push_back(sub);
+  }
+  for (auto& [key, subs] : groups) {
+    auto [first, features, onetime] = key;
+    if (subs.size() == 1) {
+      check_osdmap_sub(subs.front());
+    } else {
+      send_osdmap_shared(first, features, onetime, subs);
+    }
+  }
+}
+
+/**
+ * Encode @p m once for @p features and send a copy to every session in
+ * @p subs.  The copies share @p m's payload and map buffers; the map
+ * contents are kept too so that loopback delivery sees a complete message.
+ */
+static void send_encoded_osdmap(MOSDMap *m, uint64_t features,
+				const vector<Subscription*>& subs)
+{
+  m->encode_payload(features);
+  for (auto sub : subs) {
+    MOSDMap *c = new MOSDMap(m->fsid, m->encode_features);
+    c->maps = m->maps;
+    c->incremental_maps = m->incremental_maps;
+    c->oldest_map = m->oldest_map;
+    c->newest_map = m->newest_map;
+    c->set_header(m->get_header());
+    bufferlist payload = m->get_payload();
+    c->set_payload(payload);
+    sub->session->con->send_message(c);
+  }
+  m->put();
+}
+
+void OSDMonitor::send_osdmap_shared(epoch_t first, uint64_t features,
+				    bool onetime,
+				    const vector<Subscription*>& subs)
+{
+  dout(5) << __func__ << " [" << first << ".." << osdmap.get_epoch() << "]"
+	  << " to " << subs.size() << " subscribers with features "
+	  << std::hex << features << std::dec << dendl;
+  if (first == 0) {
+    // build_latest_full() notes the demand of one of them
+    note_osdmap_feature_demand(features, subs.size() - 1);
+    send_encoded_osdmap(build_latest_full(features), features, subs);
+  } else {
+    note_osdmap_feature_demand(features, subs.size());
+    while (first <= osdmap.get_epoch()) {
+      epoch_t last = std::min<epoch_t>(first + g_conf()->osd_map_message_max - 1,
+				       osdmap.get_epoch());
+      send_encoded_osdmap(build_incremental(first, last, features), features,
+			  subs);
+      for (auto sub : subs) {
+	sub->session->osd_epoch = last;
+      }
+      first = last + 1;
+      if (onetime)
+	break;
+    }
+  }
+  for (auto sub : subs) {
+    if (sub->onetime)
+      mon.session_map.remove_sub(sub);
+    else
+      sub->next = osdmap.get_epoch() + 1;
   }
 }
 
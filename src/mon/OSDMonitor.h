@@ -231,6 +231,21 @@ public:
   osdmap_cache_t inc_osd_cache;
   osdmap_cache_t full_osd_cache;
 
+  // Both caches are keyed by the significant features a map was
+  // (re)encoded with, masked by the features it was stored with, so that
+  // every peer whose feature bits don't change the encoding shares the
+  // stored buffers.  Remember the stored features of recent epochs.
+  SimpleLRU<version_t, uint64_t> osdmap_encode_features;
+  // decayed count of map requests by significant feature set; the most
+  // common ones get each new epoch pre-encoded at commit time
+  std::map<uint64_t, uint64_t> osdmap_feature_demand;
+
+  uint64_t get_osdmap_cache_features(version_t ver, uint64_t features);
+  void note_osdmap_feature_demand(uint64_t features, uint64_t n = 1) {
+    osdmap_feature_demand[OSDMap::get_significant_features(features)] += n;
+  }
+  void preencode_osdmap(epoch_t e);
+
   bool has_osdmap_manifest;
   osdmap_manifest_t osdmap_manifest;
 
@@ -756,6 +771,8 @@ public:
   void print_nodes(ceph::Formatter *f);
 
   void check_osdmap_sub(Subscription *sub);
+  void send_osdmap_shared(epoch_t first, uint64_t features, bool onetime,
+			  const std::vector<Subscription*>& subs);
   void check_pg_creates_sub(Subscription *sub);
 
   void do_application_enable(int64_t pool_id, const std::string &app_name,
@@ -1137,7 +1137,13 @@ void PGMap::apply_incremental(CephContext *cct, const Incremental& inc)
     pool_stat_t &pool_sum_ref = pg_pool_sum[update_pool];
     if (pg_stat_iter == pg_stat.end()) {
       pg_stat.insert(make_pair(update_pg, update_stat));
+      stat_purged_snaps(update_pool, update_stat, 1);
     } else {
+      if ((pg_stat_iter->second.state == 0) != (update_stat.state == 0) ||
+	  !(pg_stat_iter->second.purged_snaps == update_stat.purged_snaps)) {
+	stat_purged_snaps(update_pool, pg_stat_iter->second, -1);
+	stat_purged_snaps(update_pool, update_stat, 1);
+      }
       stat_pg_sub(update_pg, pg_stat_iter->second);
       pool_sum_ref.sub(pg_stat_iter->second);
       pg_stat_iter->second = update_stat;
@@ -1198,6 +1204,7 @@ void PGMap::apply_incremental(CephContext *cct, const Incremental& inc)
         pool_stats_it->second.sub(s->second);
       }
 
+      stat_purged_snaps(removed_pg.pool(), s->second, -1);
       pg_stat.erase(s);
       if (pool_erased) {
         deleted_pools.insert(removed_pg.pool());
@@ -1213,10 +1220,12 @@ void PGMap::apply_incremental(CephContext *cct, const Incremental& inc)
       stat_osd_sub(t->first, t->second);
       osd_stat.erase(t);
     }
-    for (auto i = pool_statfs.begin();  i != pool_statfs.end(); ++i) {
+    for (auto i = pool_statfs.begin();  i != pool_statfs.end();) {
       if (i->first.second == *p) {
 	pg_pool_sum[i->first.first].sub(i->second);
-	pool_statfs.erase(i);
+	i = pool_statfs.erase(i);
+      } else {
+	++i;
       }
     }
   }
@@ -1271,12 +1280,19 @@ void PGMap::calc_stats()
   num_pg_by_state.clear();
   num_pg_by_pool_state.clear();
   num_pg_by_osd.clear();
+  purged_snaps_by_pool.clear();
+  // drop the pools that no longer have any pgs, too
+  for (auto& p : purged_snaps) {
+    purged_snaps_dirty.insert(p.first);
+  }
+  pg_health_candidates.clear();
 
   for (auto p = pg_stat.begin();
        p != pg_stat.end();
        ++p) {
     auto pg = p->first;
     stat_pg_add(pg, p->second);
+    stat_purged_snaps(pg.pool(), p->second, 1);
     pg_pool_sum[pg.pool()].add(p->second);
   }
   for (auto p = pool_statfs.begin();
@@ -1316,6 +1332,9 @@ void PGMap::stat_pg_add(const pg_t &pgid, const pg_stat_t &s,
   if (s.state == 0) {
     ++num_pg_unknown;
   }
+  if (is_pg_health_candidate(s)) {
+    pg_health_candidates.insert(pgid);
+  }
 
   if (sameosds)
     return;
@@ -1381,6 +1400,9 @@ bool PGMap::stat_pg_sub(const pg_t &pgid, const pg_stat_t &s,
   if (s.state == 0) {
     --num_pg_unknown;
   }
+  if (is_pg_health_candidate(s)) {
+    pg_health_candidates.erase(pgid);
+  }
 
   if (sameosds)
     return pool_erased;
@@ -1426,26 +1448,61 @@ bool PGMap::stat_pg_sub(const pg_t &pgid, const pg_stat_t &s,
   return pool_erased;
 }
 
+void PGMap::stat_purged_snaps(int64_t pool, const pg_stat_t &s, int delta)
+{
+  purged_snaps_dirty.insert(pool);
+  auto& pps = purged_snaps_by_pool[pool];
+  if (s.state == 0) {
+    pps.num_unknown += delta;
+  } else {
+    pps.num_known += delta;
+    auto bump = [&pps](snapid_t snap, int32_t d) {
+      auto i = pps.bounds.emplace(snap, 0).first;
+      i->second += d;
+      if (i->second == 0) {
+	pps.bounds.erase(i);
+      }
+    };
+    for (auto p = s.purged_snaps.begin(); p != s.purged_snaps.end(); ++p) {
+      bump(p.get_start(), delta);
+      bump(p.get_start() + p.get_len(), -delta);
+    }
+  }
+  ceph_assert(pps.num_known >= 0 && pps.num_unknown >= 0);
+  if (pps.num_known == 0 && pps.num_unknown == 0) {
+    ceph_assert(pps.bounds.empty());
+    purged_snaps_by_pool.erase(pool);
+  }
+}
+
 void PGMap::calc_purged_snaps()
 {
-  purged_snaps.clear();
-  set<int64_t> unknown;
-  for (auto& i : pg_stat) {
-    if (i.second.state == 0) {
-      unknown.insert(i.first.pool());
-      purged_snaps.erase(i.first.pool());
-      continue;
-    } else if (unknown.count(i.first.pool())) {
+  // rebuild the intersection of only the pools whose pgs changed, from the
+  // counts kept by stat_purged_snaps(); this doesn't look at pg_stat
+  for (auto pool : purged_snaps_dirty) {
+    auto i = purged_snaps_by_pool.find(pool);
+    if (i == purged_snaps_by_pool.end() ||
+	i->second.num_unknown > 0 ||
+	i->second.num_known == 0) {
+      purged_snaps.erase(pool);
       continue;
     }
-    auto j = purged_snaps.find(i.first.pool());
-    if (j == purged_snaps.end()) {
-      // base case
-      purged_snaps[i.first.pool()] = i.second.purged_snaps;
-    } else {
-      j->second.intersection_of(i.second.purged_snaps);
+    const auto& pps = i->second;
+    interval_set<snapid_t> r;
+    int32_t depth = 0;
+    snapid_t start;
+    for (auto& [snap, d] : pps.bounds) {
+      const bool in_all = depth == pps.num_known;
+      depth += d;
+      if (!in_all && depth == pps.num_known) {
+	start = snap;
+      } else if (in_all && depth != pps.num_known) {
+	r.insert(start, snap - start);
+      }
     }
+    purged_snaps[pool] = std::move(r);
   }
+  purged_snaps_dirty.clear();
 }
 
 void PGMap::calc_osd_sum_by_class(const OSDMap& osdmap)
@@ -2433,10 +2490,6 @@ void PGMap::get_health_checks(
     // Map of PG_STATE_* to number of pgs in that state.
     std::map<unsigned, unsigned> states;
 
-    // List of all PG IDs that had a state contributing
-    // to this health condition.
-    std::set<pg_t> pgs;
-
     std::map<pg_t, std::string> pg_messages;
   };
 
@@ -2502,13 +2555,16 @@ void PGMap::get_health_checks(
   }
 
   utime_t cutoff = now - utime_t(cct->_conf.get_val<int64_t>("mon_pg_stuck_threshold"), 0);
-  // Loop over all PGs, if there are any possibly-unhealthy states in there
+  // Loop over the PGs that may be unhealthy, if there are any
+  // possibly-unhealthy states in there.  pg_health_candidates is kept up
+  // to date as pg stats are applied, so this only walks the PGs in an
+  // interesting state rather than every PG; stuckness still depends on
+  // the current time and is evaluated here.
   if (!possible_responses.empty()) {
-    for (const auto& i : pg_stat) {
-      const auto &pg_id = i.first;
-      const auto &pg_info = i.second;
+    for (const auto& pg_id : pg_health_candidates) {
+      const auto &pg_info = pg_stat.at(pg_id);
 
-      for (const auto &j : state_to_response) {
+      for (const auto &j : possible_responses) {
         const auto &pg_response_state = j.first;
         const auto &pg_response = j.second;
 
@@ -2535,7 +2591,6 @@ void PGMap::get_health_checks(
 
         auto &causes = detected[pg_response.consequence];
         causes.states[pg_response_state]++;
-        causes.pgs.insert(pg_id);
 
         // Don't bother composing detail string if we have already recorded
         // too many
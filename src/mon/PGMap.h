@@ -309,6 +309,39 @@ public:
 
   utime_t stamp;
 
+  // per pool, the number of pgs with a known state that have purged each
+  // snap, kept as +1/-1 at the bounds of every pg's purged_snaps intervals.
+  // a pool's purged_snaps are the ranges covered by all of its known pgs,
+  // unless some pg is unknown (soft state, maintained by
+  // stat_purged_snaps())
+  struct pool_purged_snaps_t {
+    mempool::pgmap::map<snapid_t,int32_t> bounds;
+    int32_t num_known = 0;
+    int32_t num_unknown = 0;
+  };
+  mempool::pgmap::unordered_map<int64_t,pool_purged_snaps_t> purged_snaps_by_pool;
+  // pools whose purged_snaps must be rebuilt from purged_snaps_by_pool
+  std::set<int64_t> purged_snaps_dirty;
+
+  // pgs whose state can raise a PG_* health check (soft state, maintained by
+  // stat_pg_add/sub), so get_health_checks() need not walk every pg
+  mempool::pgmap::set<pg_t> pg_health_candidates;
+  static bool is_pg_health_candidate(const pg_stat_t& s) {
+    return !(s.state & PG_STATE_ACTIVE) ||
+      (s.state & (PG_STATE_INCONSISTENT |
+		  PG_STATE_INCOMPLETE |
+		  PG_STATE_SNAPTRIM_ERROR |
+		  PG_STATE_RECOVERY_UNFOUND |
+		  PG_STATE_BACKFILL_UNFOUND |
+		  PG_STATE_BACKFILL_TOOFULL |
+		  PG_STATE_RECOVERY_TOOFULL |
+		  PG_STATE_DEGRADED |
+		  PG_STATE_DOWN |
+		  PG_STATE_PEERING |
+		  PG_STATE_UNDERSIZED |
+		  PG_STATE_STALE));
+  }
+
   void update_pool_deltas(
     CephContext *cct,
     const utime_t ts,
@@ -424,6 +457,7 @@ public:
 		   bool sameosds=false);
   bool stat_pg_sub(const pg_t &pgid, const pg_stat_t &s,
 		   bool sameosds=false);
+  void stat_purged_snaps(int64_t pool, const pg_stat_t &s, int delta);
   void calc_purged_snaps();
   void calc_osd_sum_by_class(const OSDMap& osdmap);
   void stat_osd_add(int osd, const osd_stat_t &s);
@@ -132,10 +132,63 @@ void Paxos::init_logger()
   pcb.add_u64_avg(l_paxos_share_state_bytes, "share_state_bytes", "Data in shared state", NULL, 0, unit_t(UNIT_BYTES));
   pcb.add_u64_counter(l_paxos_new_pn, "new_pn", "New proposal number queries");
   pcb.add_time_avg(l_paxos_new_pn_latency, "new_pn_latency", "New proposal number getting latency");
+  pcb.add_time_avg(l_paxos_accept_latency, "accept_latency",
+		   "Latency from sending begin until the whole quorum accepted");
+  pcb.add_time_avg(l_paxos_proposal_latency, "proposal_latency",
+		   "Latency of a whole proposal round, from begin to finish");
+
+  // Latency axis for the per-phase histograms, values are in nanoseconds
+  PerfHistogramCommon::axis_config_d lat_hist_x_axis_config{
+    "Latency (usec)",
+    PerfHistogramCommon::SCALE_LOG2, ///< Latency in logarithmic scale
+    0,                               ///< Start at 0
+    100000,                          ///< Quantization unit is 100usec
+    20,                              ///< Enough to cover well past mon_lease
+  };
+  // Size axis for the per-phase histograms, values are in bytes
+  PerfHistogramCommon::axis_config_d lat_hist_y_axis_config{
+    "Value size (bytes)",
+    PerfHistogramCommon::SCALE_LOG2, ///< Value size in logarithmic scale
+    0,                               ///< Start at 0
+    4096,                            ///< Quantization unit is 4KB
+    16,                              ///< Enough to cover values larger than 64MB
+  };
+  pcb.add_u64_counter_histogram(
+    l_paxos_begin_latency_histogram, "begin_latency_histogram",
+    lat_hist_x_axis_config, lat_hist_y_axis_config,
+    "Histogram of begin persist latency vs value size");
+  pcb.add_u64_counter_histogram(
+    l_paxos_accept_latency_histogram, "accept_latency_histogram",
+    lat_hist_x_axis_config, lat_hist_y_axis_config,
+    "Histogram of quorum accept latency vs value size");
+  pcb.add_u64_counter_histogram(
+    l_paxos_commit_latency_histogram, "commit_latency_histogram",
+    lat_hist_x_axis_config, lat_hist_y_axis_config,
+    "Histogram of commit persist latency vs value size");
+  pcb.add_u64_counter_histogram(
+    l_paxos_refresh_latency_histogram, "refresh_latency_histogram",
+    lat_hist_x_axis_config, lat_hist_y_axis_config,
+    "Histogram of refresh latency vs committed value size");
+  pcb.add_u64_counter_histogram(
+    l_paxos_proposal_latency_histogram, "proposal_latency_histogram",
+    lat_hist_x_axis_config, lat_hist_y_axis_config,
+    "Histogram of whole proposal round latency vs value size");
+  pcb.add_u64_counter(l_paxos_commit_erase_keys, "commit_erase_keys",
+		      "Single key deletions (tombstones) in committed transactions");
+  pcb.add_u64_counter(l_paxos_commit_erase_ranges, "commit_erase_ranges",
+		      "Range deletions in committed transactions");
   logger = pcb.create_perf_counters();
   g_ceph_context->get_perfcounters_collection()->add(logger);
 }
 
+void Paxos::note_erases(MonitorDBStore::TransactionRef t)
+{
+  uint64_t erases, ranges;
+  t->count_erases(&erases, &ranges);
+  logger->inc(l_paxos_commit_erase_keys, erases);
+  logger->inc(l_paxos_commit_erase_ranges, ranges);
+}
+
 void Paxos::dump_info(Formatter *f)
 {
   f->open_object_section("paxos");
@@ -440,12 +493,14 @@ bool Paxos::store_state(MMonPaxos *m)
     logger->inc(l_paxos_store_state);
     logger->inc(l_paxos_store_state_bytes, t->get_bytes());
     logger->inc(l_paxos_store_state_keys, t->get_keys());
+    note_erases(t);
 
     auto start = ceph::coarse_mono_clock::now();
     get_store()->apply_transaction(t);
     auto end = ceph::coarse_mono_clock::now();
 
     logger->tinc(l_paxos_store_state_latency, to_timespan(end-start));
+    refresh_bytes = t->get_bytes();
 
     // refresh first_committed; this txn may have trimmed.
     first_committed = get_store()->get(get_name(), "first_committed");
@@ -668,11 +723,23 @@ void Paxos::begin(bufferlist& v)
   logger->inc(l_paxos_begin_keys, t->get_keys());
   logger->inc(l_paxos_begin_bytes, t->get_bytes());
 
+  // With paxos_pipeline_writes the begin goes out before we persist our own
+  // copy, so the peons' writes and the round trip overlap with ours.  This
+  // is safe: accepts are handled under mon.lock, so none can be counted
+  // before the apply_transaction() below has returned.
+  bool pipeline = g_conf().get_val<bool>("paxos_pipeline_writes");
+  accept_start_stamp = ceph_clock_now();
+  if (pipeline) {
+    send_begin();
+  }
+
   auto start = ceph::coarse_mono_clock::now();
   get_store()->apply_transaction(t);
   auto end = ceph::coarse_mono_clock::now();
 
   logger->tinc(l_paxos_begin_latency, to_timespan(end - start));
+  logger->hinc(l_paxos_begin_latency_histogram,
+	       to_timespan(end - start).count(), new_value.length());
 
   ceph_assert(g_conf()->paxos_kill_at != 3);
 
@@ -682,30 +749,38 @@ void Paxos::begin(bufferlist& v)
     return;
   }
 
+  if (!pipeline) {
+    accept_start_stamp = ceph_clock_now();
+    send_begin();
+  }
+
+  // set timeout event
+  accept_timeout_event = mon.timer.add_event_after(
+    g_conf()->mon_accept_timeout_factor * g_conf()->mon_lease,
+    new C_MonContext{&mon, [this](int r) {
+	if (r == -ECANCELED)
+	  return;
+	accept_timeout();
+      }});
+}
+
+void Paxos::send_begin()
+{
   // ask others to accept it too!
   for (auto p = mon.get_quorum().begin();
        p != mon.get_quorum().end();
        ++p) {
     if (*p == mon.rank) continue;
-    
+
     dout(10) << " sending begin to mon." << *p << dendl;
     MMonPaxos *begin = new MMonPaxos(mon.get_epoch(), MMonPaxos::OP_BEGIN,
 				     ceph_clock_now());
     begin->values[last_committed+1] = new_value;
     begin->last_committed = last_committed;
     begin->pn = accepted_pn;
-    
+
     mon.send_mon_message(begin, *p);
   }
-
-  // set timeout event
-  accept_timeout_event = mon.timer.add_event_after(
-    g_conf()->mon_accept_timeout_factor * g_conf()->mon_lease,
-    new C_MonContext{&mon, [this](int r) {
-	if (r == -ECANCELED)
-	  return;
-	accept_timeout();
-      }});
 }
 
 // peon
@@ -806,6 +881,10 @@ void Paxos::handle_accept(MonOpRequestRef op)
   if (accepted == mon.get_quorum()) {
     // yay, commit!
     dout(10) << " got majority, committing, done with update" << dendl;
+    utime_t lat = ceph_clock_now() - accept_start_stamp;
+    logger->tinc(l_paxos_accept_latency, lat);
+    logger->hinc(l_paxos_accept_latency_histogram, lat.to_nsec(),
+		 new_value.length());
     op->mark_paxos_event("commit_start");
     commit_start();
   }
@@ -868,10 +947,21 @@ void Paxos::commit_start()
   logger->inc(l_paxos_commit);
   logger->inc(l_paxos_commit_keys, t->get_keys());
   logger->inc(l_paxos_commit_bytes, t->get_bytes());
+  note_erases(t);
   commit_start_stamp = ceph_clock_now();
 
   get_store()->queue_transaction(t, new C_Committed(this));
 
+  // The whole quorum has accepted, so the value is chosen; with
+  // paxos_pipeline_writes the peons may start persisting it while our own
+  // commit is still queued.  Our state (and thus the next begin) does not
+  // move on until commit_finish().
+  commit_sent = false;
+  if (g_conf().get_val<bool>("paxos_pipeline_writes")) {
+    send_commit(last_committed + 1);
+    commit_sent = true;
+  }
+
   if (is_updating_previous())
     state = STATE_WRITING_PREVIOUS;
   else if (is_updating())
@@ -892,6 +982,8 @@ void Paxos::commit_finish()
   dout(20) << __func__ << " " << (last_committed+1) << dendl;
   utime_t end = ceph_clock_now();
   logger->tinc(l_paxos_commit_latency, end - commit_start_stamp);
+  logger->hinc(l_paxos_commit_latency_histogram,
+	       (end - commit_start_stamp).to_nsec(), new_value.length());
 
   ceph_assert(g_conf()->paxos_kill_at != 8);
 
@@ -909,24 +1001,14 @@ void Paxos::commit_finish()
   _sanity_check_store();
 
   // tell everyone
-  for (auto p = mon.get_quorum().begin();
-       p != mon.get_quorum().end();
-       ++p) {
-    if (*p == mon.rank) continue;
-
-    dout(10) << " sending commit to mon." << *p << dendl;
-    MMonPaxos *commit = new MMonPaxos(mon.get_epoch(), MMonPaxos::OP_COMMIT,
-				      ceph_clock_now());
-    commit->values[last_committed] = new_value;
-    commit->pn = accepted_pn;
-    commit->last_committed = last_committed;
-
-    mon.send_mon_message(commit, *p);
+  if (!commit_sent) {
+    send_commit(last_committed);
   }
 
   ceph_assert(g_conf()->paxos_kill_at != 9);
 
   // get ready for a new round.
+  refresh_bytes = new_value.length();
   new_value.clear();
 
   // WRITING -> REFRESH
@@ -950,6 +1032,23 @@ void Paxos::commit_finish()
   }
 }
 
+void Paxos::send_commit(version_t v)
+{
+  for (auto p = mon.get_quorum().begin();
+       p != mon.get_quorum().end();
+       ++p) {
+    if (*p == mon.rank) continue;
+
+    dout(10) << " sending commit to mon." << *p << dendl;
+    MMonPaxos *commit = new MMonPaxos(mon.get_epoch(), MMonPaxos::OP_COMMIT,
+				      ceph_clock_now());
+    commit->values[v] = new_value;
+    commit->pn = accepted_pn;
+    commit->last_committed = v;
+
+    mon.send_mon_message(commit, *p);
+  }
+}
 
 void Paxos::handle_commit(MonOpRequestRef op)
 {
@@ -1052,6 +1151,9 @@ bool Paxos::do_refresh()
 
   logger->inc(l_paxos_refresh);
   logger->tinc(l_paxos_refresh_latency, to_timespan(end - start));
+  logger->hinc(l_paxos_refresh_latency_histogram,
+	       to_timespan(end - start).count(), refresh_bytes);
+  refresh_bytes = 0;
 
   if (need_bootstrap) {
     dout(10) << " doing requested bootstrap" << dendl;
@@ -1079,6 +1181,14 @@ void Paxos::finish_round()
   // ok, now go active!
   state = STATE_ACTIVE;
 
+  if (proposal_start_stamp != utime_t()) {
+    utime_t lat = ceph_clock_now() - proposal_start_stamp;
+    logger->tinc(l_paxos_proposal_latency, lat);
+    logger->hinc(l_paxos_proposal_latency_histogram, lat.to_nsec(),
+		 proposal_bytes);
+    proposal_start_stamp = utime_t();
+  }
+
   dout(20) << __func__ << " waiting_for_acting" << dendl;
   finish_contexts(g_ceph_context, waiting_for_active);
   dout(20) << __func__ << " waiting_for_readable" << dendl;
@@ -1244,9 +1354,14 @@ void Paxos::trim()
 
   MonitorDBStore::TransactionRef t = get_pending_transaction();
 
-  for (version_t v = first_committed; v < end; ++v) {
-    dout(10) << "trim " << v << dendl;
-    t->erase(get_name(), v);
+  if (g_conf().get_val<bool>("mon_trim_range_delete")) {
+    // last_committed+1 is stored by begin() before this commits
+    t->erase_versions(get_name(), "", first_committed, end, last_committed + 1);
+  } else {
+    for (version_t v = first_committed; v < end; ++v) {
+      dout(10) << "trim " << v << dendl;
+      t->erase(get_name(), v);
+    }
   }
   t->put(get_name(), "first_committed", end);
   if (g_conf()->mon_compact_on_trim) {
@@ -1549,6 +1664,8 @@ void Paxos::propose_pending()
 
   committing_finishers.swap(pending_finishers);
   state = STATE_UPDATING;
+  proposal_start_stamp = ceph_clock_now();
+  proposal_bytes = bl.length();
   begin(bl);
 }
 
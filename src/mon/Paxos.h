@@ -156,6 +156,15 @@ enum {
   l_paxos_share_state_bytes,
   l_paxos_new_pn,
   l_paxos_new_pn_latency,
+  l_paxos_accept_latency,
+  l_paxos_proposal_latency,
+  l_paxos_begin_latency_histogram,
+  l_paxos_accept_latency_histogram,
+  l_paxos_commit_latency_histogram,
+  l_paxos_refresh_latency_histogram,
+  l_paxos_proposal_latency_histogram,
+  l_paxos_commit_erase_keys,
+  l_paxos_commit_erase_ranges,
   l_paxos_last,
 };
 
@@ -185,6 +194,8 @@ class Paxos {
   PerfCounters *logger;
 
   void init_logger();
+  /// account the deletions @p t leaves behind in the store
+  void note_erases(MonitorDBStore::TransactionRef t);
 
   // my state machine info
   const std::string paxos_name;
@@ -806,6 +817,10 @@ private:
    * @param value The value being proposed to the quorum
    */
   void begin(ceph::buffer::list& value);
+  /**
+   * Send OP_BEGIN for new_value to every other quorum member.
+   */
+  void send_begin();
   /**
    * Accept or decline (by ignoring) a proposal from the Leader.
    *
@@ -873,6 +888,16 @@ private:
 
 
   utime_t commit_start_stamp;
+  /// when the current round's begin was sent out to the quorum
+  utime_t accept_start_stamp;
+  /// when the current round was started by propose_pending()
+  utime_t proposal_start_stamp;
+  /// size of the proposal started at proposal_start_stamp
+  uint64_t proposal_bytes = 0;
+  /// size of the value(s) the next do_refresh() will load, for the histogram
+  uint64_t refresh_bytes = 0;
+  /// whether commit_start() already sent OP_COMMIT to the quorum
+  bool commit_sent = false;
   friend struct C_Committed;
 
   /**
@@ -890,6 +915,10 @@ private:
    */
   void commit_start();
   void commit_finish();   ///< finish a commit after txn becomes durable
+  /**
+   * Send OP_COMMIT for new_value as version @p v to every other quorum member.
+   */
+  void send_commit(version_t v);
   void abort_commit();    ///< Handle commit finish after shutdown started
   /**
    * Commit the new value to stable storage as being the latest available
@@ -432,14 +432,28 @@ void PaxosService::trim(MonitorDBStore::TransactionRef t,
   dout(10) << __func__ << " from " << from << " to " << to << dendl;
   ceph_assert(from != to);
 
-  for (version_t v = from; v < to; ++v) {
-    dout(20) << __func__ << " " << v << dendl;
-    t->erase(get_service_name(), v);
-
-    string full_key = mon.store->combine_strings("full", v);
-    if (mon.store->exists(get_service_name(), full_key)) {
-      dout(20) << __func__ << " " << full_key << dendl;
-      t->erase(get_service_name(), full_key);
+  if (g_conf().get_val<bool>("mon_trim_range_delete")) {
+    // the pending proposal may already carry our next version
+    version_t last = get_last_committed() + 1;
+    t->erase_versions(get_service_name(), "", from, to, last);
+    t->erase_versions(get_service_name(),
+		      mon.store->combine_strings(full_prefix_name, ""),
+		      from, to, last,
+		      [this](version_t v) {
+			return mon.store->exists(
+			  get_service_name(),
+			  mon.store->combine_strings(full_prefix_name, v));
+		      });
+  } else {
+    for (version_t v = from; v < to; ++v) {
+      dout(20) << __func__ << " " << v << dendl;
+      t->erase(get_service_name(), v);
+
+      string full_key = mon.store->combine_strings("full", v);
+      if (mon.store->exists(get_service_name(), full_key)) {
+	dout(20) << __func__ << " " << full_key << dendl;
+	t->erase(get_service_name(), full_key);
+      }
     }
   }
   if (g_conf()->mon_compact_on_trim) {
@@ -74,6 +74,7 @@ struct MonSession : public RefCountedObject {
   std::string remote_host;                ///< remote host name
   std::map<std::string,std::string,std::less<>> last_config;    ///< most recently shared config
   bool any_config = false;
+  bool config_diff = false;    ///< client takes incremental MConfig
 
   MonSession(Connection *c)
     : RefCountedObject(g_ceph_context),
@@ -172,17 +172,22 @@ struct health_check_map_t {
     return r;
   }
 
-  void merge(const health_check_map_t& o) {
+  /// @param with_detail false to leave the (possibly long) detail lists out
+  void merge(const health_check_map_t& o, bool with_detail = true) {
     for (auto& [code, check] : o.checks) {
-      auto [it, new_check] = checks.try_emplace(code, check);
-      if (!new_check) {
-        // merge details, and hope the summary matches!
+      auto [it, new_check] = checks.try_emplace(code);
+      if (new_check) {
+        it->second.severity = check.severity;
+        it->second.summary = check.summary;
+      }
+      // merge details, and hope the summary matches!
+      if (with_detail) {
         it->second.detail.insert(
           it->second.detail.end(),
           check.detail.begin(),
           check.detail.end());
-        it->second.count += check.count;
       }
+      it->second.count += check.count;
     }
   }
 
@@ -31,11 +31,14 @@ using ceph::ref_t;
 #define dout_prefix *_dout << "-- " << msgr->get_myaddrs() << " "
 
 double DispatchQueue::get_max_age(utime_t now) const {
-  std::lock_guard l{lock};
-  if (marrival.empty())
-    return 0;
-  else
-    return (now - marrival.begin()->first);
+  double max_age = 0;
+  for (auto& lane : lanes) {
+    std::lock_guard l{lane->lock};
+    if (!lane->marrival.empty())
+      max_age = std::max<double>(max_age,
+				 now - lane->marrival.begin()->first);
+  }
+  return max_age;
 }
 
 uint64_t DispatchQueue::pre_dispatch(const ref_t<Message>& m)
@@ -82,18 +85,19 @@ void DispatchQueue::fast_preprocess(const ref_t<Message>& m)
 
 void DispatchQueue::enqueue(const ref_t<Message>& m, int priority, uint64_t id)
 {
-  std::lock_guard l{lock};
+  Lane& lane = get_lane(m->get_connection().get());
+  std::lock_guard l{lane.lock};
   if (stop) {
     return;
   }
   ldout(cct,20) << "queue " << m << " prio " << priority << dendl;
-  add_arrival(m);
+  lane.add_arrival(m);
   if (priority >= CEPH_MSG_PRIO_LOW) {
-    mqueue.enqueue_strict(id, priority, QueueItem(m));
+    lane.mqueue.enqueue_strict(id, priority, QueueItem(m));
   } else {
-    mqueue.enqueue(id, priority, m->get_cost(), QueueItem(m));
+    lane.mqueue.enqueue(id, priority, m->get_cost(), QueueItem(m));
   }
-  cond.notify_all();
+  lane.cond.notify_all();
 }
 
 void DispatchQueue::local_delivery(const ref_t<Message>& m, int priority)
@@ -153,14 +157,15 @@ void DispatchQueue::dispatch_throttle_release(uint64_t msize)
  * end of the queue. If the queue is empty; it's removed.
  * The message is then delivered and the process starts again.
  */
-void DispatchQueue::entry()
+void DispatchQueue::entry(unsigned lane_idx)
 {
-  std::unique_lock l{lock};
+  Lane& lane = *lanes[lane_idx];
+  std::unique_lock l{lane.lock};
   while (true) {
-    while (!mqueue.empty()) {
-      QueueItem qitem = mqueue.dequeue();
+    while (!lane.mqueue.empty()) {
+      QueueItem qitem = lane.mqueue.dequeue();
       if (!qitem.is_code())
-	remove_arrival(qitem.get_message());
+	lane.remove_arrival(qitem.get_message());
       l.unlock();
 
       if (qitem.is_code()) {
@@ -209,34 +214,56 @@ void DispatchQueue::entry()
       break;
 
     // wait for something to be put on queue
-    cond.wait(l);
+    lane.cond.wait(l);
   }
 }
 
 void DispatchQueue::discard_queue(uint64_t id) {
-  std::lock_guard l{lock};
-  std::list<QueueItem> removed;
-  mqueue.remove_by_class(id, &removed);
-  for (auto i = removed.begin(); i != removed.end(); ++i) {
-    ceph_assert(!(i->is_code())); // We don't discard id 0, ever!
-    const ref_t<Message>& m = i->get_message();
-    remove_arrival(m);
-    dispatch_throttle_release(m->get_dispatch_throttle_size());
+  // the queue id is not tied to a lane, so check all of them
+  for (auto& lane : lanes) {
+    std::lock_guard l{lane->lock};
+    std::list<QueueItem> removed;
+    lane->mqueue.remove_by_class(id, &removed);
+    for (auto i = removed.begin(); i != removed.end(); ++i) {
+      ceph_assert(!(i->is_code())); // We don't discard id 0, ever!
+      const ref_t<Message>& m = i->get_message();
+      lane->remove_arrival(m);
+      dispatch_throttle_release(m->get_dispatch_throttle_size());
+    }
+  }
+}
+
+void DispatchQueue::set_num_lanes(unsigned n)
+{
+  ceph_assert(n > 0);
+  ceph_assert(!is_started());
+  ldout(cct, 10) << __func__ << " " << n << dendl;
+  while (lanes.size() > n) {
+    ceph_assert(lanes.back()->mqueue.empty());
+    lanes.pop_back();
+  }
+  while (lanes.size() < n) {
+    lanes.emplace_back(std::make_unique<Lane>(cct, this, name, lanes.size()));
   }
 }
 
 void DispatchQueue::start()
 {
   ceph_assert(!stop);
-  ceph_assert(!dispatch_thread.is_started());
-  dispatch_thread.create("ms_dispatch");
+  ceph_assert(!is_started());
+  for (unsigned i = 0; i < lanes.size(); ++i) {
+    lanes[i]->dispatch_thread.create(
+      i ? ("ms_dispatch_" + std::to_string(i)).c_str() : "ms_dispatch");
+  }
   local_delivery_thread.create("ms_local");
 }
 
 void DispatchQueue::wait()
 {
   local_delivery_thread.join();
-  dispatch_thread.join();
+  for (auto& lane : lanes) {
+    lane->dispatch_thread.join();
+  }
 }
 
 void DispatchQueue::discard_local()
@@ -252,10 +279,10 @@ void DispatchQueue::shutdown()
     stop_local_delivery = true;
     local_delivery_cond.notify_all();
   }
-  // stop my dispatch thread
-  {
-    std::scoped_lock l{lock};
-    stop = true;
-    cond.notify_all();
+  // stop my dispatch threads
+  stop = true;
+  for (auto& lane : lanes) {
+    std::scoped_lock l{lane->lock};
+    lane->cond.notify_all();
   }
 }
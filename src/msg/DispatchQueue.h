@@ -17,7 +17,9 @@
 
 #include <atomic>
 #include <map>
+#include <memory>
 #include <queue>
+#include <vector>
 #include <boost/intrusive_ptr.hpp>
 #include "include/ceph_assert.h"
 #include "include/common_fwd.h"
@@ -34,7 +36,8 @@ struct Connection;
 /**
  * The DispatchQueue contains all the connections which have Messages
  * they want to be dispatched, carefully organized by Message priority
- * and permitted to deliver in a round-robin fashion.
+ * and permitted to deliver in a round-robin fashion.  Connections are
+ * sharded over one or more lanes, each served by its own dispatch thread.
  * See Messenger::dispatch_entry for details.
  */
 class DispatchQueue {
@@ -64,44 +67,86 @@ class DispatchQueue {
 
   CephContext *cct;
   Messenger *msgr;
-  mutable ceph::mutex lock;
-  ceph::condition_variable cond;
-
-  PrioritizedQueue<QueueItem, uint64_t> mqueue;
-
-  std::set<std::pair<double, ceph::ref_t<Message>>> marrival;
-  std::map<ceph::ref_t<Message>, decltype(marrival)::iterator> marrival_map;
-  void add_arrival(const ceph::ref_t<Message>& m) {
-    marrival_map.insert(
-      make_pair(
-	m,
-	marrival.insert(std::make_pair(m->get_recv_stamp(), m)).first
-	)
-      );
-  }
-  void remove_arrival(const ceph::ref_t<Message>& m) {
-    auto it = marrival_map.find(m);
-    ceph_assert(it != marrival_map.end());
-    marrival.erase(it->second);
-    marrival_map.erase(it);
-  }
-
-  std::atomic<uint64_t> next_id;
-
-  enum { D_CONNECT = 1, D_ACCEPT, D_BAD_REMOTE_RESET, D_BAD_RESET, D_CONN_REFUSED, D_NUM_CODES };
+  std::string name;
 
   /**
-   * The DispatchThread runs dispatch_entry to empty out the dispatch_queue.
+   * The DispatchThread runs dispatch_entry to empty out one lane of the
+   * dispatch_queue.
    */
   class DispatchThread : public Thread {
     DispatchQueue *dq;
+    unsigned lane;
   public:
-    explicit DispatchThread(DispatchQueue *dq) : dq(dq) {}
+    DispatchThread(DispatchQueue *dq, unsigned lane) : dq(dq), lane(lane) {}
     void *entry() override {
-      dq->entry();
+      dq->entry(lane);
       return 0;
     }
-  } dispatch_thread;
+  };
+
+  /**
+   * A Lane is an independent prioritized queue with its own lock and
+   * dispatch thread.  Connections are sharded across lanes, so all of the
+   * messages and events of a given connection are delivered in order by
+   * the same thread, while unrelated connections do not contend.
+   */
+  struct Lane {
+    mutable ceph::mutex lock;
+    ceph::condition_variable cond;
+
+    PrioritizedQueue<QueueItem, uint64_t> mqueue;
+
+    std::set<std::pair<double, ceph::ref_t<Message>>> marrival;
+    std::map<ceph::ref_t<Message>, decltype(marrival)::iterator> marrival_map;
+    void add_arrival(const ceph::ref_t<Message>& m) {
+      marrival_map.insert(
+	make_pair(
+	  m,
+	  marrival.insert(std::make_pair(m->get_recv_stamp(), m)).first
+	  )
+	);
+    }
+    void remove_arrival(const ceph::ref_t<Message>& m) {
+      auto it = marrival_map.find(m);
+      ceph_assert(it != marrival_map.end());
+      marrival.erase(it->second);
+      marrival_map.erase(it);
+    }
+
+    DispatchThread dispatch_thread;
+
+    Lane(CephContext *cct, DispatchQueue *dq, const std::string& name,
+	 unsigned idx)
+      : lock(ceph::make_mutex("Messenger::DispatchQueue::lock" + name +
+			      (idx ? "-" + std::to_string(idx) : ""))),
+	mqueue(cct->_conf->ms_pq_max_tokens_per_priority,
+	       cct->_conf->ms_pq_min_cost),
+	dispatch_thread(dq, idx) {}
+  };
+  std::vector<std::unique_ptr<Lane>> lanes;
+
+  Lane& get_lane(const Connection *con) {
+    if (lanes.size() == 1)
+      return *lanes[0];
+    uint64_t h = reinterpret_cast<uintptr_t>(con) * 0x9e3779b97f4a7c15ull;
+    return *lanes[(h >> 32) % lanes.size()];
+  }
+
+  std::atomic<uint64_t> next_id;
+
+  enum { D_CONNECT = 1, D_ACCEPT, D_BAD_REMOTE_RESET, D_BAD_RESET, D_CONN_REFUSED, D_NUM_CODES };
+
+  void queue_code(int code, Connection *con) {
+    Lane& lane = get_lane(con);
+    std::lock_guard l{lane.lock};
+    if (stop)
+      return;
+    lane.mqueue.enqueue_strict(
+      0,
+      CEPH_MSG_PRIO_HIGHEST,
+      QueueItem(code, con));
+    lane.cond.notify_all();
+  }
 
   ceph::mutex local_delivery_lock;
   ceph::condition_variable local_delivery_cond;
@@ -125,7 +170,7 @@ class DispatchQueue {
   /// Throttle preventing us from building up a big backlog waiting for dispatch
   Throttle dispatch_throttler;
 
-  bool stop;
+  std::atomic<bool> stop;
   void local_delivery(const ceph::ref_t<Message>& m, int priority);
   void local_delivery(Message* m, int priority) {
     return local_delivery(ceph::ref_t<Message>(m, false), priority); /* consume ref */
@@ -135,8 +180,12 @@ class DispatchQueue {
   double get_max_age(utime_t now) const;
 
   int get_queue_len() const {
-    std::lock_guard l{lock};
-    return mqueue.length();
+    int len = 0;
+    for (auto& lane : lanes) {
+      std::lock_guard l{lane->lock};
+      len += lane->mqueue.length();
+    }
+    return len;
   }
 
   /**
@@ -147,54 +196,19 @@ class DispatchQueue {
   void dispatch_throttle_release(uint64_t msize);
 
   void queue_connect(Connection *con) {
-    std::lock_guard l{lock};
-    if (stop)
-      return;
-    mqueue.enqueue_strict(
-      0,
-      CEPH_MSG_PRIO_HIGHEST,
-      QueueItem(D_CONNECT, con));
-    cond.notify_all();
+    queue_code(D_CONNECT, con);
   }
   void queue_accept(Connection *con) {
-    std::lock_guard l{lock};
-    if (stop)
-      return;
-    mqueue.enqueue_strict(
-      0,
-      CEPH_MSG_PRIO_HIGHEST,
-      QueueItem(D_ACCEPT, con));
-    cond.notify_all();
+    queue_code(D_ACCEPT, con);
   }
   void queue_remote_reset(Connection *con) {
-    std::lock_guard l{lock};
-    if (stop)
-      return;
-    mqueue.enqueue_strict(
-      0,
-      CEPH_MSG_PRIO_HIGHEST,
-      QueueItem(D_BAD_REMOTE_RESET, con));
-    cond.notify_all();
+    queue_code(D_BAD_REMOTE_RESET, con);
   }
   void queue_reset(Connection *con) {
-    std::lock_guard l{lock};
-    if (stop)
-      return;
-    mqueue.enqueue_strict(
-      0,
-      CEPH_MSG_PRIO_HIGHEST,
-      QueueItem(D_BAD_RESET, con));
-    cond.notify_all();
+    queue_code(D_BAD_RESET, con);
   }
   void queue_refused(Connection *con) {
-    std::lock_guard l{lock};
-    if (stop)
-      return;
-    mqueue.enqueue_strict(
-      0,
-      CEPH_MSG_PRIO_HIGHEST,
-      QueueItem(D_CONN_REFUSED, con));
-    cond.notify_all();
+    queue_code(D_CONN_REFUSED, con);
   }
 
   bool can_fast_dispatch(const ceph::cref_t<Message> &m) const;
@@ -212,29 +226,39 @@ class DispatchQueue {
   uint64_t get_id() {
     return next_id++;
   }
+  /**
+   * Set the number of dispatch lanes (and threads).  With more than one
+   * lane, Dispatcher::ms_dispatch() may be called concurrently for
+   * different connections, so only daemons whose dispatchers are safe
+   * for that should raise it.  Must be called before start().
+   */
+  void set_num_lanes(unsigned n);
+  unsigned get_num_lanes() const {
+    return lanes.size();
+  }
   void start();
-  void entry();
+  void entry(unsigned lane);
   void wait();
   void shutdown();
-  bool is_started() const {return dispatch_thread.is_started();}
+  bool is_started() const {return lanes[0]->dispatch_thread.is_started();}
 
   DispatchQueue(CephContext *cct, Messenger *msgr, std::string &name)
-    : cct(cct), msgr(msgr),
-      lock(ceph::make_mutex("Messenger::DispatchQueue::lock" + name)),
-      mqueue(cct->_conf->ms_pq_max_tokens_per_priority,
-	     cct->_conf->ms_pq_min_cost),
+    : cct(cct), msgr(msgr), name(name),
       next_id(1),
-      dispatch_thread(this),
       local_delivery_lock(ceph::make_mutex("Messenger::DispatchQueue::local_delivery_lock" + name)),
       stop_local_delivery(false),
       local_delivery_thread(this),
       dispatch_throttler(cct, std::string("msgr_dispatch_throttler-") + name,
                          cct->_conf->ms_dispatch_throttle_bytes),
       stop(false)
-    {}
+    {
+      lanes.emplace_back(std::make_unique<Lane>(cct, this, name, 0));
+    }
   ~DispatchQueue() {
-    ceph_assert(mqueue.empty());
-    ceph_assert(marrival.empty());
+    for (auto& lane : lanes) {
+      ceph_assert(lane->mqueue.empty());
+      ceph_assert(lane->marrival.empty());
+    }
     ceph_assert(local_messages.empty());
   }
 };
@@ -362,6 +362,20 @@ public:
     ceph_assert(!started);
     default_send_priority = p;
   }
+  /**
+   * Set the number of threads delivering messages to ms_dispatch().
+   *
+   * Connections are spread across the threads, so messages from a single
+   * connection are still delivered in order, but Dispatchers must tolerate
+   * concurrent calls for different connections.  Messengers that do not
+   * support multiple dispatch threads ignore this.
+   *
+   * This is an init-time function and must be called *before* calling
+   * start().
+   *
+   * @param n The number of dispatch threads, at least 1.
+   */
+  virtual void set_dispatch_threads(unsigned n) {}
   /**
    * set the priority(SO_PRIORITY) for all packets to be sent on this socket.
    *
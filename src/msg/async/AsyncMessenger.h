@@ -105,6 +105,11 @@ public:
   }
   /** @} Accessors */
 
+  void set_dispatch_threads(unsigned n) override {
+    ceph_assert(!started);
+    dispatch_queue.set_num_lanes(n);
+  }
+
   /**
    * @defgroup Configuration functions
    * @{
@@ -141,6 +141,10 @@ int EventCenter::init(int nevent, unsigned center_id, const std::string &type)
 
   file_events.resize(nevent);
   this->nevent = nevent;
+  busy_poll_us = cct->_conf.get_val<uint64_t>("ms_async_busy_poll_us");
+  if (busy_poll_us)
+    ldout(cct, 1) << __func__ << " busy poll enabled, spin up to "
+                  << busy_poll_us << "us before blocking" << dendl;
 
   if (!driver->need_wakeup())
     return 0;
@@ -377,6 +381,47 @@ int EventCenter::process_time_events()
   return processed;
 }
 
+/**
+ * Spin on the event driver without sleeping for up to busy_poll_us (bounded
+ * by the caller's timeout), returning as soon as a file event fires or an
+ * external event is queued.  On a miss, *timeout_microseconds is reduced by
+ * the time spent spinning so that the caller can block for the remainder.
+ */
+int EventCenter::busy_poll_events(std::vector<FiredFileEvent> &fired_events,
+                                  unsigned *timeout_microseconds)
+{
+  auto spin_start = ceph::mono_clock::now();
+  auto spin_end = spin_start + std::chrono::microseconds(
+    std::min(busy_poll_us, *timeout_microseconds));
+  struct timeval zero = {0, 0};
+  int numevents = 0;
+
+  spinning.store(true);
+  do {
+    numevents = driver->event_wait(fired_events, &zero);
+    if (numevents != 0 || external_num_events.load())
+      break;
+  } while (ceph::mono_clock::now() < spin_end);
+  // pairs with the check in dispatch_event_external(): once we stop
+  // spinning, either we see the new external event here or the submitter
+  // sees spinning == false and writes the notify pipe.
+  spinning.store(false);
+
+  auto spun = ceph::mono_clock::now() - spin_start;
+  busy_poll_stats.spin_time += spun;
+  if (numevents != 0 || external_num_events.load()) {
+    ++busy_poll_stats.hits;
+    *timeout_microseconds = 0;
+  } else {
+    ++busy_poll_stats.misses;
+    uint64_t spun_us =
+      std::chrono::duration_cast<std::chrono::microseconds>(spun).count();
+    *timeout_microseconds =
+      spun_us >= *timeout_microseconds ? 0 : *timeout_microseconds - spun_us;
+  }
+  return numevents;
+}
+
 int EventCenter::process_events(unsigned timeout_microseconds,  ceph::timespan *working_dur)
 {
   struct timeval tv;
@@ -400,12 +445,19 @@ int EventCenter::process_events(unsigned timeout_microseconds,  ceph::timespan *
   bool blocking = pollers.empty() && !external_num_events.load();
   if (!blocking)
     timeout_microseconds = 0;
-  tv.tv_sec = timeout_microseconds / 1000000;
-  tv.tv_usec = timeout_microseconds % 1000000;
 
-  ldout(cct, 30) << __func__ << " wait second " << tv.tv_sec << " usec " << tv.tv_usec << dendl;
   std::vector<FiredFileEvent> fired_events;
-  numevents = driver->event_wait(fired_events, &tv);
+  numevents = 0;
+  if (blocking && busy_poll_us && timeout_microseconds)
+    numevents = busy_poll_events(fired_events, &timeout_microseconds);
+
+  if (numevents == 0) {
+    tv.tv_sec = timeout_microseconds / 1000000;
+    tv.tv_usec = timeout_microseconds % 1000000;
+
+    ldout(cct, 30) << __func__ << " wait second " << tv.tv_sec << " usec " << tv.tv_usec << dendl;
+    numevents = driver->event_wait(fired_events, &tv);
+  }
   auto working_start = ceph::mono_clock::now();
   for (int event_id = 0; event_id < numevents; event_id++) {
     int rfired = 0;
@@ -472,7 +524,8 @@ void EventCenter::dispatch_event_external(EventCallbackRef e)
     external_events.push_back(e);
     num = ++external_num_events;
   }
-  if (num == 1 && !in_thread())
+  // a spinning owner polls external_num_events itself
+  if (num == 1 && !in_thread() && !spinning.load())
     wakeup();
 
   ldout(cct, 30) << __func__ << " " << e << " pending " << num << dendl;
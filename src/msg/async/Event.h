@@ -151,6 +151,13 @@ class EventCenter {
     int slot;
   };
 
+  /// CPU accounting for busy-poll mode, drained by the owning worker.
+  struct BusyPollStats {
+    ceph::timespan spin_time = ceph::timespan::zero();
+    uint64_t hits = 0;    ///< spins that found work before blocking
+    uint64_t misses = 0;  ///< spins that expired and fell back to blocking
+  };
+
  private:
   CephContext *cct;
   std::string type;
@@ -175,8 +182,16 @@ class EventCenter {
   EventCallbackRef notify_handler;
   unsigned center_id;
   AssociatedCenters *global_centers = nullptr;
+  // busy-poll window in microseconds, 0 means always block in the driver
+  unsigned busy_poll_us = 0;
+  // set while the owner thread is spinning, so that external submitters
+  // can skip the notify pipe write
+  std::atomic_bool spinning = {false};
+  BusyPollStats busy_poll_stats;
 
   int process_time_events();
+  int busy_poll_events(std::vector<FiredFileEvent> &fired_events,
+                       unsigned *timeout_microseconds);
   FileEvent *_get_file_event(int fd) {
     ceph_assert(fd < nevent);
     return &file_events[fd];
@@ -199,6 +214,14 @@ class EventCenter {
 
   EventDriver *get_driver() { return driver; }
 
+  bool is_busy_polling() const { return busy_poll_us > 0; }
+  BusyPollStats take_busy_poll_stats() {
+    ceph_assert(in_thread());
+    BusyPollStats stats = busy_poll_stats;
+    busy_poll_stats = BusyPollStats();
+    return stats;
+  }
+
   // Used by internal thread
   int create_file_event(int fd, int mask, EventCallbackRef ctxt);
   uint64_t create_time_event(uint64_t milliseconds, EventCallbackRef ctxt);
@@ -56,6 +56,12 @@ std::function<void ()> NetworkStack::add_thread(Worker* w)
           // TODO do something?
         }
         w->perf_logger->tinc(l_msgr_running_total_time, dur);
+        if (w->center.is_busy_polling()) {
+          auto stats = w->center.take_busy_poll_stats();
+          w->perf_logger->tinc(l_msgr_busy_poll_time, stats.spin_time);
+          w->perf_logger->inc(l_msgr_busy_poll_hits, stats.hits);
+          w->perf_logger->inc(l_msgr_busy_poll_misses, stats.misses);
+        }
       }
       w->reset();
       w->destroy();
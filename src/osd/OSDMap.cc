@@ -22,6 +22,7 @@
 #include <boost/algorithm/string.hpp>
 
 #include "OSDMap.h"
+#include "OSDMapMapping.h"
 #include "common/config.h"
 #include "common/errno.h"
 #include "common/Formatter.h"
@@ -1882,6 +1883,34 @@ void OSDMap::get_upmap_pgs(vector<pg_t> *upmap_pgs) const
     upmap_pgs->push_back(p.first);
 }
 
+void OSDMap::get_pgs_remapped_to(const set<int>& osds, set<pg_t> *pgs) const
+{
+  for (auto& [pg, um] : pg_upmap) {
+    for (auto osd : um) {
+      if (osds.count(osd)) {
+	pgs->insert(pg);
+	break;
+      }
+    }
+  }
+  for (auto& [pg, items] : pg_upmap_items) {
+    for (auto& [from, to] : items) {
+      if (osds.count(from) || osds.count(to)) {
+	pgs->insert(pg);
+	break;
+      }
+    }
+  }
+  for (auto p = pg_temp->begin(); p != pg_temp->end(); ++p) {
+    for (auto osd : p->second) {
+      if (osds.count(osd)) {
+	pgs->insert(p->first);
+	break;
+      }
+    }
+  }
+}
+
 bool OSDMap::check_pg_upmaps(
   CephContext *cct,
   const vector<pg_t>& to_check,
@@ -4594,7 +4623,7 @@ bool OSDMap::try_pg_upmap(
   const vector<int>& underfull,  ///< osds to move to, in order of preference
   const vector<int>& more_underfull,  ///< more osds only slightly underfull
   vector<int> *orig,
-  vector<int> *out)              ///< resulting alternative mapping
+  vector<int> *out) const        ///< resulting alternative mapping
 {
   const pg_pool_t *pool = get_pg_pool(pg.pool());
   if (!pool)
@@ -4631,12 +4660,101 @@ bool OSDMap::try_pg_upmap(
   return true;
 }
 
+namespace {
+
+// collect the up osds of every pg in the given pools
+struct UpmapPGsByOSDJob : public ParallelPGMapper::Job {
+  const set<int64_t>& only_pools;
+  ceph::mutex pgs_lock = ceph::make_mutex("UpmapPGsByOSDJob::pgs_lock");
+  map<int,set<pg_t>> pgs_by_osd;
+
+  UpmapPGsByOSDJob(const OSDMap *om, const set<int64_t>& only_pools)
+    : ParallelPGMapper::Job(om), only_pools(only_pools) {}
+
+  void process(const vector<pg_t>& pgs) override {}
+  void process(int64_t pool, unsigned ps_begin, unsigned ps_end) override {
+    if (!only_pools.empty() && !only_pools.count(pool)) {
+      return;
+    }
+    vector<pair<int,pg_t>> found;
+    for (unsigned ps = ps_begin; ps < ps_end; ++ps) {
+      pg_t pg(ps, pool);
+      vector<int> up;
+      osdmap->pg_to_up_acting_osds(pg, &up, nullptr, nullptr, nullptr);
+      for (auto osd : up) {
+	if (osd != CRUSH_ITEM_NONE)
+	  found.emplace_back(osd, pg);
+      }
+    }
+    std::lock_guard l(pgs_lock);
+    for (auto& [osd, pg] : found) {
+      pgs_by_osd[osd].insert(pg);
+    }
+  }
+  void complete() override {}
+};
+
+struct UpmapCandidate {
+  bool evaluated = false;
+  bool remapped = false;  ///< try_pg_upmap found an alternative mapping
+  vector<int> orig, out;
+
+  void evaluate(CephContext *cct, const OSDMap& osdmap, pg_t pg,
+		const set<int>& overfull,
+		const vector<int>& underfull,
+		const vector<int>& more_underfull) {
+    vector<int> raw;
+    osdmap.pg_to_raw_upmap(pg, &raw, &orig); // including existing upmaps too
+    remapped = osdmap.try_pg_upmap(cct, pg, overfull, underfull,
+				   more_underfull, &orig, &out);
+    evaluated = true;
+  }
+};
+
+// evaluate a batch of upmap candidates; every pg must already have a
+// slot in candidates, so workers never modify the map itself
+struct UpmapCandidateJob : public ParallelPGMapper::Job {
+  CephContext *cct;
+  const set<int>& overfull;
+  const vector<int>& underfull;
+  const vector<int>& more_underfull;
+  map<pg_t,UpmapCandidate>& candidates;
+
+  UpmapCandidateJob(CephContext *cct, const OSDMap *om,
+		    const set<int>& overfull,
+		    const vector<int>& underfull,
+		    const vector<int>& more_underfull,
+		    map<pg_t,UpmapCandidate>& candidates)
+    : ParallelPGMapper::Job(om), cct(cct), overfull(overfull),
+      underfull(underfull), more_underfull(more_underfull),
+      candidates(candidates) {}
+
+  void process(const vector<pg_t>& pgs) override {
+    for (auto pg : pgs) {
+      candidates.at(pg).evaluate(cct, *osdmap, pg, overfull, underfull,
+				 more_underfull);
+    }
+  }
+  void process(int64_t pool, unsigned ps_begin, unsigned ps_end) override {}
+  void complete() override {}
+};
+
+// candidates are evaluated in windows that double in size, so that a
+// change found among the first few pgs does not pay for evaluating all
+// of them
+constexpr size_t UPMAP_CANDIDATE_WINDOW_MIN = 32;
+constexpr size_t UPMAP_CANDIDATE_WINDOW_MAX = 1024;
+constexpr unsigned UPMAP_CANDIDATES_PER_ITEM = 8;
+
+} // anonymous namespace
+
 int OSDMap::calc_pg_upmaps(
   CephContext *cct,
   uint32_t max_deviation,
   int max,
   const set<int64_t>& only_pools,
-  OSDMap::Incremental *pending_inc)
+  OSDMap::Incremental *pending_inc,
+  ParallelPGMapper *mapper)
 {
   ldout(cct, 10) << __func__ << " pools " << only_pools << dendl;
   OSDMap tmp;
@@ -4649,10 +4767,24 @@ int OSDMap::calc_pg_upmaps(
   int total_pgs = 0;
   float osd_weight_total = 0;
   map<int,float> osd_weight;
+  // ParallelPGMapper::queue() needs at least one pg to map
+  const bool parallel_scan = mapper &&
+    std::any_of(pools.begin(), pools.end(), [&only_pools] (auto& p) {
+      return (only_pools.empty() || only_pools.count(p.first)) &&
+	p.second.get_pg_num() > 0;
+    });
+  if (parallel_scan) {
+    UpmapPGsByOSDJob job(&tmp, only_pools);
+    mapper->queue(&job,
+		  cct->_conf.get_val<uint64_t>("mon_osd_mapping_pgs_per_chunk"),
+		  {});
+    job.wait();
+    pgs_by_osd.swap(job.pgs_by_osd);
+  }
   for (auto& i : pools) {
     if (!only_pools.empty() && !only_pools.count(i.first))
       continue;
-    for (unsigned ps = 0; ps < i.second.get_pg_num(); ++ps) {
+    for (unsigned ps = 0; !parallel_scan && ps < i.second.get_pg_num(); ++ps) {
       pg_t pg(ps, i.first);
       vector<int> up;
       tmp.pg_to_up_acting_osds(pg, &up, nullptr, nullptr, nullptr);
@@ -4706,7 +4838,7 @@ int OSDMap::calc_pg_upmaps(
   }
   float stddev = 0;
   map<int,float> osd_deviation;       // osd, deviation(pgs)
-  multimap<float,int> deviation_osd;  // deviation(pgs), osd
+  set<pair<float,int>> deviation_osd; // deviation(pgs), osd
   float cur_max_deviation = 0;
   for (auto& i : pgs_by_osd) {
     // make sure osd is still there (belongs to this crush-tree)
@@ -4719,7 +4851,7 @@ int OSDMap::calc_pg_upmaps(
                    << "\tdeviation " << deviation
                    << dendl;
     osd_deviation[i.first] = deviation;
-    deviation_osd.insert(make_pair(deviation, i.first));
+    deviation_osd.emplace(deviation, i.first);
     stddev += deviation * deviation;
     if (fabsf(deviation) > cur_max_deviation)
       cur_max_deviation = fabsf(deviation);
@@ -4786,7 +4918,18 @@ int OSDMap::calc_pg_upmaps(
 
     set<pg_t> to_unmap;
     map<pg_t, mempool::osdmap::vector<pair<int32_t,int32_t>>> to_upmap;
-    auto temp_pgs_by_osd = pgs_by_osd;
+    // copy-on-write overlay of pgs_by_osd, holding only the osds the
+    // change being built touches
+    map<int,set<pg_t>> temp_pgs_by_osd;
+    auto temp_pgs = [&](int osd) -> set<pg_t>& {
+      auto p = temp_pgs_by_osd.find(osd);
+      if (p == temp_pgs_by_osd.end()) {
+	auto q = pgs_by_osd.find(osd);
+	p = temp_pgs_by_osd.emplace(
+	  osd, q != pgs_by_osd.end() ? q->second : set<pg_t>()).first;
+      }
+      return p->second;
+    };
     // always start with fullest, break if we find any changes to make
     for (auto p = deviation_osd.rbegin(); p != deviation_osd.rend(); ++p) {
       if (skip_overfull && !underfull.empty()) {
@@ -4843,8 +4986,8 @@ int OSDMap::calc_pg_upmaps(
                            << " which remapped " << pg
                            << " into overfull osd." << osd
                            << dendl;
-            temp_pgs_by_osd[q.second].erase(pg);
-            temp_pgs_by_osd[q.first].insert(pg);
+            temp_pgs(q.second).erase(pg);
+            temp_pgs(q.first).insert(pg);
           } else {
             new_upmap_items.push_back(q);
           }
@@ -4870,6 +5013,8 @@ int OSDMap::calc_pg_upmaps(
       }
 
       // try upmap
+      vector<pg_t> to_try;
+      to_try.reserve(pgs.size());
       for (auto pg : pgs) {
         auto temp_it = tmp.pg_upmap.find(pg);
         if (temp_it != tmp.pg_upmap.end()) {
@@ -4881,72 +5026,103 @@ int OSDMap::calc_pg_upmaps(
                          << dendl;
 	  continue;
 	}
-        auto pg_pool_size = tmp.get_pg_pool_size(pg);
-        mempool::osdmap::vector<pair<int32_t,int32_t>> new_upmap_items;
-        set<int> existing;
         auto it = tmp.pg_upmap_items.find(pg);
         if (it != tmp.pg_upmap_items.end() &&
-            it->second.size() >= (size_t)pg_pool_size) {
+            it->second.size() >= (size_t)tmp.get_pg_pool_size(pg)) {
           ldout(cct, 10) << " " << pg << " already has full-size pg_upmap_items "
                          << it->second << ", skipping"
                          << dendl;
           continue;
-        } else if (it != tmp.pg_upmap_items.end()) {
-          ldout(cct, 10) << " " << pg << " already has pg_upmap_items "
-                         << it->second
-                         << dendl;
-          new_upmap_items = it->second;
-          // build existing too (for dedup)
-          for (auto i : it->second) {
-            existing.insert(i.first);
-            existing.insert(i.second);
-          }
-          // fall through
-          // to see if we can append more remapping pairs
         }
-	ldout(cct, 10) << " trying " << pg << dendl;
-        vector<int> raw, orig, out;
-        tmp.pg_to_raw_upmap(pg, &raw, &orig); // including existing upmaps too
-	if (!try_pg_upmap(cct, pg, overfull, underfull, more_underfull, &orig, &out)) {
-	  continue;
-	}
-	ldout(cct, 10) << " " << pg << " " << orig << " -> " << out << dendl;
-	if (orig.size() != out.size()) {
-	  continue;
-	}
-	ceph_assert(orig != out);
-	int pos = -1;
-	float max_dev = 0;
-	for (unsigned i = 0; i < out.size(); ++i) {
-          if (orig[i] == out[i])
-            continue; // skip invalid remappings
-          if (existing.count(orig[i]) || existing.count(out[i]))
-            continue; // we want new remappings only!
-	  if (osd_deviation[orig[i]] > max_dev) {
-	    max_dev = osd_deviation[orig[i]];
-	    pos = i;
-	    ldout(cct, 30) << "Max osd." << orig[i] << " pos " << i << " dev " << osd_deviation[orig[i]] << dendl;
+        to_try.push_back(pg);
+      }
+      map<pg_t,UpmapCandidate> candidates;
+      size_t window = UPMAP_CANDIDATE_WINDOW_MIN;
+      for (size_t begin = 0; begin < to_try.size();
+           begin += window,
+             window = std::min(window * 2, UPMAP_CANDIDATE_WINDOW_MAX)) {
+        vector<pg_t> batch(to_try.begin() + begin,
+                           to_try.begin() + std::min(begin + window,
+                                                     to_try.size()));
+        candidates.clear();
+        for (auto pg : batch) {
+          candidates[pg];
+        }
+        if (mapper) {
+          // candidates only depend on tmp and the overfull/underfull sets,
+          // so they can be evaluated concurrently and then walked in order
+          UpmapCandidateJob job(cct, &tmp, overfull, underfull,
+                                more_underfull, candidates);
+          mapper->queue(&job, UPMAP_CANDIDATES_PER_ITEM, batch);
+          job.wait();
+        }
+        for (auto pg : batch) {
+          auto pg_pool_size = tmp.get_pg_pool_size(pg);
+          mempool::osdmap::vector<pair<int32_t,int32_t>> new_upmap_items;
+          set<int> existing;
+          auto it = tmp.pg_upmap_items.find(pg);
+          if (it != tmp.pg_upmap_items.end()) {
+            ldout(cct, 10) << " " << pg << " already has pg_upmap_items "
+                           << it->second
+                           << dendl;
+            new_upmap_items = it->second;
+            // build existing too (for dedup)
+            for (auto i : it->second) {
+              existing.insert(i.first);
+              existing.insert(i.second);
+            }
+            // fall through
+            // to see if we can append more remapping pairs
+          }
+	  ldout(cct, 10) << " trying " << pg << dendl;
+          auto& candidate = candidates[pg];
+          if (!candidate.evaluated) {
+            candidate.evaluate(cct, tmp, pg, overfull, underfull,
+                               more_underfull);
+          }
+	  if (!candidate.remapped) {
+	    continue;
 	  }
-	}
-	if (pos != -1) {
-	  int i = pos;
-          ldout(cct, 10) << " will try adding new remapping pair "
-                         << orig[i] << " -> " << out[i] << " for " << pg
-			 << (orig[i] != osd ? " NOT selected osd" : "")
-                         << dendl;
-          existing.insert(orig[i]);
-          existing.insert(out[i]);
-          temp_pgs_by_osd[orig[i]].erase(pg);
-          temp_pgs_by_osd[out[i]].insert(pg);
-          ceph_assert(new_upmap_items.size() < (size_t)pg_pool_size);
-          new_upmap_items.push_back(make_pair(orig[i], out[i]));
-          // append new remapping pairs slowly
-          // This way we can make sure that each tiny change will
-          // definitely make distribution of PGs converging to
-          // the perfect status.
-          to_upmap[pg] = new_upmap_items;
-          goto test_change;
-	}
+          auto& orig = candidate.orig;
+          auto& out = candidate.out;
+	  ldout(cct, 10) << " " << pg << " " << orig << " -> " << out << dendl;
+	  if (orig.size() != out.size()) {
+	    continue;
+	  }
+	  ceph_assert(orig != out);
+	  int pos = -1;
+	  float max_dev = 0;
+	  for (unsigned i = 0; i < out.size(); ++i) {
+            if (orig[i] == out[i])
+              continue; // skip invalid remappings
+            if (existing.count(orig[i]) || existing.count(out[i]))
+              continue; // we want new remappings only!
+	    if (osd_deviation[orig[i]] > max_dev) {
+	      max_dev = osd_deviation[orig[i]];
+	      pos = i;
+	      ldout(cct, 30) << "Max osd." << orig[i] << " pos " << i << " dev " << osd_deviation[orig[i]] << dendl;
+	    }
+	  }
+	  if (pos != -1) {
+	    int i = pos;
+            ldout(cct, 10) << " will try adding new remapping pair "
+                           << orig[i] << " -> " << out[i] << " for " << pg
+			   << (orig[i] != osd ? " NOT selected osd" : "")
+                           << dendl;
+            existing.insert(orig[i]);
+            existing.insert(out[i]);
+            temp_pgs(orig[i]).erase(pg);
+            temp_pgs(out[i]).insert(pg);
+            ceph_assert(new_upmap_items.size() < (size_t)pg_pool_size);
+            new_upmap_items.push_back(make_pair(orig[i], out[i]));
+            // append new remapping pairs slowly
+            // This way we can make sure that each tiny change will
+            // definitely make distribution of PGs converging to
+            // the perfect status.
+            to_upmap[pg] = new_upmap_items;
+            goto test_change;
+	  }
+        }
       }
     }
 
@@ -4999,8 +5175,8 @@ int OSDMap::calc_pg_upmaps(
                            << " which remapped " << pg
                            << " out from underfull osd." << osd
                            << dendl;
-            temp_pgs_by_osd[j.second].erase(pg);
-            temp_pgs_by_osd[j.first].insert(pg);
+            temp_pgs(j.second).erase(pg);
+            temp_pgs(j.first).insert(pg);
           } else {
             new_upmap_items.push_back(j);
           }
@@ -5052,8 +5228,8 @@ int OSDMap::calc_pg_upmaps(
     ceph_assert(to_unmap.size() || to_upmap.size());
     float new_stddev = 0;
     map<int,float> temp_osd_deviation;
-    multimap<float,int> temp_deviation_osd;
     float cur_max_deviation = 0;
+    // only the osds the change touched have a new deviation
     for (auto& i : temp_pgs_by_osd) {
       // make sure osd is still there (belongs to this crush-tree)
       ceph_assert(osd_weight.count(i.first));
@@ -5065,8 +5241,15 @@ int OSDMap::calc_pg_upmaps(
                      << "\tdeviation " << deviation
                      << dendl;
       temp_osd_deviation[i.first] = deviation;
-      temp_deviation_osd.insert(make_pair(deviation, i.first));
-       new_stddev += deviation * deviation;
+    }
+    // but sum over all of them, in osd order, so that the result is
+    // exactly what a full recalculation would give
+    for (auto& i : osd_deviation) {
+      float deviation = i.second;
+      auto p = temp_osd_deviation.find(i.first);
+      if (p != temp_osd_deviation.end())
+        deviation = p->second;
+      new_stddev += deviation * deviation;
       if (fabsf(deviation) > cur_max_deviation)
         cur_max_deviation = fabsf(deviation);
     }
@@ -5102,9 +5285,13 @@ int OSDMap::calc_pg_upmaps(
     // ready to go
     ceph_assert(new_stddev < stddev);
     stddev = new_stddev;
-    pgs_by_osd = temp_pgs_by_osd;
-    osd_deviation = temp_osd_deviation;
-    deviation_osd = temp_deviation_osd;
+    for (auto& i : temp_pgs_by_osd) {
+      float deviation = temp_osd_deviation[i.first];
+      deviation_osd.erase(make_pair(osd_deviation[i.first], i.first));
+      deviation_osd.emplace(deviation, i.first);
+      osd_deviation[i.first] = deviation;
+      pgs_by_osd[i.first].swap(i.second);
+    }
     for (auto& i : to_unmap) {
       ldout(cct, 10) << " unmap pg " << i << dendl;
       ceph_assert(tmp.pg_upmap_items.count(i));
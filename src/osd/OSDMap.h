@@ -43,6 +43,7 @@
 // forward declaration
 class CrushWrapper;
 class health_check_map_t;
+class ParallelPGMapper;
 
 /*
  * we track up to two intervals during which the osd was alive and
@@ -1068,6 +1069,9 @@ public:
   uint64_t get_up_osd_features() const;
 
   void get_upmap_pgs(std::vector<pg_t> *upmap_pgs) const;
+  /// get pgs whose pg_upmap, pg_upmap_items or pg_temp reference any of osds
+  void get_pgs_remapped_to(const std::set<int>& osds,
+			   std::set<pg_t> *pgs) const;
   bool check_pg_upmaps(
     CephContext *cct,
     const std::vector<pg_t>& to_check,
@@ -1423,14 +1427,15 @@ public:
     const std::vector<int>& underfull,  ///< osds to move to, in order of preference
     const std::vector<int>& more_underfull,  ///< less full osds to move to, in order of preference
     std::vector<int> *orig,
-    std::vector<int> *out);             ///< resulting alternative mapping
+    std::vector<int> *out) const;       ///< resulting alternative mapping
 
   int calc_pg_upmaps(
     CephContext *cct,
     uint32_t max_deviation, ///< max deviation from target (value >= 1)
     int max_iterations,  ///< max iterations to run
     const std::set<int64_t>& pools,        ///< [optional] restrict to pool
-    Incremental *pending_inc
+    Incremental *pending_inc,
+    ParallelPGMapper *mapper = nullptr     ///< [optional] map pgs and evaluate candidates in parallel
     );
 
   int get_osds_by_bucket_name(const std::string &name, std::set<int> *osds) const;
@@ -90,6 +90,148 @@ void OSDMapMapping::_finish(const OSDMap& osdmap)
 {
   _build_rmap(osdmap);
   epoch = osdmap.get_epoch();
+  std::lock_guard l(pending_lock);
+  pending.reset(epoch);
+}
+
+void OSDMapMapping::note_incremental(const OSDMap& prev,
+				     const OSDMap::Incremental& inc)
+{
+  std::lock_guard l(pending_lock);
+  if (pending.full) {
+    return;
+  }
+  if (prev.get_epoch() != pending.epoch ||
+      inc.epoch != pending.epoch + 1 ||
+      inc.fullmap.length() ||
+      inc.crush.length() ||
+      inc.new_max_osd >= 0) {
+    // missed an epoch, or crush/osd layout changed: start over
+    pending.full = true;
+    return;
+  }
+  pending.epoch = inc.epoch;
+
+  for (auto& [poolid, pool] : inc.new_pools) {
+    // most pool updates (snaps, quotas, ...) do not affect placement
+    auto old = prev.get_pg_pool(poolid);
+    if (!old ||
+	old->get_type() != pool.get_type() ||
+	old->get_size() != pool.get_size() ||
+	old->get_crush_rule() != pool.get_crush_rule() ||
+	old->get_pg_num() != pool.get_pg_num() ||
+	old->get_pgp_num() != pool.get_pgp_num() ||
+	old->has_flag(pg_pool_t::FLAG_HASHPSPOOL) !=
+	  pool.has_flag(pg_pool_t::FLAG_HASHPSPOOL)) {
+      pending.pools.insert(poolid);
+    }
+  }
+
+  for (auto& p : inc.new_pg_temp) {
+    pending.pgs.insert(p.first);
+  }
+  for (auto& p : inc.new_primary_temp) {
+    pending.pgs.insert(p.first);
+  }
+  for (auto& p : inc.new_pg_upmap) {
+    pending.pgs.insert(p.first);
+  }
+  for (auto& pgid : inc.old_pg_upmap) {
+    pending.pgs.insert(pgid);
+  }
+  for (auto& p : inc.new_pg_upmap_items) {
+    pending.pgs.insert(p.first);
+  }
+  for (auto& pgid : inc.old_pg_upmap_items) {
+    pending.pgs.insert(pgid);
+  }
+
+  for (auto& p : inc.new_state) {
+    pending.osds.insert(p.first);
+  }
+  for (auto& p : inc.new_weight) {
+    pending.osds.insert(p.first);
+  }
+  for (auto& p : inc.new_up_client) {
+    pending.osds.insert(p.first);
+  }
+  for (auto& p : inc.new_primary_affinity) {
+    pending.osds.insert(p.first);
+  }
+}
+
+// collect the pgs whose mapping may have changed since the last completed
+// update, or return false if everything has to be recomputed.
+bool OSDMapMapping::_get_changed_pgs(const OSDMap& osdmap, vector<pg_t> *pgs)
+{
+  std::lock_guard l(pending_lock);
+  if (pending.full || pending.epoch != osdmap.get_epoch()) {
+    return false;
+  }
+
+  std::set<int64_t> changed_pools;
+  for (auto poolid : pending.pools) {
+    if (osdmap.have_pg_pool(poolid)) {
+      changed_pools.insert(poolid);
+    }
+  }
+  std::set<pg_t> changed_pgs = pending.pgs;
+  if (!pending.osds.empty()) {
+    // an osd change can only move pgs of pools whose rule can reach it...
+    std::map<int, bool> rule_reaches;
+    for (auto& [poolid, pool] : osdmap.get_pools()) {
+      if (changed_pools.count(poolid)) {
+	continue;
+      }
+      int ruleno = osdmap.crush->find_rule(pool.get_crush_rule(),
+					   pool.get_type(), pool.get_size());
+      if (ruleno < 0) {
+	continue;
+      }
+      auto r = rule_reaches.find(ruleno);
+      if (r == rule_reaches.end()) {
+	bool reaches = false;
+	for (int step = 0;
+	     step < osdmap.crush->get_rule_len(ruleno) && !reaches;
+	     ++step) {
+	  if (osdmap.crush->get_rule_op(ruleno, step) != CRUSH_RULE_TAKE) {
+	    continue;
+	  }
+	  int take = osdmap.crush->get_rule_arg1(ruleno, step);
+	  for (auto osd : pending.osds) {
+	    if (take == osd || osdmap.crush->subtree_contains(take, osd)) {
+	      reaches = true;
+	      break;
+	    }
+	  }
+	}
+	r = rule_reaches.emplace(ruleno, reaches).first;
+      }
+      if (r->second) {
+	changed_pools.insert(poolid);
+      }
+    }
+    // ...or of pgs explicitly remapped to it
+    osdmap.get_pgs_remapped_to(pending.osds, &changed_pgs);
+  }
+
+  for (auto poolid : changed_pools) {
+    unsigned pg_num = osdmap.get_pg_pool(poolid)->get_pg_num();
+    for (unsigned ps = 0; ps < pg_num; ++ps) {
+      pgs->push_back(pg_t(ps, poolid));
+    }
+  }
+  for (auto pgid : changed_pgs) {
+    if (changed_pools.count(pgid.pool())) {
+      continue;
+    }
+    auto pool = osdmap.get_pg_pool(pgid.pool());
+    if (!pool || pgid.ps() >= pool->get_pg_num()) {
+      continue;
+    }
+    pgs->push_back(pgid);
+  }
+  return true;
 }
 
 void OSDMapMapping::_dump()
@@ -7,13 +7,13 @@
 
 #include <vector>
 #include <map>
+#include <set>
 
 #include "osd/osd_types.h"
+#include "osd/OSDMap.h"
 #include "common/WorkQueue.h"
 #include "common/Cond.h"
 
-class OSDMap;
-
 /// work queue to perform work on batches of pgids on multiple CPUs
 class ParallelPGMapper {
 public:
@@ -255,6 +255,25 @@ private:
   epoch_t epoch = 0;
   uint64_t num_pgs = 0;
 
+  /// protects pending; a job may finish while the next epoch is noted
+  ceph::mutex pending_lock = ceph::make_mutex("OSDMapMapping::pending_lock");
+  /// changes noted since the last completed update, see note_incremental()
+  struct PendingChanges {
+    epoch_t epoch = 0;        ///< last epoch noted
+    bool full = true;         ///< recompute every pg
+    std::set<int64_t> pools;  ///< recompute every pg in these pools
+    std::set<pg_t> pgs;       ///< recompute these pgs
+    std::set<int> osds;       ///< recompute pgs that may map to these osds
+
+    void reset(epoch_t e) {
+      epoch = e;
+      full = false;
+      pools.clear();
+      pgs.clear();
+      osds.clear();
+    }
+  } pending;
+
   void _init_mappings(const OSDMap& osdmap);
   void _update_range(
     const OSDMap& map,
@@ -262,6 +281,7 @@ private:
     unsigned pg_begin, unsigned pg_end);
 
   void _build_rmap(const OSDMap& osdmap);
+  bool _get_changed_pgs(const OSDMap& osdmap, std::vector<pg_t> *pgs);
 
   void _start(const OSDMap& osdmap) {
     _init_mappings(osdmap);
@@ -278,7 +298,11 @@ private:
       : Job(osdmap), mapping(m) {
       mapping->_start(*osdmap);
     }
-    void process(const std::vector<pg_t>& pgs) override {}
+    void process(const std::vector<pg_t>& pgs) override {
+      for (auto pgid : pgs) {
+	mapping->update(*osdmap, pgid);
+      }
+    }
     void process(int64_t pool, unsigned ps_begin, unsigned ps_end) override {
       mapping->_update_range(*osdmap, pool, ps_begin, ps_end);
     }
@@ -331,12 +355,44 @@ public:
 
   void update(const OSDMap& map, pg_t pgid);
 
+  /**
+   * note an incremental before it is applied to prev
+   *
+   * Every incremental between the last completed update and the map
+   * passed to start_update() must be noted, or the next update will fall
+   * back to recomputing every pg.  If an update job is still running,
+   * its completion drops what was noted here and the next update
+   * recomputes every pg.
+   */
+  void note_incremental(const OSDMap& prev, const OSDMap::Incremental& inc);
+  /// make the next update recompute every pg
+  void invalidate() {
+    std::lock_guard l(pending_lock);
+    pending.full = true;
+  }
+
+  /**
+   * update the mapping for map
+   *
+   * If incremental is set and every change since the last completed
+   * update was noted, only pgs those changes may affect are recomputed.
+   */
   std::unique_ptr<MappingJob> start_update(
     const OSDMap& map,
     ParallelPGMapper& mapper,
-    unsigned pgs_per_item) {
+    unsigned pgs_per_item,
+    bool incremental = false) {
     std::unique_ptr<MappingJob> job(new MappingJob(&map, this));
-    mapper.queue(job.get(), pgs_per_item, {});
+    std::vector<pg_t> pgs;
+    if (!incremental || !_get_changed_pgs(map, &pgs)) {
+      mapper.queue(job.get(), pgs_per_item, {});
+    } else if (!pgs.empty()) {
+      mapper.queue(job.get(), pgs_per_item, pgs);
+    } else {
+      // nothing that affects placement changed
+      job->finish = ceph_clock_now();
+      _finish(map);
+    }
     return job;
   }
 
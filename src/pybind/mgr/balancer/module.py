@@ -19,20 +19,19 @@ TIME_FORMAT = '%Y-%m-%d_%H:%M:%S'
 
 
 class MappingState:
-    def __init__(self, osdmap, raw_pg_stats, raw_pool_stats, desc=''):
+    def __init__(self, osdmap, pgmap, desc=''):
         self.desc = desc
         self.osdmap = osdmap
         self.osdmap_dump = self.osdmap.dump()
         self.crush = osdmap.get_crush()
         self.crush_dump = self.crush.dump()
-        self.raw_pg_stats = raw_pg_stats
-        self.raw_pool_stats = raw_pool_stats
-        self.pg_stat = {
-            i['pgid']: i['stat_sum'] for i in raw_pg_stats.get('pg_stats', [])
-        }
+        self.pgmap = pgmap
+        # only the stat_sums are needed, not the whole pg dump
+        self.pg_stat = pgmap.get_pg_stat_sums()
         osd_poolids = [p['pool'] for p in self.osdmap_dump.get('pools', [])]
-        pg_poolids = [p['poolid'] for p in raw_pool_stats.get('pool_stats', [])]
-        self.poolids = set(osd_poolids) & set(pg_poolids)
+        self.poolids = set(
+            p for p in osd_poolids if pgmap.get_pool_stats(p) is not None
+        )
         self.pg_up = {}
         self.pg_up_by_poolid = {}
         for poolid in self.poolids:
@@ -89,8 +88,7 @@ class MsPlan(Plan):
         self.inc.set_osd_reweights(self.osd_weights)
         self.inc.set_crush_compat_weight_set_weights(self.compat_ws)
         return MappingState(self.initial.osdmap.apply_incremental(self.inc),
-                            self.initial.raw_pg_stats,
-                            self.initial.raw_pool_stats,
+                            self.initial.pgmap,
                             'plan %s final' % self.name)
 
     def show(self) -> str:
@@ -361,8 +359,7 @@ class Module(MgrModule):
                 return (-errno.EPERM, '', warn)
         elif mode == Mode.crush_compat:
             ms = MappingState(self.get_osdmap(),
-                              self.get("pg_stats"),
-                              self.get("pool_stats"),
+                              self.get_pgmap(),
                               'initialize compat weight-set')
             self.get_compat_weight_set_weights(ms)  # ignore error
         self.set_module_option('mode', mode.value)
@@ -458,8 +455,7 @@ class Module(MgrModule):
         pools = []
         if option is None:
             ms = MappingState(self.get_osdmap(),
-                              self.get("pg_stats"),
-                              self.get("pool_stats"),
+                              self.get_pgmap(),
                               'current cluster')
         elif option in self.plans:
             plan = self.plans.get(option)
@@ -473,8 +469,7 @@ class Module(MgrModule):
                 # using an old snapshotted osdmap vs a fresh copy of pg_stats.
                 # It should not be a big deal though..
                 ms = MappingState(plan.osdmap,
-                                  self.get("pg_stats"),
-                                  self.get("pool_stats"),
+                                  self.get_pgmap(),
                                   f'plan "{plan.name}"')
             else:
                 ms = cast(MsPlan, plan).final_state()
@@ -486,8 +481,7 @@ class Module(MgrModule):
                 raise ValueError(f'option "{option}" not a plan or a pool')
             pools.append(option)
             ms = MappingState(osdmap,
-                              self.get("pg_stats"),
-                              self.get("pool_stats"),
+                              self.get_pgmap(),
                               f'pool "{option}"')
         return ms, pools
 
@@ -700,8 +694,7 @@ class Module(MgrModule):
             plan = MsPlan(name,
                           mode,
                           MappingState(osdmap,
-                                       self.get("pg_stats"),
-                                       self.get("pool_stats"),
+                                       self.get_pgmap(),
                                        'plan %s initial' % name),
                           pools)
         return plan
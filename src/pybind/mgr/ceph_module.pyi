@@ -29,6 +29,19 @@ class BasePyOSDMapIncremental(object):
     def _set_osd_reweights(self, weightmap):...
     def _set_crush_compat_weight_set_weights(self, weightmap):...
 
+class BasePyPGMap(object):
+    def _get_version(self):...
+    def _get_num_pg(self):...
+    def _get_pg_ids(self, pool, state):...
+    def _get_pg_stats(self, pgid):...
+    def _dump_pg_stats(self, pool, state):...
+    def _get_pg_stat_sums(self, pool, state):...
+    def _count_by_state(self, pool, state):...
+    def _count_by_pool_and_state(self):...
+    def _get_pg_sum(self):...
+    def _get_pool_stats(self, pool_id):...
+    def _get_osd_stats(self, osd):...
+
 class BasePyCRUSH(object):
     def _dump(self):...
     def _get_item_weight(self, item):...
@@ -94,6 +107,8 @@ class BaseMgrModule(object):
     def _ceph_get_store(self, key: str) -> Optional[str]: ...
     # mgr actually imports OSDMap from mgr_module and constructs an OSDMap
     def _ceph_get_osdmap(self) -> BasePyOSDMap: ...
+    # likewise for PGMap
+    def _ceph_get_pgmap(self) -> BasePyPGMap: ...
     def _ceph_set_uri(self, uri: str) -> None: ...
     def _ceph_set_device_wear_level(self, devid: str, val: float) -> None: ...
     def _ceph_have_mon_connection(self) -> bool: ...
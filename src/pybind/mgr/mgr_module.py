@@ -1,7 +1,7 @@
 import ceph_module  # noqa
 
 from typing import cast, Tuple, Any, Dict, Generic, Optional, Callable, List, \
-    Mapping, NamedTuple, Sequence, Union, TYPE_CHECKING
+    Iterator, Mapping, NamedTuple, Sequence, Union, TYPE_CHECKING
 if TYPE_CHECKING:
     import sys
     if sys.version_info >= (3, 8):
@@ -206,6 +206,78 @@ class OSDMapIncremental(ceph_module.BasePyOSDMapIncremental):
         return self._set_crush_compat_weight_set_weights(weightmap)
 
 
+class PGMap(ceph_module.BasePyPGMap):
+    """
+    Read-only view of a snapshot of the cluster's PGMap.
+
+    Unlike ``MgrModule.get('pg_stats')`` nothing is converted to python
+    objects up front: stats are materialized per PG, per pool or per OSD
+    as they are asked for, and PG queries can be narrowed down by pool
+    and state (e.g. ``'active+clean'``, matching PGs with at least those
+    states) first.
+    """
+
+    def get_version(self) -> int:
+        return self._get_version()
+
+    def __len__(self) -> int:
+        return self._get_num_pg()
+
+    def __iter__(self) -> Iterator[str]:
+        return iter(self.get_pg_ids())
+
+    def __contains__(self, pgid: object) -> bool:
+        return isinstance(pgid, str) and self._get_pg_stats(pgid) is not None
+
+    def get_pg_ids(self,
+                   pool: Optional[int] = None,
+                   state: Optional[str] = None) -> List[str]:
+        return self._get_pg_ids(-1 if pool is None else pool, state or '')
+
+    def get_pg_stats(self, pgid: str) -> Optional[Dict[str, Any]]:
+        return self._get_pg_stats(pgid)
+
+    def dump_pg_stats(self,
+                      pool: Optional[int] = None,
+                      state: Optional[str] = None) -> List[Dict[str, Any]]:
+        """
+        Same entries as ``MgrModule.get('pg_stats')['pg_stats']``, for the
+        matching PGs only.
+        """
+        return self._dump_pg_stats(-1 if pool is None else pool, state or '')
+
+    def get_pg_stat_sums(self,
+                         pool: Optional[int] = None,
+                         state: Optional[str] = None) -> Dict[str, Dict[str, int]]:
+        """
+        Map of PG ID to its ``stat_sum``, without the rest of the PG stats.
+        """
+        return self._get_pg_stat_sums(-1 if pool is None else pool, state or '')
+
+    def count_by_state(self,
+                       pool: Optional[int] = None,
+                       state: Optional[str] = None) -> Dict[str, int]:
+        return self._count_by_state(-1 if pool is None else pool, state or '')
+
+    def count_by_pool_and_state(self) -> Dict[str, Dict[str, int]]:
+        """
+        Same as ``MgrModule.get('pg_summary')['by_pool']``.
+        """
+        return self._count_by_pool_and_state()
+
+    def get_pg_sum(self) -> Dict[str, Any]:
+        """
+        Same as ``MgrModule.get('pg_summary')['pg_stats_sum']``.
+        """
+        return self._get_pg_sum()
+
+    def get_pool_stats(self, pool_id: int) -> Optional[Dict[str, Any]]:
+        return self._get_pool_stats(pool_id)
+
+    def get_osd_stats(self, osd: int) -> Optional[Dict[str, Any]]:
+        return self._get_osd_stats(osd)
+
+
 class CRUSHMap(ceph_module.BasePyCRUSH):
     ITEM_NONE = 0x7fffffff
     DEFAULT_CHOOSE_ARGS = '-1'
@@ -1568,6 +1640,14 @@ class MgrModule(ceph_module.BaseMgrModule, MgrModuleLoggingMixin):
         """
         return cast(OSDMap, self._ceph_get_osdmap())
 
+    def get_pgmap(self) -> PGMap:
+        """
+        Get a read-only view of the latest PGMap.  The view is a shared
+        snapshot: it is cheap to get, and does not change while it is held.
+        :return: PGMap
+        """
+        return cast(PGMap, self._ceph_get_pgmap())
+
     def get_latest(self, daemon_type: str, daemon_name: str, counter: str) -> int:
         data = self.get_latest_counter(
             daemon_type, daemon_name, counter)[counter]
@@ -680,12 +680,12 @@ class Module(MgrModule):
     @profile_method()
     def get_pg_status(self) -> None:
 
-        pg_summary = self.get('pg_summary')
+        by_pool = self.get_pgmap().count_by_pool_and_state()
 
-        for pool in pg_summary['by_pool']:
+        for pool in by_pool:
             num_by_state = defaultdict(int)  # type: DefaultDict[str, int]
 
-            for state_name, count in pg_summary['by_pool'][pool].items():
+            for state_name, count in by_pool[pool].items():
                 for state in state_name.split('+'):
                     num_by_state[state] += count
                 num_by_state['total'] += count
@@ -886,7 +886,7 @@ class Module(MgrModule):
 
     @profile_method()
     def get_num_objects(self) -> None:
-        pg_sum = self.get('pg_summary')['pg_stats_sum']['stat_sum']
+        pg_sum = self.get_pgmap().get_pg_sum()['stat_sum']
         for obj in NUM_OBJECTS:
             stat = 'num_objects_{}'.format(obj)
             self.metrics[stat].set(pg_sum[stat])
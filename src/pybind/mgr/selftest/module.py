@@ -262,6 +262,20 @@ class Module(MgrModule):
 
         self.get_daemon_status("osd", "0")
 
+        # the PGMap view must agree with the full dumps
+        pgmap = self.get_pgmap()
+        pg_dump = self.get('pg_dump')
+        if pgmap.get_version() == pg_dump['version']:
+            assert len(pgmap) == len(pg_dump['pg_stats'])
+            for pg in pg_dump['pg_stats']:
+                assert pg['pgid'] in pgmap
+                assert pgmap.get_pg_stats(pg['pgid'])['state'] == pg['state']
+        for pool in osdmap['pools']:
+            for pgid in pgmap.get_pg_ids(pool=pool['pool'], state='active'):
+                assert pgid.startswith('%d.' % pool['pool'])
+                assert 'active' in pgmap.get_pg_stats(pgid)['state']
+        assert sum(pgmap.count_by_state().values()) == len(pgmap)
+
     def _self_test_config(self) -> None:
         # This is not a strong test (can't tell if values really
         # persisted), it's just for the python interface bit.
@@ -18,6 +18,7 @@
 #include "librados/librados_asio.h"
 
 #include "rgw_aio.h"
+#include "rgw_datacache.h"
 
 namespace rgw {
 
@@ -105,6 +106,35 @@ Aio::OpFunc aio_abstract(Op&& op, optional_yield y) {
   return aio_abstract(std::forward<Op>(op));
 }
 
+Aio::OpFunc datacache_abstract(RGWDataCache* cache, int fd, uint64_t len) {
+  return [cache, fd, len] (Aio* aio, AioResult& r) mutable {
+      cache->read(fd, len, [aio, &r] (int ret, bufferlist&& bl) {
+          r.result = ret;
+          r.data = std::move(bl);
+          aio->put(r);
+        });
+    };
+}
+
+Aio::OpFunc datacache_abstract(RGWDataCache* cache, int fd, uint64_t len,
+                               spawn::yield_context yield) {
+  return [cache, fd, len, yield] (Aio* aio, AioResult& r) mutable {
+      // the cache completes on one of its own threads, so post the result
+      // back to the yield_context's strand executor like librados_op does
+      using namespace boost::asio;
+      async_completion<spawn::yield_context, void()> init(yield);
+      auto ex = get_associated_executor(init.completion_handler);
+
+      cache->read(fd, len, [aio, &r, ex] (int ret, bufferlist&& bl) {
+          post(ex, [aio, &r, ret, bl = std::move(bl)] () mutable {
+              r.result = ret;
+              r.data = std::move(bl);
+              aio->put(r);
+            });
+        });
+    };
+}
+
 } // anonymous namespace
 
 Aio::OpFunc Aio::librados_op(librados::ObjectReadOperation&& op,
@@ -115,5 +145,12 @@ Aio::OpFunc Aio::librados_op(librados::ObjectWriteOperation&& op,
                              optional_yield y) {
   return aio_abstract(std::move(op), y);
 }
+Aio::OpFunc Aio::datacache_op(RGWDataCache* cache, int fd, uint64_t len,
+                              optional_yield y) {
+  if (y) {
+    return datacache_abstract(cache, fd, len, y.get_yield_context());
+  }
+  return datacache_abstract(cache, fd, len);
+}
 
 } // namespace rgw
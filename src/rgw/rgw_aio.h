@@ -29,6 +29,8 @@
 
 #include "include/function2.hpp"
 
+class RGWDataCache;
+
 namespace rgw {
 
 struct AioResult {
@@ -95,6 +97,10 @@ class Aio {
                             optional_yield y);
   static OpFunc librados_op(librados::ObjectWriteOperation&& op,
                             optional_yield y);
+  // read len bytes of cached data from the descriptor returned by
+  // RGWDataCache::lookup()
+  static OpFunc datacache_op(RGWDataCache* cache, int fd, uint64_t len,
+                             optional_yield y);
 };
 
 } // namespace rgw
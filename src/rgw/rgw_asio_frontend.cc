@@ -351,7 +351,11 @@ namespace dmc = rgw::dmclock;
 class AsioFrontend {
   RGWProcessEnv env;
   RGWFrontendConfig* conf;
-  boost::asio::io_context context;
+  // one per io_contexts, each run by its own share of the threads. every
+  // context has its own acceptors, and connections stay on the context that
+  // accepted them
+  std::vector<std::unique_ptr<boost::asio::io_context>> contexts;
+  boost::asio::io_context& context; // contexts.front()
   ceph::timespan request_timeout = std::chrono::milliseconds(REQUEST_TIMEOUT);
 #ifdef WITH_RADOSGW_BEAST_OPENSSL
   boost::optional<ssl::context> ssl_context;
@@ -366,6 +370,7 @@ class AsioFrontend {
   std::unique_ptr<rgw::dmclock::Scheduler> scheduler;
 
   struct Listener {
+    boost::asio::io_context& context;
     tcp::endpoint endpoint;
     tcp::acceptor acceptor;
     tcp::socket socket;
@@ -373,20 +378,24 @@ class AsioFrontend {
     bool use_nodelay = false;
 
     explicit Listener(boost::asio::io_context& context)
-      : acceptor(context), socket(context) {}
+      : context(context), acceptor(context), socket(context) {}
   };
   std::vector<Listener> listeners;
 
   ConnectionList connections;
 
-  // work guard to keep run() threads busy while listeners are paused
+  // work guards to keep run() threads busy while listeners are paused
   using Executor = boost::asio::io_context::executor_type;
-  std::optional<boost::asio::executor_work_guard<Executor>> work;
+  std::vector<boost::asio::executor_work_guard<Executor>> work;
 
   std::vector<std::thread> threads;
   std::atomic<bool> going_down{false};
 
   CephContext* ctx() const { return env.store->ctx(); }
+  static unsigned threads_for_context(unsigned thread_count,
+                                      unsigned num_contexts, unsigned i);
+  static std::vector<std::unique_ptr<boost::asio::io_context>>
+      make_contexts(CephContext* cct, RGWFrontendConfig* conf);
   std::optional<dmc::ClientCounters> client_counters;
   std::unique_ptr<dmc::ClientConfig> client_config;
   void accept(Listener& listener, boost::system::error_code ec);
@@ -394,7 +403,8 @@ class AsioFrontend {
  public:
   AsioFrontend(const RGWProcessEnv& env, RGWFrontendConfig* conf,
 	       dmc::SchedulerCtx& sched_ctx)
-    : env(env), conf(conf), pause_mutex(context.get_executor())
+    : env(env), conf(conf), contexts(make_contexts(ctx(), conf)),
+      context(*contexts.front()), pause_mutex(context.get_executor())
   {
     auto sched_t = dmc::get_scheduler_t(ctx());
     switch(sched_t){
@@ -507,6 +517,53 @@ static int drop_privileges(CephContext *ctx)
   return 0;
 }
 
+unsigned AsioFrontend::threads_for_context(unsigned thread_count,
+                                           unsigned num_contexts, unsigned i)
+{
+  // split the threads evenly, but run every context
+  return std::max(thread_count / num_contexts +
+                  (i < thread_count % num_contexts ? 1 : 0), 1u);
+}
+
+std::vector<std::unique_ptr<boost::asio::io_context>>
+AsioFrontend::make_contexts(CephContext* cct, RGWFrontendConfig* conf)
+{
+  unsigned num_contexts = 1;
+  auto& config = conf->get_config_map();
+  auto i = config.find("io_contexts");
+  if (i != config.end()) {
+    auto n = ceph::parse<unsigned>(i->second);
+    if (!n) {
+      lderr(cct) << "WARNING: invalid value for io_contexts: " << i->second
+          << ", using a single io_context" << dendl;
+    } else if (*n == 0) {
+      num_contexts = std::max(std::thread::hardware_concurrency(), 1u);
+    } else {
+      num_contexts = *n;
+    }
+  }
+
+  // a context without a thread of its own would still get one in init(),
+  // adding threads beyond rgw_thread_pool_size
+  const unsigned thread_count = cct->_conf->rgw_thread_pool_size;
+  if (thread_count && num_contexts > thread_count) {
+    ldout(cct, 1) << "io_contexts=" << num_contexts << " exceeds "
+        "rgw_thread_pool_size, using " << thread_count << dendl;
+    num_contexts = thread_count;
+  }
+
+  std::vector<std::unique_ptr<boost::asio::io_context>> contexts;
+  contexts.reserve(num_contexts);
+  for (unsigned c = 0; c < num_contexts; c++) {
+    // the hint only tells asio how many threads will run the context. it
+    // keeps its locking, which librados completions posted from other
+    // threads rely on; only BOOST_ASIO_CONCURRENCY_HINT_UNSAFE would drop it
+    const int hint = threads_for_context(thread_count, num_contexts, c);
+    contexts.push_back(std::make_unique<boost::asio::io_context>(hint));
+  }
+  return contexts;
+}
+
 int AsioFrontend::init()
 {
   boost::system::error_code ec;
@@ -565,6 +622,28 @@ int AsioFrontend::init()
   }
   
 
+  // give the other io_contexts their own acceptor on each endpoint.
+  // SO_REUSEPORT has the kernel spread new connections over them
+  const bool reuse_port = contexts.size() > 1;
+  if (reuse_port) {
+#ifndef SO_REUSEPORT
+    lderr(ctx()) << "io_contexts requires SO_REUSEPORT, which is not "
+        "supported on this platform" << dendl;
+    return -EINVAL;
+#endif
+    const size_t count = listeners.size();
+    listeners.reserve(count * contexts.size());
+    for (size_t c = 1; c < contexts.size(); c++) {
+      for (size_t i = 0; i < count; i++) {
+        listeners.emplace_back(*contexts[c]);
+        auto& l = listeners.back();
+        l.endpoint = listeners[i].endpoint;
+        l.use_ssl = listeners[i].use_ssl;
+        l.use_nodelay = listeners[i].use_nodelay;
+      }
+    }
+  }
+
   bool socket_bound = false;
   // start listeners
   for (auto& l : listeners) {
@@ -590,6 +669,18 @@ int AsioFrontend::init()
     }
 
     l.acceptor.set_option(tcp::acceptor::reuse_address(true));
+#ifdef SO_REUSEPORT
+    if (reuse_port) {
+      using reuse_port_option =
+          boost::asio::detail::socket_option::boolean<SOL_SOCKET, SO_REUSEPORT>;
+      l.acceptor.set_option(reuse_port_option(true), ec);
+      if (ec) {
+        lderr(ctx()) << "failed to set SO_REUSEPORT socket option: "
+            << ec.message() << dendl;
+        return -ec.value();
+      }
+    }
+#endif
     l.acceptor.bind(l.endpoint, ec);
     if (ec) {
       lderr(ctx()) << "failed to bind address " << l.endpoint
@@ -900,8 +991,8 @@ void AsioFrontend::accept(Listener& l, boost::system::error_code ec)
   // spawn a coroutine to handle the connection
 #ifdef WITH_RADOSGW_BEAST_OPENSSL
   if (l.use_ssl) {
-    spawn::spawn(context,
-      [this, s=std::move(stream)] (spawn::yield_context yield) mutable {
+    spawn::spawn(l.context,
+      [this, &context = l.context, s=std::move(stream)] (spawn::yield_context yield) mutable {
         Connection conn{s.socket()};
         auto c = connections.add(conn);
         // wrap the tcp_stream in an ssl stream
@@ -931,8 +1022,8 @@ void AsioFrontend::accept(Listener& l, boost::system::error_code ec)
 #else
   {
 #endif // WITH_RADOSGW_BEAST_OPENSSL
-    spawn::spawn(context,
-      [this, s=std::move(stream)] (spawn::yield_context yield) mutable {
+    spawn::spawn(l.context,
+      [this, &context = l.context, s=std::move(stream)] (spawn::yield_context yield) mutable {
         Connection conn{s.socket()};
         auto c = connections.add(conn);
         auto buffer = std::make_unique<parse_buffer>();
@@ -947,23 +1038,29 @@ void AsioFrontend::accept(Listener& l, boost::system::error_code ec)
 int AsioFrontend::run()
 {
   auto cct = ctx();
-  const int thread_count = cct->_conf->rgw_thread_pool_size;
-  threads.reserve(thread_count);
-
-  ldout(cct, 4) << "frontend spawning " << thread_count << " threads" << dendl;
-
-  // the worker threads call io_context::run(), which will return when there's
-  // no work left. hold a work guard to keep these threads going until join()
-  work.emplace(boost::asio::make_work_guard(context));
-
-  for (int i = 0; i < thread_count; i++) {
-    threads.emplace_back([=]() noexcept {
-      // request warnings on synchronous librados calls in this thread
-      is_asio_thread = true;
-      // Have uncaught exceptions kill the process and give a
-      // stacktrace, not be swallowed.
-      context.run();
-    });
+  const unsigned thread_count = cct->_conf->rgw_thread_pool_size;
+  const unsigned num_contexts = contexts.size();
+  threads.reserve(std::max(thread_count, num_contexts));
+
+  ldout(cct, 4) << "frontend spawning " << thread_count << " threads over "
+      << num_contexts << " io_contexts" << dendl;
+
+  for (unsigned c = 0; c < num_contexts; c++) {
+    auto& context = *contexts[c];
+    // the worker threads call io_context::run(), which will return when there's
+    // no work left. hold a work guard to keep these threads going until join()
+    work.push_back(boost::asio::make_work_guard(context));
+
+    const unsigned count = threads_for_context(thread_count, num_contexts, c);
+    for (unsigned i = 0; i < count; i++) {
+      threads.emplace_back([&context]() noexcept {
+        // request warnings on synchronous librados calls in this thread
+        is_asio_thread = true;
+        // Have uncaught exceptions kill the process and give a
+        // stacktrace, not be swallowed.
+        context.run();
+      });
+    }
   }
   return 0;
 }
@@ -989,7 +1086,7 @@ void AsioFrontend::join()
   if (!going_down) {
     stop();
   }
-  work.reset();
+  work.clear();
 
   ldout(ctx(), 4) << "frontend joining threads..." << dendl;
   for (auto& thread : threads) {
@@ -5,20 +5,41 @@
 #include "rgw_perf_counters.h"
 
 #include <errno.h>
+#include <algorithm>
 
 #define dout_subsys ceph_subsys_rgw
 
+namespace {
+// hits are counted per thread and added to the shared perf counter in
+// batches, so that a hit doesn't write to a cacheline that every other
+// thread hitting the cache writes too. each thread may hold back up to
+// hit_batch - 1 hits
+constexpr uint64_t hit_batch = 64;
+thread_local uint64_t unreported_hits = 0;
 
-int ObjectCache::get(const DoutPrefixProvider *dpp, const string& name, ObjectCacheInfo& info, uint32_t mask, rgw_cache_entry_info *cache_info)
+void count_hit()
 {
+  if (++unreported_hits == hit_batch) {
+    if (perfcounter) {
+      perfcounter->inc(l_rgw_cache_hit, hit_batch);
+    }
+    unreported_hits = 0;
+  }
+}
+} // anonymous namespace
+
 
-  std::shared_lock rl{lock};
+int ObjectCache::get(const DoutPrefixProvider *dpp, const string& name, ObjectCacheInfo& info, uint32_t mask, rgw_cache_entry_info *cache_info)
+{
   if (!enabled) {
     return -ENOENT;
   }
-  auto iter = cache_map.find(name);
-  if (iter == cache_map.end()) {
+  auto& shard = get_shard(name);
+  std::shared_lock rl{shard.lock};
+  auto iter = shard.cache_map.find(name);
+  if (iter == shard.cache_map.end()) {
     ldpp_dout(dpp, 10) << "cache get: name=" << name << " : miss" << dendl;
+    ++shard.misses;
     if (perfcounter) {
       perfcounter->inc(l_rgw_cache_miss);
     }
@@ -29,15 +50,15 @@ int ObjectCache::get(const DoutPrefixProvider *dpp, const string& name, ObjectCa
        (ceph::coarse_mono_clock::now() - iter->second.info.time_added) > expiry) {
     ldpp_dout(dpp, 10) << "cache get: name=" << name << " : expiry miss" << dendl;
     rl.unlock();
-    std::unique_lock wl{lock};  // write lock for insertion
+    std::unique_lock wl{shard.lock};  // write lock for removal
     // check that wasn't already removed by other thread
-    iter = cache_map.find(name);
-    if (iter != cache_map.end()) {
-      for (auto &kv : iter->second.chained_entries)
-        kv.first->invalidate(kv.second);
-      remove_lru(name, iter->second.lru_iter);
-      cache_map.erase(iter);
+    iter = shard.cache_map.find(name);
+    if (iter != shard.cache_map.end()) {
+      invalidate_chained(iter->second);
+      remove_clock(shard, iter->second.clock_iter);
+      shard.cache_map.erase(iter);
     }
+    ++shard.misses;
     if (perfcounter) {
       perfcounter->inc(l_rgw_cache_miss);
     }
@@ -45,37 +66,22 @@ int ObjectCache::get(const DoutPrefixProvider *dpp, const string& name, ObjectCa
   }
 
   ObjectCacheEntry *entry = &iter->second;
-
-  if (lru_counter - entry->lru_promotion_ts > lru_window) {
-    ldpp_dout(dpp, 20) << "cache get: touching lru, lru_counter=" << lru_counter
-                   << " promotion_ts=" << entry->lru_promotion_ts << dendl;
-    rl.unlock();
-    std::unique_lock wl{lock};  // write lock for insertion
-    /* need to redo this because entry might have dropped off the cache */
-    iter = cache_map.find(name);
-    if (iter == cache_map.end()) {
-      ldpp_dout(dpp, 10) << "lost race! cache get: name=" << name << " : miss" << dendl;
-      if(perfcounter) perfcounter->inc(l_rgw_cache_miss);
-      return -ENOENT;
-    }
-
-    entry = &iter->second;
-    /* check again, we might have lost a race here */
-    if (lru_counter - entry->lru_promotion_ts > lru_window) {
-      touch_lru(dpp, name, *entry, iter->second.lru_iter);
-    }
+  // only store when the flag is clear, so hot entries stay shared in cpu caches
+  if (!entry->referenced.load(std::memory_order_relaxed)) {
+    entry->referenced.store(true, std::memory_order_relaxed);
   }
 
-  ObjectCacheInfo& src = iter->second.info;
+  ObjectCacheInfo& src = entry->info;
   if(src.status == -ENOENT) {
     ldpp_dout(dpp, 10) << "cache get: name=" << name << " : hit (negative entry)" << dendl;
-    if (perfcounter) perfcounter->inc(l_rgw_cache_hit);
+    count_hit();
     return -ENODATA;
   }
   if ((src.flags & mask) != mask) {
     ldpp_dout(dpp, 10) << "cache get: name=" << name << " : type miss (requested=0x"
                    << std::hex << mask << ", cached=0x" << src.flags
                    << std::dec << ")" << dendl;
+    ++shard.misses;
     if(perfcounter) perfcounter->inc(l_rgw_cache_miss);
     return -ENOENT;
   }
@@ -88,7 +94,7 @@ int ObjectCache::get(const DoutPrefixProvider *dpp, const string& name, ObjectCa
     cache_info->cache_locator = name;
     cache_info->gen = entry->gen;
   }
-  if(perfcounter) perfcounter->inc(l_rgw_cache_hit);
+  count_hit();
 
   return 0;
 }
@@ -97,7 +103,20 @@ bool ObjectCache::chain_cache_entry(const DoutPrefixProvider *dpp,
                                     std::initializer_list<rgw_cache_entry_info*> cache_info_entries,
 				    RGWChainedCache::Entry *chained_entry)
 {
-  std::unique_lock l{lock};
+  /* the entries may live in different shards. lock them in shard order, so
+   * we can't deadlock with another chain_cache_entry() */
+  std::vector<Shard*> locked;
+  locked.reserve(cache_info_entries.size());
+  for (auto cache_info : cache_info_entries) {
+    locked.push_back(&get_shard(cache_info->cache_locator));
+  }
+  std::sort(locked.begin(), locked.end());
+  locked.erase(std::unique(locked.begin(), locked.end()), locked.end());
+  std::vector<std::unique_lock<ceph::shared_mutex>> locks;
+  locks.reserve(locked.size());
+  for (auto shard : locked) {
+    locks.emplace_back(shard->lock);
+  }
 
   if (!enabled) {
     return false;
@@ -109,6 +128,7 @@ bool ObjectCache::chain_cache_entry(const DoutPrefixProvider *dpp,
   for (auto cache_info : cache_info_entries) {
     ldpp_dout(dpp, 10) << "chain_cache_entry: cache_locator="
 		   << cache_info->cache_locator << dendl;
+    auto& cache_map = get_shard(cache_info->cache_locator).cache_map;
     auto iter = cache_map.find(cache_info->cache_locator);
     if (iter == cache_map.end()) {
       ldpp_dout(dpp, 20) << "chain_cache_entry: couldn't find cache locator" << dendl;
@@ -139,8 +159,10 @@ bool ObjectCache::chain_cache_entry(const DoutPrefixProvider *dpp,
 
 void ObjectCache::put(const DoutPrefixProvider *dpp, const string& name, ObjectCacheInfo& info, rgw_cache_entry_info *cache_info)
 {
-  std::unique_lock l{lock};
+  auto& shard = get_shard(name);
+  std::unique_lock l{shard.lock};
 
+  // set_enabled() holds every shard lock, so check under ours
   if (!enabled) {
     return;
   }
@@ -148,21 +170,24 @@ void ObjectCache::put(const DoutPrefixProvider *dpp, const string& name, ObjectC
   ldpp_dout(dpp, 10) << "cache put: name=" << name << " info.flags=0x"
                  << std::hex << info.flags << std::dec << dendl;
 
-  auto [iter, inserted] = cache_map.emplace(name, ObjectCacheEntry{});
+  auto iter = shard.cache_map.find(name);
+  if (iter == shard.cache_map.end()) {
+    // make room before adding the new entry, so the hand can't pick it
+    evict(dpp, shard);
+    iter = shard.cache_map.try_emplace(name).first;
+    insert_clock(shard, name, iter->second);
+  } else {
+    iter->second.referenced = true;
+  }
   ObjectCacheEntry& entry = iter->second;
   entry.info.time_added = ceph::coarse_mono_clock::now();
-  if (inserted) {
-    entry.lru_iter = lru.end();
-  }
   ObjectCacheInfo& target = entry.info;
 
-  invalidate_lru(entry);
+  invalidate_chained(entry);
 
   entry.chained_entries.clear();
   entry.gen++;
 
-  touch_lru(dpp, name, entry, entry.lru_iter);
-
   target.status = info.status;
 
   if (info.status < 0) {
@@ -214,80 +239,69 @@ void ObjectCache::put(const DoutPrefixProvider *dpp, const string& name, ObjectC
 
 bool ObjectCache::remove(const DoutPrefixProvider *dpp, const string& name)
 {
-  std::unique_lock l{lock};
-
   if (!enabled) {
     return false;
   }
 
-  auto iter = cache_map.find(name);
-  if (iter == cache_map.end())
+  auto& shard = get_shard(name);
+  std::unique_lock l{shard.lock};
+
+  auto iter = shard.cache_map.find(name);
+  if (iter == shard.cache_map.end())
     return false;
 
   ldpp_dout(dpp, 10) << "removing " << name << " from cache" << dendl;
   ObjectCacheEntry& entry = iter->second;
 
-  for (auto& kv : entry.chained_entries) {
-    kv.first->invalidate(kv.second);
-  }
+  invalidate_chained(entry);
 
-  remove_lru(name, iter->second.lru_iter);
-  cache_map.erase(iter);
+  remove_clock(shard, iter->second.clock_iter);
+  shard.cache_map.erase(iter);
   return true;
 }
 
-void ObjectCache::touch_lru(const DoutPrefixProvider *dpp, const string& name, ObjectCacheEntry& entry,
-			    std::list<string>::iterator& lru_iter)
+void ObjectCache::insert_clock(Shard& shard, const string& name,
+                               ObjectCacheEntry& entry)
 {
-  while (lru_size > (size_t)cct->_conf->rgw_cache_lru_size) {
-    auto iter = lru.begin();
-    if ((*iter).compare(name) == 0) {
-      /*
-       * if the entry we're touching happens to be at the lru end, don't remove it,
-       * lru shrinking can wait for next time
-       */
-      break;
-    }
-    auto map_iter = cache_map.find(*iter);
-    ldout(cct, 10) << "removing entry: name=" << *iter << " from cache LRU" << dendl;
-    if (map_iter != cache_map.end()) {
-      ObjectCacheEntry& entry = map_iter->second;
-      invalidate_lru(entry);
-      cache_map.erase(map_iter);
-    }
-    lru.pop_front();
-    lru_size--;
-  }
+  // just behind the hand, so it's the last entry the hand gets to
+  entry.clock_iter = shard.clock.insert(shard.hand, name);
+  entry.referenced = false;
+}
 
-  if (lru_iter == lru.end()) {
-    lru.push_back(name);
-    lru_size++;
-    lru_iter--;
-    ldpp_dout(dpp, 10) << "adding " << name << " to cache LRU end" << dendl;
+void ObjectCache::remove_clock(Shard& shard,
+                               std::list<string>::iterator& clock_iter)
+{
+  if (clock_iter == shard.hand) {
+    shard.hand = shard.clock.erase(clock_iter);
   } else {
-    ldpp_dout(dpp, 10) << "moving " << name << " to cache LRU end" << dendl;
-    lru.erase(lru_iter);
-    lru.push_back(name);
-    lru_iter = lru.end();
-    --lru_iter;
+    shard.clock.erase(clock_iter);
   }
-
-  lru_counter++;
-  entry.lru_promotion_ts = lru_counter;
+  clock_iter = shard.clock.end();
 }
 
-void ObjectCache::remove_lru(const string& name,
-			     std::list<string>::iterator& lru_iter)
+void ObjectCache::evict(const DoutPrefixProvider *dpp, Shard& shard)
 {
-  if (lru_iter == lru.end())
-    return;
-
-  lru.erase(lru_iter);
-  lru_size--;
-  lru_iter = lru.end();
+  while (shard.clock.size() >= shard_size) {
+    if (shard.hand == shard.clock.end()) {
+      shard.hand = shard.clock.begin();
+    }
+    auto map_iter = shard.cache_map.find(*shard.hand);
+    ceph_assert(map_iter != shard.cache_map.end());
+    ObjectCacheEntry& entry = map_iter->second;
+    if (entry.referenced.load(std::memory_order_relaxed)) {
+      // give it another trip around the clock
+      entry.referenced = false;
+      ++shard.hand;
+      continue;
+    }
+    ldpp_dout(dpp, 10) << "removing entry: name=" << *shard.hand << " from cache" << dendl;
+    invalidate_chained(entry);
+    shard.cache_map.erase(map_iter);
+    shard.hand = shard.clock.erase(shard.hand);
+  }
 }
 
-void ObjectCache::invalidate_lru(ObjectCacheEntry& entry)
+void ObjectCache::invalidate_chained(ObjectCacheEntry& entry)
 {
   for (auto iter = entry.chained_entries.begin();
        iter != entry.chained_entries.end(); ++iter) {
@@ -296,9 +310,19 @@ void ObjectCache::invalidate_lru(ObjectCacheEntry& entry)
   }
 }
 
+std::vector<std::unique_lock<ceph::shared_mutex>> ObjectCache::lock_all()
+{
+  std::vector<std::unique_lock<ceph::shared_mutex>> locks;
+  locks.reserve(shards.size());
+  for (auto& shard : shards) {
+    locks.emplace_back(shard.lock);
+  }
+  return locks;
+}
+
 void ObjectCache::set_enabled(bool status)
 {
-  std::unique_lock l{lock};
+  auto locks = lock_all();
 
   enabled = status;
 
@@ -309,32 +333,45 @@ void ObjectCache::set_enabled(bool status)
 
 void ObjectCache::invalidate_all()
 {
-  std::unique_lock l{lock};
+  auto locks = lock_all();
 
   do_invalidate_all();
 }
 
 void ObjectCache::do_invalidate_all()
 {
-  cache_map.clear();
-  lru.clear();
-
-  lru_size = 0;
-  lru_counter = 0;
-  lru_window = 0;
+  for (auto& shard : shards) {
+    shard.cache_map.clear();
+    shard.clock.clear();
+    shard.hand = shard.clock.end();
+  }
 
+  std::lock_guard l{chain_lock};
   for (auto& cache : chained_cache) {
     cache->invalidate_all();
   }
 }
 
+void ObjectCache::dump_stats(Formatter *f)
+{
+  f->open_array_section("shards");
+  for (auto& shard : shards) {
+    std::shared_lock l{shard.lock};
+    f->open_object_section("shard");
+    f->dump_unsigned("entries", shard.cache_map.size());
+    f->dump_unsigned("misses", shard.misses);
+    f->close_section();
+  }
+  f->close_section();
+}
+
 void ObjectCache::chain_cache(RGWChainedCache *cache) {
-  std::unique_lock l{lock};
+  std::lock_guard l{chain_lock};
   chained_cache.push_back(cache);
 }
 
 void ObjectCache::unchain_cache(RGWChainedCache *cache) {
-  std::unique_lock l{lock};
+  std::lock_guard l{chain_lock};
 
   auto iter = chained_cache.begin();
   for (; iter != chained_cache.end(); ++iter) {
@@ -4,6 +4,7 @@
 #ifndef CEPH_RGWCACHE_H
 #define CEPH_RGWCACHE_H
 
+#include <atomic>
 #include <string>
 #include <map>
 #include <unordered_map>
@@ -146,37 +147,52 @@ public:
 
 struct ObjectCacheEntry {
   ObjectCacheInfo info;
-  std::list<string>::iterator lru_iter;
-  uint64_t lru_promotion_ts;
-  uint64_t gen;
+  std::list<string>::iterator clock_iter;
+  // set by get() and cleared by the clock hand, so hits only need a read lock
+  std::atomic<bool> referenced{false};
+  uint64_t gen{0};
   std::vector<pair<RGWChainedCache *, string> > chained_entries;
-
-  ObjectCacheEntry() : lru_promotion_ts(0), gen(0) {}
 };
 
+/*
+ * The cache is split into shards by the hash of the entry name, each with
+ * its own lock, map and share of rgw_cache_lru_size. Eviction within a shard
+ * follows the CLOCK approximation of LRU: a hit only sets the entry's
+ * referenced flag, and inserts sweep the shard's clock hand past referenced
+ * entries (clearing the flag) until they find one to evict.
+ */
 class ObjectCache {
-  std::unordered_map<string, ObjectCacheEntry> cache_map;
-  std::list<string> lru;
-  unsigned long lru_size;
-  unsigned long lru_counter;
-  unsigned long lru_window;
-  ceph::shared_mutex lock = ceph::make_shared_mutex("ObjectCache");
+  struct Shard {
+    ceph::shared_mutex lock = ceph::make_shared_mutex("ObjectCache::Shard");
+    std::unordered_map<string, ObjectCacheEntry> cache_map;
+    std::list<string> clock;
+    std::list<string>::iterator hand = clock.end();
+    std::atomic<uint64_t> misses{0};
+  };
+  std::vector<Shard> shards;
+  size_t shard_size;
   CephContext *cct;
 
+  ceph::mutex chain_lock = ceph::make_mutex("ObjectCache::chain_lock");
   vector<RGWChainedCache *> chained_cache;
 
-  bool enabled;
+  std::atomic<bool> enabled;
   ceph::timespan expiry;
 
-  void touch_lru(const DoutPrefixProvider *dpp, const string& name, ObjectCacheEntry& entry,
-		 std::list<string>::iterator& lru_iter);
-  void remove_lru(const string& name, std::list<string>::iterator& lru_iter);
-  void invalidate_lru(ObjectCacheEntry& entry);
+  Shard& get_shard(const string& name) {
+    return shards[std::hash<string>{}(name) % shards.size()];
+  }
+  std::vector<std::unique_lock<ceph::shared_mutex>> lock_all();
+
+  void insert_clock(Shard& shard, const string& name, ObjectCacheEntry& entry);
+  void remove_clock(Shard& shard, std::list<string>::iterator& clock_iter);
+  void evict(const DoutPrefixProvider *dpp, Shard& shard);
+  void invalidate_chained(ObjectCacheEntry& entry);
 
   void do_invalidate_all();
 
 public:
-  ObjectCache() : lru_size(0), lru_counter(0), lru_window(0), cct(NULL), enabled(false) { }
+  ObjectCache() : shard_size(0), cct(NULL), enabled(false) { }
   ~ObjectCache();
   int get(const DoutPrefixProvider *dpp, const std::string& name, ObjectCacheInfo& bl, uint32_t mask, rgw_cache_entry_info *cache_info);
   std::optional<ObjectCacheInfo> get(const DoutPrefixProvider *dpp, const std::string& name) {
@@ -187,10 +203,13 @@ public:
 
   template<typename F>
   void for_each(const F& f) {
-    std::shared_lock l{lock};
-    if (enabled) {
-      auto now  = ceph::coarse_mono_clock::now();
-      for (const auto& [name, entry] : cache_map) {
+    if (!enabled) {
+      return;
+    }
+    auto now  = ceph::coarse_mono_clock::now();
+    for (auto& shard : shards) {
+      std::shared_lock l{shard.lock};
+      for (const auto& [name, entry] : shard.cache_map) {
         if (expiry.count() && (now - entry.info.time_added) < expiry) {
           f(name, entry);
         }
@@ -202,7 +221,9 @@ public:
   bool remove(const DoutPrefixProvider *dpp, const std::string& name);
   void set_ctx(CephContext *_cct) {
     cct = _cct;
-    lru_window = cct->_conf->rgw_cache_lru_size / 2;
+    const auto num_shards = cct->_conf.get_val<uint64_t>("rgw_cache_shards");
+    shards = std::vector<Shard>(num_shards);
+    shard_size = std::max<size_t>(cct->_conf->rgw_cache_lru_size / num_shards, 1);
     expiry = std::chrono::seconds(cct->_conf.get_val<uint64_t>(
 						"rgw_cache_expiry_interval"));
   }
@@ -215,6 +236,10 @@ public:
   void chain_cache(RGWChainedCache *cache);
   void unchain_cache(RGWChainedCache *cache);
   void invalidate_all();
+
+  // entries and misses of each shard. hits are only counted in total, by the
+  // cache_hit perf counter
+  void dump_stats(Formatter *f);
 };
 
 #endif
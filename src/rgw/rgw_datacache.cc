@@ -0,0 +1,295 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab ft=cpp
+
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation. See file COPYING.
+ *
+ */
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#if __has_include(<filesystem>)
+#include <filesystem>
+namespace fs = std::filesystem;
+#else
+#include <experimental/filesystem>
+namespace fs = std::experimental::filesystem;
+#endif
+
+#include "common/Formatter.h"
+#include "common/Thread.h"
+#include "common/errno.h"
+#include "common/safe_io.h"
+
+#include "rgw_common.h"
+#include "rgw_datacache.h"
+#include "rgw_perf_counters.h"
+
+#define dout_context g_ceph_context
+#define dout_subsys ceph_subsys_rgw
+
+using namespace std::literals;
+
+RGWDataCache::RGWDataCache(CephContext *cct)
+  : cct(cct),
+    path(cct->_conf.get_val<std::string>("rgw_datacache_path")),
+    capacity(cct->_conf.get_val<Option::size_t>("rgw_datacache_size")),
+    max_fill_queue(cct->_conf.get_val<Option::size_t>("rgw_datacache_max_fill_queue"))
+{}
+
+RGWDataCache::~RGWDataCache()
+{
+  stop();
+}
+
+int RGWDataCache::start()
+{
+  // entries aren't persisted across restarts, so start from an empty directory
+  std::error_code ec;
+  fs::create_directories(path, ec);
+  if (ec) {
+    lderr(cct) << "ERROR: failed to create datacache directory " << path
+               << ": " << ec.message() << dendl;
+    return -ec.value();
+  }
+  for (auto& p : fs::directory_iterator(path, ec)) {
+    fs::remove_all(p.path(), ec);
+  }
+  if (ec) {
+    lderr(cct) << "ERROR: failed to clean datacache directory " << path
+               << ": " << ec.message() << dendl;
+    return -ec.value();
+  }
+
+  auto admin_socket = cct->get_admin_socket();
+  int r = admin_socket->register_command("datacache stats", this,
+                                         "show rgw datacache statistics");
+  if (r < 0) {
+    lderr(cct) << "ERROR: fail to register admin socket command (r=" << r
+               << ")" << dendl;
+    return r;
+  }
+
+  const auto num_threads = cct->_conf.get_val<uint64_t>("rgw_datacache_threads");
+  for (uint64_t i = 0; i < num_threads; ++i) {
+    workers.push_back(make_named_thread("rgw_datacache",
+                                        &RGWDataCache::worker, this));
+  }
+  ldout(cct, 1) << "rgw datacache started at " << path << " with capacity "
+                << capacity << dendl;
+  return 0;
+}
+
+void RGWDataCache::stop()
+{
+  {
+    std::lock_guard l{lock};
+    if (stopping) {
+      return;
+    }
+    stopping = true;
+  }
+  cond.notify_all();
+  for (auto& t : workers) {
+    t.join();
+  }
+  workers.clear();
+  cct->get_admin_socket()->unregister_commands(this);
+}
+
+std::string RGWDataCache::make_key(const rgw_raw_obj& obj, uint64_t ofs,
+                                   uint64_t len, const std::string& tag)
+{
+  std::string key = obj.pool.to_str();
+  key.append(1, '/');
+  key.append(obj.loc);
+  key.append(1, '/');
+  key.append(obj.oid);
+  key.append(1, '/');
+  key.append(std::to_string(ofs));
+  key.append(1, '+');
+  key.append(std::to_string(len));
+  if (!tag.empty()) {
+    key.append(1, '@');
+    key.append(tag);
+  }
+  return key;
+}
+
+std::string RGWDataCache::file_path(uint64_t file_id) const
+{
+  return path + "/" + std::to_string(file_id);
+}
+
+int RGWDataCache::lookup(const std::string& key, uint64_t len)
+{
+  std::lock_guard l{lock};
+  auto i = entries.find(key);
+  if (i == entries.end() || i->second.size != len) {
+    ++misses;
+    if (perfcounter) perfcounter->inc(l_rgw_datacache_miss);
+    return -ENOENT;
+  }
+  // open under the lock so eviction can't unlink the file before we do
+  int fd = ::open(file_path(i->second.file_id).c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    int r = -errno;
+    ldout(cct, 0) << "ERROR: datacache failed to open entry for " << key
+                  << ": " << cpp_strerror(r) << dendl;
+    ++errors;
+    used -= i->second.size;
+    lru.erase(i->second.lru_iter);
+    entries.erase(i);
+    return r;
+  }
+  lru.splice(lru.begin(), lru, i->second.lru_iter);
+  ++hits;
+  if (perfcounter) perfcounter->inc(l_rgw_datacache_hit);
+  return fd;
+}
+
+void RGWDataCache::read(int fd, uint64_t len, ReadCompletion&& c)
+{
+  auto op = [this, fd, len, c = std::move(c)] () mutable {
+    ceph::bufferptr bp = ceph::buffer::create(len);
+    int r = safe_pread_exact(fd, bp.c_str(), len, 0);
+    ::close(fd);
+    ceph::bufferlist bl;
+    if (r < 0) {
+      ldout(cct, 0) << "ERROR: datacache read failed: " << cpp_strerror(r)
+                    << dendl;
+    } else {
+      bl.append(std::move(bp));
+    }
+    std::move(c)(r, std::move(bl));
+  };
+  std::unique_lock l{lock};
+  if (stopping) {
+    l.unlock();
+    op();
+    return;
+  }
+  reads.push_back(std::move(op));
+  l.unlock();
+  cond.notify_one();
+}
+
+void RGWDataCache::fill(const std::string& key, const ceph::bufferlist& bl)
+{
+  const uint64_t len = bl.length();
+  std::unique_lock l{lock};
+  if (stopping || len == 0 || len > capacity ||
+      entries.count(key) || pending_fills.count(key)) {
+    return;
+  }
+  if (fill_queue_bytes + len > max_fill_queue) {
+    ++fill_drops;
+    return;
+  }
+  fill_queue_bytes += len;
+  pending_fills.insert(key);
+  fills.push_back(Fill{key, bl});
+  l.unlock();
+  cond.notify_one();
+}
+
+void RGWDataCache::evict(uint64_t need)
+{
+  while (!lru.empty() && used + need > capacity) {
+    auto i = entries.find(lru.back());
+    ceph_assert(i != entries.end());
+    ::unlink(file_path(i->second.file_id).c_str());
+    used -= i->second.size;
+    entries.erase(i);
+    lru.pop_back();
+    ++evictions;
+    if (perfcounter) perfcounter->inc(l_rgw_datacache_evict);
+  }
+}
+
+void RGWDataCache::do_fill(Fill& f)
+{
+  uint64_t file_id;
+  {
+    std::lock_guard l{lock};
+    file_id = next_file_id++;
+  }
+  const auto fpath = file_path(file_id);
+  int r = f.bl.write_file(fpath.c_str(), 0600);
+  std::lock_guard l{lock};
+  pending_fills.erase(f.key);
+  fill_queue_bytes -= f.bl.length();
+  if (r < 0) {
+    ldout(cct, 0) << "ERROR: datacache failed to write " << fpath
+                  << ": " << cpp_strerror(r) << dendl;
+    ++errors;
+    ::unlink(fpath.c_str());
+    return;
+  }
+  evict(f.bl.length());
+  lru.push_front(f.key);
+  entries.emplace(f.key, Entry{file_id, f.bl.length(), lru.begin()});
+  used += f.bl.length();
+  ++num_fills;
+  if (perfcounter) perfcounter->inc(l_rgw_datacache_fill);
+}
+
+void RGWDataCache::worker()
+{
+  std::unique_lock l{lock};
+  while (true) {
+    // serve reads ahead of fills, requests are waiting on them
+    if (!reads.empty()) {
+      auto op = std::move(reads.front());
+      reads.pop_front();
+      l.unlock();
+      op();
+      l.lock();
+    } else if (!fills.empty() && !stopping) {
+      auto f = std::move(fills.front());
+      fills.pop_front();
+      l.unlock();
+      do_fill(f);
+      l.lock();
+    } else if (stopping) {
+      break;
+    } else {
+      cond.wait(l);
+    }
+  }
+}
+
+void RGWDataCache::dump(ceph::Formatter *f)
+{
+  std::lock_guard l{lock};
+  f->open_object_section("datacache");
+  f->dump_string("path", path);
+  f->dump_unsigned("capacity", capacity);
+  f->dump_unsigned("used", used);
+  f->dump_unsigned("entries", entries.size());
+  f->dump_unsigned("hits", hits);
+  f->dump_unsigned("misses", misses);
+  f->dump_unsigned("fills", num_fills);
+  f->dump_unsigned("fill_drops", fill_drops);
+  f->dump_unsigned("fill_queue_bytes", fill_queue_bytes);
+  f->dump_unsigned("evictions", evictions);
+  f->dump_unsigned("errors", errors);
+  f->close_section();
+}
+
+int RGWDataCache::call(std::string_view command, const cmdmap_t& cmdmap,
+                       ceph::Formatter *f, std::ostream& ss,
+                       ceph::bufferlist& out)
+{
+  if (command == "datacache stats"sv) {
+    dump(f);
+    return 0;
+  }
+  return -ENOSYS;
+}
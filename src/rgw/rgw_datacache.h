@@ -0,0 +1,113 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab ft=cpp
+
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation. See file COPYING.
+ *
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <list>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "include/buffer.h"
+#include "include/function2.hpp"
+#include "common/ceph_mutex.h"
+#include "common/admin_socket.h"
+
+struct rgw_raw_obj;
+
+/*
+ * RGWDataCache keeps copies of object data read from RADOS in files on a
+ * local (ideally NVMe) filesystem. Entries are keyed by the raw RADOS object,
+ * the byte range read from it and, for head objects, the object tag. Tail
+ * objects are never rewritten in place, and a head object rewrite changes its
+ * tag, so a cached range can be served without revalidating it with the OSDs.
+ *
+ * Reads and fills run on a small pool of worker threads so that the frontend
+ * never blocks on local disk i/o. Fills are best-effort: if the fill queue is
+ * full the data is dropped and the next read will simply miss again.
+ */
+class RGWDataCache : public AdminSocketHook {
+public:
+  using ReadCompletion = fu2::unique_function<void(int, ceph::bufferlist&&)>;
+
+private:
+  CephContext *cct;
+  std::string path;
+  uint64_t capacity;
+  uint64_t max_fill_queue;
+
+  ceph::mutex lock = ceph::make_mutex("RGWDataCache::lock");
+  ceph::condition_variable cond;
+  bool stopping = false;
+  std::vector<std::thread> workers;
+
+  struct Entry {
+    uint64_t file_id;
+    uint64_t size;
+    std::list<std::string>::iterator lru_iter;
+  };
+  std::unordered_map<std::string, Entry> entries;
+  std::list<std::string> lru; // most recently used first
+  uint64_t used = 0;
+  uint64_t next_file_id = 0;
+
+  struct Fill {
+    std::string key;
+    ceph::bufferlist bl;
+  };
+  std::deque<Fill> fills;
+  std::unordered_set<std::string> pending_fills;
+  uint64_t fill_queue_bytes = 0;
+  std::deque<fu2::unique_function<void()>> reads;
+
+  // stats for the admin socket
+  uint64_t hits = 0;
+  uint64_t misses = 0;
+  uint64_t num_fills = 0;
+  uint64_t fill_drops = 0;
+  uint64_t evictions = 0;
+  uint64_t errors = 0;
+
+  std::string file_path(uint64_t file_id) const;
+  void worker();
+  void do_fill(Fill& f);
+  void evict(uint64_t need);
+
+public:
+  explicit RGWDataCache(CephContext *cct);
+  ~RGWDataCache() override;
+
+  int start();
+  void stop();
+
+  static std::string make_key(const rgw_raw_obj& obj, uint64_t ofs,
+                              uint64_t len, const std::string& tag);
+
+  // on a hit, returns an open file descriptor for the cached range. the
+  // descriptor remains valid even if the entry is evicted before it's read
+  int lookup(const std::string& key, uint64_t len);
+  // read the cached range from the descriptor returned by lookup() on a
+  // worker thread, then close it. the completion runs on that thread
+  void read(int fd, uint64_t len, ReadCompletion&& c);
+  // queue a copy of data read from rados to be written to the cache
+  void fill(const std::string& key, const ceph::bufferlist& bl);
+
+  void dump(ceph::Formatter *f);
+
+  int call(std::string_view command, const cmdmap_t& cmdmap,
+           ceph::Formatter *f, std::ostream& ss, ceph::bufferlist& out) override;
+};
@@ -284,6 +284,9 @@ int RGWGC::list(int *index, string& marker, uint32_t max, bool expired_only, std
   return 0;
 }
 
+/* tail deletes are single-object ops, so there is nothing to merge per pg
+ * or osd; they are sent as aio and the gc thread, which has no yield
+ * context, only waits when the window is full */
 class RGWGCIOManager {
   const DoutPrefixProvider* dpp;
   CephContext *cct;
@@ -299,10 +302,13 @@ class RGWGCIOManager {
     string oid;
     int index{-1};
     string tag;
+    RGWGCQueueBatches::Batch *batch{nullptr};
   };
 
-  deque<IO> ios;
+  /* a list, so ios can be retired out of order, and added while we walk it */
+  std::list<IO> ios;
   vector<std::vector<string> > remove_tags;
+  vector<RGWGCQueueBatches> queue_batches;
   /* tracks the number of remaining shadow objects for a given tag in order to
    * only remove the tag once all shadow objects have themselves been removed
    */
@@ -318,6 +324,7 @@ public:
     max_aio = cct->_conf->rgw_gc_max_concurrent_io;
     remove_tags.resize(min(static_cast<int>(cct->_conf->rgw_gc_max_objs), rgw_shards_max()));
     tag_io_size.resize(min(static_cast<int>(cct->_conf->rgw_gc_max_objs), rgw_shards_max()));
+    queue_batches.resize(min(static_cast<int>(cct->_conf->rgw_gc_max_objs), rgw_shards_max()));
   }
 
   ~RGWGCIOManager() {
@@ -332,7 +339,7 @@ public:
       if (gc->going_down()) {
         return 0;
       }
-      auto ret = handle_next_completion();
+      auto ret = handle_completions();
       //Return error if we are using queue, else ignore it
       if (gc->transitioned_objects_cache[index] && ret < 0) {
         return ret;
@@ -342,16 +349,44 @@ public:
     auto c = librados::Rados::aio_create_completion(nullptr, nullptr);
     int ret = ioctx->aio_operate(oid, c, op);
     if (ret < 0) {
+      c->release();
       return ret;
     }
-    ios.push_back(IO{IO::TailIO, c, oid, index, tag});
+    IO io{IO::TailIO, c, oid, index, tag};
+    if (gc->transitioned_objects_cache[index]) {
+      io.batch = queue_batches[index].io_started();
+    }
+    ios.push_back(std::move(io));
 
     return 0;
   }
 
-  int handle_next_completion() {
+  /* retire all ios that have completed, in any order, or wait for the
+   * oldest one if none have. returns the last error seen */
+  int handle_completions() {
     ceph_assert(!ios.empty());
-    IO& io = ios.front();
+    int ret_val = 0;
+    bool retired = false;
+    for (auto i = ios.begin(); i != ios.end();) {
+      if (!i->c->is_complete()) {
+        ++i;
+        continue;
+      }
+      int ret = handle_completion(*i);
+      if (ret < 0) {
+        ret_val = ret;
+      }
+      i = ios.erase(i);
+      retired = true;
+    }
+    if (!retired) {
+      ret_val = handle_completion(ios.front());
+      ios.pop_front();
+    }
+    return ret_val;
+  }
+
+  int handle_completion(IO& io) {
     io.c->wait_for_complete();
     int ret = io.c->get_return_value();
     io.c->release();
@@ -360,6 +395,10 @@ public:
       ret = 0;
     }
 
+    if (io.batch) {
+      queue_batches[io.index].io_done(io.batch, ret);
+    }
+
     if (io.type == IO::IndexIO && ! gc->transitioned_objects_cache[io.index]) {
       if (ret < 0) {
         ldpp_dout(dpp, 0) << "WARNING: gc cleanup of tags on gc shard index=" <<
@@ -379,7 +418,6 @@ public:
     }
 
   done:
-    ios.pop_front();
     return ret;
   }
 
@@ -421,7 +459,7 @@ public:
       if (gc->going_down()) {
         return -EAGAIN;
       }
-      auto ret = handle_next_completion();
+      auto ret = handle_completions();
       if (ret < 0) {
         ret_val = ret;
       }
@@ -478,6 +516,46 @@ public:
     }
   }
 
+  /* the tail ios scheduled from now on belong to a batch of num_entries
+   * listed from the queue of shard index */
+  void start_queue_batch(int index, int num_entries) {
+    queue_batches[index].start(num_entries);
+  }
+
+  void finish_queue_batch(int index) {
+    queue_batches[index].finish();
+  }
+
+  /* remove the leading batches whose tails are all gone from the queue in
+   * a single op. once a batch fails, or a removal does, nothing after it
+   * may be removed */
+  int trim_queue(int index) {
+    int num_entries = 0;
+    int ret = queue_batches[index].pop_done(&num_entries);
+    if (num_entries > 0) {
+      ldpp_dout(dpp, 5) << "RGWGC::process removing " << num_entries <<
+        " entries from queue on index=" << index << dendl;
+      int r = remove_queue_entries(index, num_entries);
+      if (r < 0) {
+        ret = r;
+      }
+    }
+    if (ret < 0) {
+      abandon_queue(index);
+    }
+    return ret;
+  }
+
+  /* forget the batches of shard index, they'll be listed again next time */
+  void abandon_queue(int index) {
+    for (auto& io : ios) {
+      if (io.index == index) {
+        io.batch = nullptr;
+      }
+    }
+    queue_batches[index].clear();
+  }
+
   int remove_queue_entries(int index, int num_entries) {
     int ret = gc->remove(index, num_entries);
     if (ret < 0) {
@@ -576,6 +654,10 @@ int RGWGC::process(int index, int max_secs, bool expired_only,
 
     marker = next_marker;
 
+    if (transitioned_objects_cache[index]) {
+      io_manager.start_queue_batch(index, entries.size());
+    }
+
     string last_pool;
     std::list<cls_rgw_gc_obj_info>::iterator iter;
     for (iter = entries.begin(); iter != entries.end(); ++iter) {
@@ -645,14 +727,11 @@ int RGWGC::process(int index, int max_secs, bool expired_only,
 	} // chains loop
       } // else -- chains not empty
     } // entries loop
-    if (transitioned_objects_cache[index] && entries.size() > 0) {
-      ret = io_manager.drain_ios();
-      if (ret < 0) {
-        goto done;
-      }
-      //Remove the entries from the queue
-      ldpp_dout(this, 5) << "RGWGC::process removing entries, marker: " << marker << dendl;
-      ret = io_manager.remove_queue_entries(index, entries.size());
+    if (transitioned_objects_cache[index]) {
+      /* don't wait for this batch's tails, keep listing while they're being
+       * removed and trim whatever is already done */
+      io_manager.finish_queue_batch(index);
+      ret = io_manager.trim_queue(index);
       if (ret < 0) {
         ldpp_dout(this, 0) <<
           "WARNING: failed to remove queue entries" << dendl;
@@ -662,9 +741,16 @@ int RGWGC::process(int index, int max_secs, bool expired_only,
   } while (truncated);
 
 done:
-  /* we don't drain here, because if we're going down we don't want to
-   * hold the system if backend is unresponsive
+  /* we don't drain if we're going down, because we don't want to hold the
+   * system if backend is unresponsive
    */
+  if (transitioned_objects_cache[index]) {
+    if (!going_down()) {
+      io_manager.drain_ios();
+      io_manager.trim_queue(index);
+    }
+    io_manager.abandon_queue(index);
+  }
   l.unlock(&store->gc_pool_ctx, obj_names[index]);
   delete ctx;
 
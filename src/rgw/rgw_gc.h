@@ -16,9 +16,82 @@
 #include "cls/rgw/cls_rgw_types.h"
 
 #include <atomic>
+#include <deque>
 
 class RGWGCIOManager;
 
+/* bookkeeping for the runs of entries listed from the head of one gc queue
+ * shard. entries can only be removed from the head of the queue, so a run
+ * is removed once all of its tail objects are gone, and a run that is still
+ * in flight, or that failed, holds back every run listed after it */
+class RGWGCQueueBatches {
+public:
+  struct Batch {
+    int num_entries{0};
+    size_t pending{0}; // tail ios in flight
+    bool scheduled{false}; // all of its tail ios were sent
+    int result{0};
+  };
+
+  /* the tail ios started from now on belong to a run of num_entries */
+  void start(int num_entries) {
+    batches.push_back(Batch{num_entries});
+  }
+
+  /* all tail ios of the current run were started */
+  void finish() {
+    batches.back().scheduled = true;
+  }
+
+  /* returns the run to pass to io_done(), or nullptr if there is none */
+  Batch *io_started() {
+    if (batches.empty()) {
+      return nullptr;
+    }
+    auto& b = batches.back();
+    ++b.pending;
+    return &b;
+  }
+
+  void io_done(Batch *b, int ret) {
+    --b->pending;
+    if (ret < 0 && b->result == 0) {
+      b->result = ret;
+    }
+  }
+
+  /* pop the leading runs whose tail ios are all done and add up their
+   * entries in num_entries. returns the error of the first failed run, which
+   * is left in place along with everything after it */
+  int pop_done(int *num_entries) {
+    *num_entries = 0;
+    while (!batches.empty()) {
+      auto& b = batches.front();
+      if (!b.scheduled || b.pending > 0) {
+        break;
+      }
+      if (b.result < 0) {
+        return b.result;
+      }
+      *num_entries += b.num_entries;
+      batches.pop_front();
+    }
+    return 0;
+  }
+
+  void clear() {
+    batches.clear();
+  }
+
+  size_t size() const {
+    return batches.size();
+  }
+
+private:
+  // deque, so the Batch pointers handed out stay valid as runs come and go
+  std::deque<Batch> batches;
+};
+
 class RGWGC : public DoutPrefixProvider {
   CephContext *cct;
   RGWRados *store;
@@ -438,6 +438,15 @@ public:
     list_params.prefix = prefix;
   }
 
+  /* list only the given bucket index shard, from its start. entries of the
+   * same object name are in the same shard, so the rules still see all of
+   * an object's versions in a row */
+  void set_shard(int shard_id) {
+    list_params.shard_id = shard_id;
+    list_params.marker = rgw_obj_key();
+    pre_obj = rgw_bucket_dir_entry();
+  }
+
   int init(const DoutPrefixProvider *dpp) {
     return fetch(dpp);
   }
@@ -503,6 +512,34 @@ public:
 
 }; /* LCObjsLister */
 
+/* per-bucket throughput, updated by the listers and the workpool threads
+ * and logged when the bucket is done. perf counters can't be keyed by
+ * bucket, so they only get the totals over all buckets */
+struct lc_bucket_counters {
+  std::atomic<uint64_t> listed{0};
+  std::atomic<uint64_t> processed{0};
+  std::atomic<uint64_t> errors{0};
+
+  void inc_listed() {
+    ++listed;
+    if (perfcounter) {
+      perfcounter->inc(l_rgw_lc_listed, 1);
+    }
+  }
+  void inc_processed() {
+    ++processed;
+    if (perfcounter) {
+      perfcounter->inc(l_rgw_lc_processed, 1);
+    }
+  }
+  void inc_errors() {
+    ++errors;
+    if (perfcounter) {
+      perfcounter->inc(l_rgw_lc_process_errors, 1);
+    }
+  }
+}; /* lc_bucket_counters */
+
 struct op_env {
 
   using LCWorker = RGWLC::LCWorker;
@@ -512,11 +549,13 @@ struct op_env {
   LCWorker* worker;
   rgw::sal::Bucket* bucket;
   LCObjsLister& ol;
+  lc_bucket_counters* counters;
 
   op_env(lc_op& _op, rgw::sal::Store* _store, LCWorker* _worker,
-	 rgw::sal::Bucket* _bucket, LCObjsLister& _ol)
+	 rgw::sal::Bucket* _bucket, LCObjsLister& _ol,
+	 lc_bucket_counters* _counters)
     : op(_op), store(_store), worker(_worker), bucket(_bucket),
-      ol(_ol) {}
+      ol(_ol), counters(_counters) {}
 }; /* op_env */
 
 class LCRuleOp;
@@ -558,6 +597,8 @@ struct lc_op_ctx {
 
 }; /* lc_op_ctx */
 
+/* blocks the calling workpool thread; the delete's olh, gc and bilog steps
+ * have no async form, so the workpool size bounds the deletes in flight */
 static int remove_expired_obj(const DoutPrefixProvider *dpp, lc_op_ctx& oc, bool remove_indeed)
 {
   auto& store = oc.store;
@@ -770,7 +811,7 @@ class RGWLC::WorkPool
 {
   using TVector = ceph::containers::tiny_vector<WorkQ, 3>;
   TVector wqs;
-  uint64_t ix;
+  std::atomic<uint64_t> ix; // the shard listers enqueue concurrently
 
 public:
   WorkPool(RGWLC::LCWorker* wk, uint16_t n_threads, uint32_t qmax)
@@ -795,8 +836,7 @@ public:
   }
 
   void enqueue(WorkItem item) {
-    const auto tix = ix;
-    ix = (ix+1) % wqs.size();
+    const auto tix = ix++ % wqs.size();
     (wqs[tix]).enqueue(std::move(item));
   }
 
@@ -1418,8 +1458,10 @@ int LCOpRule::process(rgw_bucket_dir_entry& o,
 			<< env.bucket << ":" << o.key
 			<< " " << cpp_strerror(r)
 			<< " " << wq->thr_name() << dendl;
+      env.counters->inc_errors();
       return r;
     }
+    env.counters->inc_processed();
     ldpp_dout(dpp, 20) << "processed:" << env.bucket << ":"
 		       << o.key << " " << wq->thr_name() << dendl;
   }
@@ -1454,6 +1496,29 @@ int RGWLC::bucket_lc_process(string& shard_id, LCWorker* worker,
     return ret;
   }
 
+  /* the queued work items point at the counters, so they must outlive the
+   * drain below */
+  lc_bucket_counters counters;
+  const auto start_time = ceph::mono_clock::now();
+  auto log_counters = make_scope_guard(
+    [&]
+      {
+	const auto duration = ceph::mono_clock::now() - start_time;
+	if (perfcounter) {
+	  perfcounter->tinc(l_rgw_lc_bucket_lat, duration);
+	}
+	const auto elapsed = std::chrono::duration<double>(duration).count();
+	const auto processed = counters.processed.load();
+	ldpp_dout(this, 2) << "LC: bucket=" << bucket_tenant << ":"
+			   << bucket_name << " listed=" << counters.listed.load()
+			   << " processed=" << processed
+			   << " errors=" << counters.errors.load()
+			   << " elapsed=" << elapsed << "s"
+			   << " rate=" << (elapsed > 0 ? processed / elapsed : 0)
+			   << "/s" << dendl;
+      }
+    );
+
   auto stack_guard = make_scope_guard(
     [&worker]
       {
@@ -1505,6 +1570,15 @@ int RGWLC::bucket_lc_process(string& shard_id, LCWorker* worker,
 		      << prefix_map.size()
 		      << dendl;
 
+  /* list the index shards in parallel, each feeding the workpool. a bucket
+   * with a single shard is listed as a whole from this thread */
+  const auto num_shards =
+    bucket->get_info().layout.current_index.layout.normal.num_shards;
+  const auto max_listers = std::max<int64_t>(
+    cct->_conf.get_val<int64_t>("rgw_lc_max_shard_listers"), 1);
+  const uint32_t num_listers = num_shards > 1 ?
+    std::min<uint32_t>(num_shards, max_listers) : 1;
+
   rgw_obj_key pre_marker;
   rgw_obj_key next_marker;
   for(auto prefix_iter = prefix_map.begin(); prefix_iter != prefix_map.end();
@@ -1531,27 +1605,69 @@ int RGWLC::bucket_lc_process(string& shard_id, LCWorker* worker,
       pre_marker = next_marker;
     }
 
-    LCObjsLister ol(store, bucket.get());
-    ol.set_prefix(prefix_iter->first);
-
-    ret = ol.init(this);
-    if (ret < 0) {
-      if (ret == (-ENOENT))
-        return 0;
-      ldpp_dout(this, 0) << "ERROR: store->list_objects():" <<dendl;
-      return ret;
+    /* the queued items refer to their lister, so keep them all until the
+     * workpool is drained */
+    std::vector<LCObjsLister> listers;
+    listers.reserve(num_listers);
+    for (uint32_t i = 0; i < num_listers; ++i) {
+      listers.emplace_back(store, bucket.get());
+      listers.back().set_prefix(prefix_iter->first);
     }
 
-    op_env oenv(op, store, worker, bucket.get(), ol);
-    LCOpRule orule(oenv);
-    orule.build(); // why can't ctor do it?
-    rgw_bucket_dir_entry* o{nullptr};
-    for (; ol.get_obj(this, &o /* , fetch_barrier */); ol.next()) {
-      orule.update();
-      std::tuple<LCOpRule, rgw_bucket_dir_entry> t1 = {orule, *o};
-      worker->workpool->enqueue(WorkItem{t1});
+    auto list_shard = [&] (LCObjsLister& ol, int shard) {
+      ol.set_shard(shard);
+      int ret = ol.init(this);
+      if (ret < 0) {
+	if (ret == (-ENOENT))
+	  return 0;
+	ldpp_dout(this, 0) << "ERROR: store->list_objects():" <<dendl;
+	return ret;
+      }
+
+      op_env oenv(op, store, worker, bucket.get(), ol, &counters);
+      LCOpRule orule(oenv);
+      orule.build(); // why can't ctor do it?
+      rgw_bucket_dir_entry* o{nullptr};
+      for (; ol.get_obj(this, &o /* , fetch_barrier */); ol.next()) {
+	orule.update();
+	counters.inc_listed();
+	std::tuple<LCOpRule, rgw_bucket_dir_entry> t1 = {orule, *o};
+	worker->workpool->enqueue(WorkItem{t1});
+	if (going_down()) {
+	  break;
+	}
+      }
+      return 0;
+    };
+
+    if (num_listers == 1) {
+      ret = list_shard(listers.front(), RGW_NO_SHARD);
+    } else {
+      std::atomic<uint32_t> next_shard{0};
+      std::atomic<int> list_ret{0};
+      std::vector<std::thread> threads;
+      threads.reserve(num_listers);
+      for (auto& ol : listers) {
+	threads.push_back(make_named_thread("lc_lister", [&] {
+	  for (auto shard = next_shard++; shard < num_shards && !going_down();
+	       shard = next_shard++) {
+	    int r = list_shard(ol, shard);
+	    if (r < 0) {
+	      int expected = 0;
+	      list_ret.compare_exchange_strong(expected, r);
+	    }
+	  }
+	}));
+      }
+      for (auto& t : threads) {
+	t.join();
+      }
+      ret = list_ret;
     }
     worker->workpool->drain();
+    if (ret < 0) {
+      return ret;
+    }
   }
 
   ret = handle_multipart_expiration(bucket.get(), prefix_map, worker, stop_at, once);
@@ -183,6 +183,32 @@ int list_multipart_parts(const DoutPrefixProvider *dpp, rgw::sal::Bucket* bucket
   return 0;
 }
 
+int decode_sorted_multipart_parts(const DoutPrefixProvider *dpp,
+				  const map<string, bufferlist>& parts_map,
+				  map<uint32_t, RGWUploadPartInfo>& parts)
+{
+  for (const auto& [key, bl] : parts_map) {
+    auto bli = bl.cbegin();
+    RGWUploadPartInfo info;
+    try {
+      decode(info, bli);
+    } catch (buffer::error& err) {
+      ldpp_dout(dpp, 0) << "ERROR: could not part info, caught buffer::error" <<
+	dendl;
+      return -EIO;
+    }
+    char buf[32];
+    snprintf(buf, sizeof(buf), "part.%08d", info.num);
+    if (key != buf) {
+      /* the entry wasn't written with a sorted key, as done by gateways
+       * that don't support sorted omap keys for multipart uploads */
+      return -EAGAIN;
+    }
+    parts[info.num] = std::move(info);
+  }
+  return 0;
+}
+
 int list_multipart_parts(const DoutPrefixProvider *dpp, struct req_state *s,
 			 const string& upload_id,
 			 const string& meta_oid, int num_parts,
@@ -126,6 +126,13 @@ extern int list_multipart_parts(const DoutPrefixProvider *dpp,
                                 int *next_marker, bool *truncated,
                                 bool assume_unsorted = false);
 
+/* decode part entries read from the meta object of a v2 upload. returns
+ * -EAGAIN if an entry isn't stored under its sorted key, in which case the
+ * parts have to be listed with list_multipart_parts() instead */
+extern int decode_sorted_multipart_parts(const DoutPrefixProvider *dpp,
+                                         const map<string, bufferlist>& parts_map,
+                                         map<uint32_t, RGWUploadPartInfo>& parts);
+
 extern int abort_multipart_upload(const DoutPrefixProvider *dpp, rgw::sal::Store* store,
 				  CephContext *cct, RGWObjectCtx *obj_ctx,
 				  rgw::sal::Bucket* bucket, RGWMPObj& mp_obj);
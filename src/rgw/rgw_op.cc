@@ -45,6 +45,7 @@
 #include "rgw_role.h"
 #include "rgw_tag_s3.h"
 #include "rgw_putobj_processor.h"
+#include "rgw_putobj_pipeline.h"
 #include "rgw_crypt.h"
 #include "rgw_perf_counters.h"
 #include "rgw_notify.h"
@@ -3870,6 +3871,16 @@ void RGWPutObj::execute(optional_yield y)
 
   std::unique_ptr<DataProcessor> encrypt;
 
+  // hashes and filters on the worker pool. declared after the filters so
+  // its workers are drained before the filters are destroyed
+  boost::optional<PipelineProcessor> pipeline;
+  auto pipeline_pool = get_pipeline_pool(s->cct);
+  if (pipeline_pool) {
+    pipeline.emplace(*pipeline_pool, s->cct->_conf->rgw_put_obj_min_window_size,
+                     s->yield, need_calc_md5 ? &hash : nullptr, filter);
+    filter = pipeline->get_sink();
+  }
+
   if (!append) { // compression and encryption only apply to full object uploads
     op_ret = get_encrypt_filter(&encrypt, filter);
     if (op_ret < 0) {
@@ -3888,6 +3899,18 @@ void RGWPutObj::execute(optional_yield y)
       }
     }
   }
+
+  if (pipeline) {
+    if (filter != pipeline->get_sink()) {
+      pipeline->set_filter(filter);
+      filter = &*pipeline;
+    } else if (need_calc_md5) {
+      filter = &*pipeline;
+    } else { // nothing to offload
+      filter = processor.get();
+      pipeline = boost::none;
+    }
+  }
   tracepoint(rgw_op, before_data_transfer, s->req_id.c_str());
   do {
     bufferlist data;
@@ -3912,7 +3935,7 @@ void RGWPutObj::execute(optional_yield y)
       break;
     }
 
-    if (need_calc_md5) {
+    if (need_calc_md5 && !pipeline) {
       hash.Update((const unsigned char *)data.c_str(), data.length());
     }
 
@@ -5867,6 +5890,7 @@ void RGWCompleteMultipart::execute(optional_yield y)
   RGWMPObj mp;
   RGWObjManifest manifest;
   uint64_t olh_epoch = 0;
+  const auto start_time = ceph::mono_clock::now();
 
   op_ret = get_params(y);
   if (op_ret < 0)
@@ -5919,7 +5943,7 @@ void RGWCompleteMultipart::execute(optional_yield y)
   int handled_parts = 0;
   int max_parts = 1000;
   int marker = 0;
-  bool truncated;
+  bool truncated = true;
   RGWCompressionInfo cs_info;
   bool compressed = false;
   uint64_t accounted_size = 0;
@@ -5964,29 +5988,12 @@ void RGWCompleteMultipart::execute(optional_yield y)
   }
   attrs = meta_obj->get_attrs();
 
-  do {
-    op_ret = list_multipart_parts(this, s, upload_id, meta_oid, max_parts,
-				  marker, obj_parts, &marker, &truncated);
-    if (op_ret == -ENOENT) {
-      op_ret = -ERR_NO_SUCH_UPLOAD;
-    }
-    if (op_ret < 0)
-      return;
-
-    total_parts += obj_parts.size();
-    if (!truncated && total_parts != (int)parts->parts.size()) {
-      ldpp_dout(this, 0) << "NOTICE: total parts mismatch: have: " << total_parts
-		       << " expected: " << parts->parts.size() << dendl;
-      op_ret = -ERR_INVALID_PART;
-      return;
-    }
-
+  auto handle_parts = [&] () -> int {
     for (obj_iter = obj_parts.begin(); iter != parts->parts.end() && obj_iter != obj_parts.end(); ++iter, ++obj_iter, ++handled_parts) {
       uint64_t part_size = obj_iter->second.accounted_size;
       if (handled_parts < (int)parts->parts.size() - 1 &&
           part_size < min_part_size) {
-        op_ret = -ERR_TOO_SMALL;
-        return;
+        return -ERR_TOO_SMALL;
       }
 
       char petag[CEPH_CRYPTO_MD5_DIGESTSIZE];
@@ -5994,15 +6001,13 @@ void RGWCompleteMultipart::execute(optional_yield y)
         ldpp_dout(this, 0) << "NOTICE: parts num mismatch: next requested: "
 			 << iter->first << " next uploaded: "
 			 << obj_iter->first << dendl;
-        op_ret = -ERR_INVALID_PART;
-        return;
+        return -ERR_INVALID_PART;
       }
       string part_etag = rgw_string_unquote(iter->second);
       if (part_etag.compare(obj_iter->second.etag) != 0) {
         ldpp_dout(this, 0) << "NOTICE: etag mismatch: part: " << iter->first
 			 << " etag: " << iter->second << dendl;
-        op_ret = -ERR_INVALID_PART;
-        return;
+        return -ERR_INVALID_PART;
       }
 
       hex_to_buf(obj_iter->second.etag.c_str(), petag,
@@ -6019,8 +6024,7 @@ void RGWCompleteMultipart::execute(optional_yield y)
       if (obj_part.manifest.empty()) {
         ldpp_dout(this, 0) << "ERROR: empty manifest for object part: obj="
 			 << src_obj << dendl;
-        op_ret = -ERR_INVALID_PART;
-        return;
+        return -ERR_INVALID_PART;
       } else {
         manifest.append(this, obj_part.manifest, store->get_zone());
       }
@@ -6031,8 +6035,7 @@ void RGWCompleteMultipart::execute(optional_yield y)
             (cs_info.compression_type != obj_part.cs_info.compression_type))) {
           ldpp_dout(this, 0) << "ERROR: compression type was changed during multipart upload ("
                            << cs_info.compression_type << ">>" << obj_part.cs_info.compression_type << ")" << dendl;
-          op_ret = -ERR_INVALID_PART;
-          return; 
+          return -ERR_INVALID_PART;
       }
       
       if (part_compressed) {
@@ -6063,7 +6066,135 @@ void RGWCompleteMultipart::execute(optional_yield y)
       ofs += obj_part.size;
       accounted_size += obj_part.accounted_size;
     }
-  } while (truncated);
+    return 0;
+  };
+
+  if (is_v2_upload_id(upload_id)) {
+    /* the part entries of v2 uploads are sorted by part number, so the
+     * requested parts can be split into windows whose entries are read in
+     * parallel. each window is added to the manifest as soon as it and the
+     * ones before it have been read, while the next ones are in flight */
+    struct PartsWindow {
+      string marker;
+      size_t count = 0;
+      map<string, bufferlist> entries;
+      bool more = false;
+    };
+    vector<PartsWindow> windows;
+    int prev_num = 0;
+    for (const auto& p : parts->parts) {
+      if (windows.empty() || windows.back().count == (size_t)max_parts) {
+        char buf[32];
+        snprintf(buf, sizeof(buf), "part.%08d", prev_num);
+        windows.emplace_back().marker = buf;
+      }
+      windows.back().count++;
+      prev_num = p.first;
+    }
+
+    const size_t max_aio = std::max<uint64_t>(1,
+        s->cct->_conf.get_val<uint64_t>("rgw_multipart_complete_max_aio"));
+    std::unique_ptr<rgw::sal::Completions> aio[2] = {
+      store->get_completions(), store->get_completions() };
+    // the entry buffers must outlive any read still in flight
+    auto drain_aio = make_scope_guard([&] {
+        aio[0]->drain();
+        aio[1]->drain();
+      });
+
+    auto read_windows = [&] (size_t first, rgw::sal::Completions* c) -> int {
+      const size_t end = std::min(first + max_aio, windows.size());
+      for (size_t i = first; i < end; ++i) {
+        auto& w = windows[i];
+        int r = meta_obj->omap_get_vals_aio(this, w.marker, w.count,
+                                            &w.entries, &w.more, c);
+        if (r < 0) {
+          return r;
+        }
+      }
+      return 0;
+    };
+
+    op_ret = read_windows(0, aio[0].get());
+    if (op_ret < 0) {
+      return;
+    }
+    bool sorted = true;
+    for (size_t first = 0, n = 0; sorted && first < windows.size();
+         first += max_aio, ++n) {
+      if (first + max_aio < windows.size()) {
+        op_ret = read_windows(first + max_aio, aio[(n + 1) % 2].get());
+        if (op_ret < 0) {
+          return;
+        }
+      }
+      op_ret = aio[n % 2]->drain();
+      if (op_ret == -ENOENT) {
+        op_ret = -ERR_NO_SUCH_UPLOAD;
+      }
+      if (op_ret < 0) {
+        return;
+      }
+
+      const size_t end = std::min(first + max_aio, windows.size());
+      for (size_t i = first; i < end; ++i) {
+        auto& w = windows[i];
+        obj_parts.clear();
+        op_ret = decode_sorted_multipart_parts(this, w.entries, obj_parts);
+        if (op_ret == -EAGAIN) {
+          // continue from the last handled part with a regular listing
+          ldpp_dout(this, 5) << "part entries of upload " << upload_id
+			     << " are not sorted, listing the remaining parts" << dendl;
+          sorted = false;
+          op_ret = 0;
+          break;
+        }
+        if (op_ret < 0) {
+          return;
+        }
+
+        total_parts += obj_parts.size();
+        if (obj_parts.size() != w.count ||
+            (i + 1 == windows.size() && w.more)) {
+          ldpp_dout(this, 0) << "NOTICE: total parts mismatch: have: " << total_parts
+			   << " expected: " << parts->parts.size() << dendl;
+          op_ret = -ERR_INVALID_PART;
+          return;
+        }
+
+        op_ret = handle_parts();
+        if (op_ret < 0) {
+          return;
+        }
+        marker = obj_parts.rbegin()->first;
+        w.entries.clear();
+      }
+    }
+    truncated = !sorted;
+  }
+
+  while (truncated) {
+    op_ret = list_multipart_parts(this, s, upload_id, meta_oid, max_parts,
+				  marker, obj_parts, &marker, &truncated);
+    if (op_ret == -ENOENT) {
+      op_ret = -ERR_NO_SUCH_UPLOAD;
+    }
+    if (op_ret < 0)
+      return;
+
+    total_parts += obj_parts.size();
+    if (!truncated && total_parts != (int)parts->parts.size()) {
+      ldpp_dout(this, 0) << "NOTICE: total parts mismatch: have: " << total_parts
+		       << " expected: " << parts->parts.size() << dendl;
+      op_ret = -ERR_INVALID_PART;
+      return;
+    }
+
+    op_ret = handle_parts();
+    if (op_ret < 0) {
+      return;
+    }
+  }
   hash.Final((unsigned char *)final_etag);
 
   buf_to_hex((unsigned char *)final_etag, sizeof(final_etag), final_etag_str);
@@ -6099,6 +6230,13 @@ void RGWCompleteMultipart::execute(optional_yield y)
 
   std::unique_ptr<rgw::sal::Object::WriteOp> obj_op = target_obj->get_write_op(&obj_ctx);
 
+  // drop the index entry of the meta object along with those of the parts.
+  // the meta object is not versioned when the bucket is, as that would add
+  // an unneeded delete marker
+  rgw_obj_index_key meta_key;
+  meta_obj->get_key().get_index_key(&meta_key);
+  remove_objs.push_back(meta_key);
+
   obj_op->params.manifest = &manifest;
   obj_op->params.remove_objs = &remove_objs;
 
@@ -6117,15 +6255,13 @@ void RGWCompleteMultipart::execute(optional_yield y)
   if (op_ret < 0)
     return;
 
-  // remove the upload meta object ; the meta object is not versioned
-  // when the bucket is, as that would add an unneeded delete marker
-  int r = meta_obj->delete_object(this, s->obj_ctx, y, true /* prevent versioning */);
-  if (r >= 0)  {
-    /* serializer's exclusive lock is released */
-    serializer->clear_locked();
-  } else {
-    ldpp_dout(this, 0) << "WARNING: failed to remove object " << meta_obj << dendl;
-  }
+  // remove the upload meta object. its index entry went away with the
+  // write of the head object, so only the rados object is left to remove,
+  // which is done while the notification is committed
+  rgw_raw_obj meta_raw_obj;
+  meta_obj->get_raw_obj(&meta_raw_obj);
+  std::unique_ptr<rgw::sal::Completions> meta_aio = store->get_completions();
+  int r = store->delete_raw_obj_aio(this, meta_raw_obj, meta_aio.get());
 
   // send request to notification manager
   int ret = res->publish_commit(this, ofs, ceph::real_clock::now(), final_etag_str);
@@ -6133,6 +6269,37 @@ void RGWCompleteMultipart::execute(optional_yield y)
     ldpp_dout(this, 1) << "ERROR: publishing notification failed, with error: " << ret << dendl;
     // too late to rollback operation, hence op_ret is not set here
   }
+
+  if (r >= 0) {
+    r = meta_aio->drain();
+  }
+  if (r >= 0 || r == -ENOENT)  {
+    /* serializer's exclusive lock is released */
+    serializer->clear_locked();
+  } else {
+    // nothing in the index refers to the meta object any more, so hand it
+    // to gc rather than leak it
+    ldpp_dout(this, 0) << "WARNING: failed to remove object " << meta_obj
+                       << ", r=" << r << "; deferring it to gc" << dendl;
+    std::unique_ptr<rgw::sal::GCChain> chain = store->get_gc_chain(meta_obj.get());
+    chain->add_raw_obj(meta_raw_obj);
+    r = chain->send(s->req_id);
+    if (r < 0) {
+      ldpp_dout(this, 0) << "ERROR: failed to send " << meta_obj
+                         << " to gc, r=" << r << "; it is leaked" << dendl;
+    }
+  }
+
+  if (perfcounter) {
+    const auto lat = ceph::mono_clock::now() - start_time;
+    if (parts->parts.size() <= 100) {
+      perfcounter->tinc(l_rgw_mp_complete_lat_100, lat);
+    } else if (parts->parts.size() <= 1000) {
+      perfcounter->tinc(l_rgw_mp_complete_lat_1000, lat);
+    } else {
+      perfcounter->tinc(l_rgw_mp_complete_lat_more, lat);
+    }
+  }
 } // RGWCompleteMultipart::execute
 
 bool RGWCompleteMultipart::check_previously_completed(const RGWMultiCompleteUpload* parts)
@@ -25,12 +25,24 @@ int rgw_perf_start(CephContext *cct)
   plb.add_u64_counter(l_rgw_put_b, "put_b", "Size of puts");
   plb.add_time_avg(l_rgw_put_lat, "put_initial_lat", "Put latency");
 
+  plb.add_time_avg(l_rgw_mp_complete_lat_100, "mp_complete_lat_100",
+                   "Multipart completion latency, up to 100 parts");
+  plb.add_time_avg(l_rgw_mp_complete_lat_1000, "mp_complete_lat_1000",
+                   "Multipart completion latency, 101 to 1000 parts");
+  plb.add_time_avg(l_rgw_mp_complete_lat_more, "mp_complete_lat_more",
+                   "Multipart completion latency, more than 1000 parts");
+
   plb.add_u64(l_rgw_qlen, "qlen", "Queue length");
   plb.add_u64(l_rgw_qactive, "qactive", "Active requests queue");
 
   plb.add_u64_counter(l_rgw_cache_hit, "cache_hit", "Cache hits");
   plb.add_u64_counter(l_rgw_cache_miss, "cache_miss", "Cache miss");
 
+  plb.add_u64_counter(l_rgw_datacache_hit, "datacache_hit", "Data cache hits");
+  plb.add_u64_counter(l_rgw_datacache_miss, "datacache_miss", "Data cache miss");
+  plb.add_u64_counter(l_rgw_datacache_fill, "datacache_fill", "Data cache fills");
+  plb.add_u64_counter(l_rgw_datacache_evict, "datacache_evict", "Data cache evictions");
+
   plb.add_u64_counter(l_rgw_keystone_token_cache_hit, "keystone_token_cache_hit", "Keystone token cache hits");
   plb.add_u64_counter(l_rgw_keystone_token_cache_miss, "keystone_token_cache_miss", "Keystone token cache miss");
 
@@ -49,6 +61,14 @@ int rgw_perf_start(CephContext *cct)
 		      "Lifecycle non-current transition");
   plb.add_u64_counter(l_rgw_lc_abort_mpu, "lc_abort_mpu",
 		      "Lifecycle abort multipart upload");
+  plb.add_u64_counter(l_rgw_lc_listed, "lc_listed",
+		      "Lifecycle entries listed from bucket indexes, all buckets");
+  plb.add_u64_counter(l_rgw_lc_processed, "lc_processed",
+		      "Lifecycle entries processed, all buckets");
+  plb.add_u64_counter(l_rgw_lc_process_errors, "lc_process_errors",
+		      "Lifecycle entries that failed to process, all buckets");
+  plb.add_time_avg(l_rgw_lc_bucket_lat, "lc_bucket_lat",
+		   "Lifecycle processing time per bucket");
 
   plb.add_u64_counter(l_rgw_pubsub_event_triggered, "pubsub_event_triggered", "Pubsub events with at least one topic");
   plb.add_u64_counter(l_rgw_pubsub_event_lost, "pubsub_event_lost", "Pubsub events lost");
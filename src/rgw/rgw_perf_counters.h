@@ -22,12 +22,21 @@ enum {
   l_rgw_put_b,
   l_rgw_put_lat,
 
+  l_rgw_mp_complete_lat_100,
+  l_rgw_mp_complete_lat_1000,
+  l_rgw_mp_complete_lat_more,
+
   l_rgw_qlen,
   l_rgw_qactive,
 
   l_rgw_cache_hit,
   l_rgw_cache_miss,
 
+  l_rgw_datacache_hit,
+  l_rgw_datacache_miss,
+  l_rgw_datacache_fill,
+  l_rgw_datacache_evict,
+
   l_rgw_keystone_token_cache_hit,
   l_rgw_keystone_token_cache_miss,
 
@@ -39,6 +48,10 @@ enum {
   l_rgw_lc_transition_current,
   l_rgw_lc_transition_noncurrent,
   l_rgw_lc_abort_mpu,
+  l_rgw_lc_listed,
+  l_rgw_lc_processed,
+  l_rgw_lc_process_errors,
+  l_rgw_lc_bucket_lat,
 
   l_rgw_pubsub_event_triggered,
   l_rgw_pubsub_event_lost,
@@ -0,0 +1,193 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab ft=cpp
+
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation. See file COPYING.
+ *
+ */
+
+#include <boost/asio/post.hpp>
+
+#include "common/ceph_context.h"
+#include "rgw_aio_throttle.h"
+#include "rgw_putobj_pipeline.h"
+
+namespace rgw::putobj {
+
+namespace {
+
+struct PipelinePool {
+  std::unique_ptr<boost::asio::thread_pool> pool;
+
+  explicit PipelinePool(CephContext *cct) {
+    const auto threads =
+        cct->_conf.get_val<uint64_t>("rgw_put_obj_pipeline_threads");
+    if (threads > 0) {
+      pool = std::make_unique<boost::asio::thread_pool>(threads);
+    }
+  }
+};
+
+} // anonymous namespace
+
+boost::asio::thread_pool *get_pipeline_pool(CephContext *cct)
+{
+  auto& p = cct->lookup_or_create_singleton_object<PipelinePool>(
+      "rgw::putobj::PipelinePool", false, cct);
+  return p.pool.get();
+}
+
+int PipelineProcessor::Sink::process(bufferlist&& data, uint64_t offset)
+{
+  pipeline->current->output.emplace_back(std::move(data), offset);
+  return 0;
+}
+
+PipelineProcessor::PipelineProcessor(boost::asio::thread_pool& pool,
+                                     uint64_t window_size, optional_yield y,
+                                     ceph::crypto::MD5 *hash,
+                                     DataProcessor *next)
+  : aio(make_throttle(window_size, y)),
+    y(y),
+    hash_strand(boost::asio::make_strand(pool)),
+    filter_strand(boost::asio::make_strand(pool)),
+    hash(hash),
+    next(next),
+    sink(this)
+{}
+
+PipelineProcessor::~PipelineProcessor()
+{
+  // the workers reference the jobs, wait for them before they go away
+  aio->drain();
+}
+
+Aio::OpFunc PipelineProcessor::run(Job& job)
+{
+  // start the hash and filter stages of the job. the last stage to finish
+  // calls complete(), which hands the result back to the throttle
+  auto start = [this, &job] (auto complete) {
+    const bool hash_stage = hash && job.data.length() > 0;
+    const bool filter_stage = filter != nullptr;
+    job.pending = int(hash_stage) + int(filter_stage);
+    if (job.pending == 0) {
+      complete();
+      return;
+    }
+    if (filter_stage) {
+      // the hash stage reads job.data concurrently, so filter a copy
+      boost::asio::post(filter_strand,
+          [this, &job, bl = bufferlist{job.data}, complete] () mutable {
+            current = &job;
+            job.result = filter->process(std::move(bl), job.offset);
+            current = nullptr;
+            if (--job.pending == 0) {
+              complete();
+            }
+          });
+    }
+    if (hash_stage) {
+      boost::asio::post(hash_strand, [this, &job, complete] {
+            for (const auto& p : job.data.buffers()) {
+              hash->Update((const unsigned char *)p.c_str(), p.length());
+            }
+            if (--job.pending == 0) {
+              complete();
+            }
+          });
+    }
+  };
+
+  if (y) {
+    auto yield = y.get_yield_context();
+    return [start = std::move(start), &job, yield] (Aio* aio, AioResult& r) mutable {
+        // the stages finish on the worker pool, so post the result back to
+        // the yield_context's strand executor like librados_op does
+        using namespace boost::asio;
+        async_completion<spawn::yield_context, void()> init(yield);
+        auto ex = get_associated_executor(init.completion_handler);
+        start([aio, &r, &job, ex] {
+            post(ex, [aio, &r, &job] {
+                r.result = job.result;
+                aio->put(r);
+              });
+          });
+      };
+  }
+  return [start = std::move(start), &job] (Aio* aio, AioResult& r) mutable {
+      start([aio, &r, &job] {
+          r.result = job.result;
+          aio->put(r);
+        });
+    };
+}
+
+int PipelineProcessor::complete(AioResultList&& results)
+{
+  for (auto& r : results) {
+    auto& job = jobs[r.id - first_id];
+    job.done = true;
+    if (r.result < 0 && error == 0) {
+      error = r.result;
+    }
+  }
+  // pass on the output of finished jobs in order
+  while (!jobs.empty() && jobs.front().done) {
+    auto& job = jobs.front();
+    for (auto& [bl, offset] : job.output) {
+      if (error < 0) {
+        break;
+      }
+      error = next->process(std::move(bl), offset);
+    }
+    jobs.pop_front();
+    ++first_id;
+  }
+  return error;
+}
+
+int PipelineProcessor::submit(bufferlist&& data, uint64_t offset)
+{
+  const uint64_t id = first_id + jobs.size();
+  auto& job = jobs.emplace_back(std::move(data), offset);
+  const uint64_t cost = std::max<uint64_t>(job.data.length(), 1);
+  return complete(aio->get(RGWSI_RADOS::Obj{}, run(job), cost, id));
+}
+
+int PipelineProcessor::process(bufferlist&& data, uint64_t offset)
+{
+  if (error < 0) {
+    return error;
+  }
+  const bool flush = (data.length() == 0);
+
+  if (!filter) {
+    // only the hash runs on the workers, so the data can go on right away
+    if (!flush) {
+      int r = submit(bufferlist{data}, offset);
+      if (r < 0) {
+        return r;
+      }
+    } else {
+      int r = complete(aio->drain());
+      if (r < 0) {
+        return r;
+      }
+    }
+    return next->process(std::move(data), offset);
+  }
+
+  // the filter sees the flush in order, and forwards it to the sink itself
+  int r = submit(std::move(data), offset);
+  if (r < 0 || !flush) {
+    return r;
+  }
+  return complete(aio->drain());
+}
+
+} // namespace rgw::putobj
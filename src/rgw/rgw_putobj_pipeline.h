@@ -0,0 +1,99 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab ft=cpp
+
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation. See file COPYING.
+ *
+ */
+
+#pragma once
+
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include <boost/asio/strand.hpp>
+#include <boost/asio/thread_pool.hpp>
+
+#include "common/async/yield_context.h"
+#include "common/ceph_crypto.h"
+#include "rgw_aio.h"
+#include "rgw_putobj.h"
+
+namespace rgw::putobj {
+
+// DataProcessor that moves the cpu-bound work of an upload off the request's
+// thread. the etag hash and an optional filter (compression or encryption)
+// each run in order on their own strand of a shared worker pool, so chunk N+1
+// can be hashed and filtered while chunk N is still being written to rados.
+// the filter's output is passed on to the next processor in order, from the
+// thread that calls process(), so the rados writes keep their own throttle.
+// the number of bytes being hashed or filtered is bounded by an Aio throttle
+class PipelineProcessor : public DataProcessor {
+  using Strand = boost::asio::strand<boost::asio::thread_pool::executor_type>;
+
+  // collects the filter's output for the job it's currently running
+  class Sink : public DataProcessor {
+    PipelineProcessor *pipeline;
+   public:
+    explicit Sink(PipelineProcessor *pipeline) : pipeline(pipeline) {}
+    int process(bufferlist&& data, uint64_t offset) override;
+  };
+
+  struct Job {
+    bufferlist data;
+    uint64_t offset;
+    std::vector<std::pair<bufferlist, uint64_t>> output;
+    std::atomic<int> pending{0}; // stages that haven't finished yet
+    int result = 0; // result of the filter stage
+    bool done = false;
+    Job(bufferlist&& data, uint64_t offset)
+      : data(std::move(data)), offset(offset) {}
+  };
+
+  std::unique_ptr<Aio> aio;
+  optional_yield y;
+  Strand hash_strand;
+  Strand filter_strand;
+  ceph::crypto::MD5 *hash;
+  DataProcessor *filter = nullptr;
+  DataProcessor *next;
+  Sink sink;
+
+  std::deque<Job> jobs; // in submission order
+  uint64_t first_id = 0; // id of jobs.front()
+  Job *current = nullptr; // job being filtered, only used on filter_strand
+  int error = 0;
+
+  Aio::OpFunc run(Job& job);
+  // mark completed jobs done and pass the output of the ones at the front of
+  // the queue on to the next processor
+  int complete(AioResultList&& results);
+  int submit(bufferlist&& data, uint64_t offset);
+
+ public:
+  // hash may be null if the etag isn't needed
+  PipelineProcessor(boost::asio::thread_pool& pool, uint64_t window_size,
+                    optional_yield y, ceph::crypto::MD5 *hash,
+                    DataProcessor *next);
+  ~PipelineProcessor() override;
+
+  // the processor the filter must write its output to
+  DataProcessor *get_sink() { return &sink; }
+  // run the given filter, which writes to get_sink(), on the worker pool
+  void set_filter(DataProcessor *f) { filter = f; }
+
+  int process(bufferlist&& data, uint64_t offset) override;
+};
+
+// returns the worker pool shared by all uploads, or null if it's disabled
+boost::asio::thread_pool *get_pipeline_pool(CephContext *cct);
+
+} // namespace rgw::putobj
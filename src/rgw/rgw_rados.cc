@@ -27,6 +27,7 @@
 #include "rgw_acl.h"
 #include "rgw_acl_s3.h" /* for dumping s3policy in debug log */
 #include "rgw_aio_throttle.h"
+#include "rgw_datacache.h"
 #include "rgw_bucket.h"
 #include "rgw_rest_conn.h"
 #include "rgw_cr_rados.h"
@@ -766,7 +767,6 @@ class RGWIndexCompletionManager;
 
 struct complete_op_data {
   ceph::mutex lock = ceph::make_mutex("complete_op_data");
-  AioCompletion *rados_completion{nullptr};
   int manager_shard_id{-1};
   RGWIndexCompletionManager *manager{nullptr};
   rgw_obj obj;
@@ -786,6 +786,212 @@ struct complete_op_data {
     std::lock_guard l{lock};
     stopped = true;
   }
+
+  rgw_cls_obj_complete_op to_cls_op() const {
+    rgw_cls_obj_complete_op call;
+    call.op = op;
+    call.tag = tag;
+    call.key = key;
+    call.ver = ver;
+    call.meta = dir_meta;
+    call.log_op = log_op;
+    call.bilog_flags = bilog_op;
+    call.remove_objs = remove_objs;
+    call.zones_trace = zones_trace;
+    return call;
+  }
+};
+
+static void complete_entry(complete_op_data *completion, int r);
+
+/*
+ * Coalesces the complete ops sent to the same bucket index shard. Only one
+ * op is in flight per shard object, and the completions that arrive in the
+ * meantime are sent together in a single bucket_complete_ops call once it
+ * finishes. A batch never holds two ops on the same object, and a batch
+ * that fails is resent one op at a time, so each op gets its own result.
+ * The rados callbacks hold a reference, so this may outlive the
+ * RGWIndexCompletionManager.
+ */
+class RGWIndexCompletionBatcher
+  : public std::enable_shared_from_this<RGWIndexCompletionBatcher> {
+  struct Shard {
+    RGWSI_RADOS::Obj obj;
+    std::vector<complete_op_data *> pending;
+    size_t send_singly = 0; // entries at the front of pending to send alone
+  };
+
+  struct Batch {
+    std::shared_ptr<RGWIndexCompletionBatcher> batcher;
+    RGWSI_RADOS::Obj obj;
+    std::string key; // set if the batch holds the shard's in-flight slot
+    std::vector<complete_op_data *> entries;
+  };
+
+  ceph::mutex lock = ceph::make_mutex("RGWIndexCompletionBatcher::lock");
+  std::map<std::string, Shard> shards; // shards with an op in flight
+  const size_t max_batch;
+  std::atomic<bool> batch_supported{true};
+
+  static void batch_cb(completion_t cb, void *arg) {
+    std::unique_ptr<Batch> b{static_cast<Batch *>(arg)};
+    int r = rados_aio_get_return_value(cb);
+    auto batcher = b->batcher;
+    batcher->finish(std::move(b), r);
+  }
+
+  // on success the batch is owned by its rados completion
+  int send(std::unique_ptr<Batch>& b) {
+    librados::ObjectWriteOperation o;
+    cls_rgw_guard_bucket_resharding(o, -ERR_BUSY_RESHARDING);
+    if (b->entries.size() == 1) {
+      auto& e = *b->entries.front();
+      cls_rgw_bucket_complete_op(o, e.op, e.tag, e.ver, e.key, e.dir_meta,
+                                 &e.remove_objs, e.log_op, e.bilog_op,
+                                 &e.zones_trace);
+    } else {
+      std::vector<rgw_cls_obj_complete_op> ops;
+      ops.reserve(b->entries.size());
+      for (auto e : b->entries) {
+        ops.push_back(e->to_cls_op());
+      }
+      cls_rgw_bucket_complete_ops(o, ops);
+    }
+    auto c = librados::Rados::aio_create_completion(b.get(), batch_cb);
+    int r = b->obj.aio_operate(c, &o);
+    c->release();
+    if (r < 0) {
+      for (auto e : b->entries) {
+        complete_entry(e, r);
+      }
+      return r;
+    }
+    b.release();
+    return 0;
+  }
+
+  // send a single entry without holding the shard's in-flight slot
+  int send_one(const RGWSI_RADOS::Obj& obj, complete_op_data *e) {
+    auto b = std::make_unique<Batch>(Batch{shared_from_this(), obj, {}, {e}});
+    return send(b);
+  }
+
+  // the number of entries from the front of pending that can go in one
+  // batch: bucket_complete_ops can't apply two ops on the same object
+  // together, so stop before the first entry naming an object already in
+  // the batch
+  static size_t batch_size(const std::vector<complete_op_data *>& pending,
+                           size_t max) {
+    std::set<std::string> names;
+    size_t n = 0;
+    for (; n < pending.size() && n < max; ++n) {
+      const auto e = pending[n];
+      std::set<std::string> entry_names{e->key.name};
+      for (const auto& k : e->remove_objs) {
+        entry_names.insert(k.name);
+      }
+      if (std::any_of(entry_names.begin(), entry_names.end(),
+                      [&names] (const std::string& name) {
+                        return names.count(name) > 0;
+                      })) {
+        break;
+      }
+      names.insert(entry_names.begin(), entry_names.end());
+    }
+    return std::max<size_t>(n, 1);
+  }
+
+  // pass the shard's in-flight slot on to the entries queued for it, or
+  // release it if there are none
+  void send_next(const RGWSI_RADOS::Obj& obj, const std::string& key) {
+    for (;;) {
+      auto b = std::make_unique<Batch>(Batch{shared_from_this(), obj, key, {}});
+      {
+        std::lock_guard l{lock};
+        auto i = shards.find(key);
+        if (i == shards.end()) {
+          return;
+        }
+        auto& pending = i->second.pending;
+        if (pending.empty()) {
+          shards.erase(i);
+          return;
+        }
+        size_t n = 1;
+        if (i->second.send_singly > 0) {
+          --i->second.send_singly;
+        } else if (batch_supported) {
+          n = batch_size(pending, max_batch);
+        }
+        b->entries.assign(pending.begin(), pending.begin() + n);
+        pending.erase(pending.begin(), pending.begin() + n);
+      }
+      if (send(b) >= 0) {
+        return;
+      }
+    }
+  }
+
+  void finish(std::unique_ptr<Batch> b, int r) {
+    if (r < 0 && r != -ERR_BUSY_RESHARDING && b->entries.size() > 1) {
+      // nothing in a failed batch was applied; resend each entry on its
+      // own, ahead of anything queued since, so that only the op that
+      // failed sees the error
+      if (r == -EOPNOTSUPP) {
+        // the osd doesn't support bucket_complete_ops yet
+        batch_supported = false;
+      }
+      std::lock_guard l{lock};
+      auto& shard = shards[b->key];
+      shard.pending.insert(shard.pending.begin(),
+                           b->entries.begin(), b->entries.end());
+      shard.send_singly += b->entries.size();
+    } else {
+      for (auto e : b->entries) {
+        complete_entry(e, r);
+      }
+    }
+    if (!b->key.empty()) {
+      send_next(b->obj, b->key);
+    }
+  }
+
+public:
+  explicit RGWIndexCompletionBatcher(size_t max_batch) : max_batch(max_batch) {}
+
+  int submit(const RGWSI_RADOS::Obj& obj, complete_op_data *e) {
+    if (max_batch <= 1 || !batch_supported) {
+      return send_one(obj, e);
+    }
+    const auto& ref = obj.get_ref();
+    std::string key = ref.obj.pool.to_str() + "/" + ref.obj.oid;
+    {
+      std::lock_guard l{lock};
+      auto [i, inserted] = shards.try_emplace(key);
+      if (!inserted) {
+        i->second.pending.push_back(e);
+        return 0;
+      }
+      i->second.obj = obj;
+    }
+    auto b = std::make_unique<Batch>(Batch{shared_from_this(), obj, key, {e}});
+    int r = send(b);
+    if (r < 0) {
+      send_next(obj, key);
+    }
+    return r;
+  }
+
+  // drop the entries that haven't been sent. they must have been stopped
+  void stop() {
+    std::lock_guard l{lock};
+    for (auto& [key, shard] : shards) {
+      for (auto e : shard.pending) {
+        delete e;
+      }
+    }
+    shards.clear();
+  }
 };
 
 class RGWIndexCompletionThread : public RGWRadosThread, public DoutPrefixProvider {
@@ -874,6 +1080,7 @@ class RGWIndexCompletionManager {
   vector<set<complete_op_data *> > completions;
 
   RGWIndexCompletionThread *completion_thread{nullptr};
+  std::shared_ptr<RGWIndexCompletionBatcher> batcher;
 
   int num_shards;
 
@@ -892,6 +1099,8 @@ public:
   {
     num_shards = store->ctx()->_conf->rgw_thread_pool_size;
     completions.resize(num_shards);
+    batcher = std::make_shared<RGWIndexCompletionBatcher>(
+      store->ctx()->_conf.get_val<uint64_t>("rgw_bucket_index_max_complete_batch"));
   }
   ~RGWIndexCompletionManager() {
     stop();
@@ -912,7 +1121,12 @@ public:
                          uint16_t bilog_op,
                          rgw_zone_set *zones_trace,
                          complete_op_data **result);
-  bool handle_completion(completion_t cb, complete_op_data *arg);
+  bool handle_completion(int r, complete_op_data *arg);
+
+  // send the completion to the given index shard object
+  int submit(const RGWSI_RADOS::Obj& obj, complete_op_data *arg) {
+    return batcher->submit(obj, arg);
+  }
 
   int start(const DoutPrefixProvider *dpp) {
     completion_thread = new RGWIndexCompletionThread(store);
@@ -936,19 +1150,19 @@ public:
       }
     }
     completions.clear();
+    batcher->stop();
   }
 };
 
-static void obj_complete_cb(completion_t cb, void *arg)
+static void complete_entry(complete_op_data *completion, int r)
 {
-  complete_op_data *completion = (complete_op_data *)arg;
   completion->lock.lock();
   if (completion->stopped) {
     completion->lock.unlock(); /* can drop lock, no one else is referencing us */
     delete completion;
     return;
   }
-  bool need_delete = completion->manager->handle_completion(cb, completion);
+  bool need_delete = completion->manager->handle_completion(r, completion);
   completion->lock.unlock();
   if (need_delete) {
     delete completion;
@@ -995,13 +1209,11 @@ void RGWIndexCompletionManager::create_completion(const rgw_obj& obj,
 
   *result = entry;
 
-  entry->rados_completion = librados::Rados::aio_create_completion(entry, obj_complete_cb);
-
   std::lock_guard l{locks[shard_id]};
   completions[shard_id].insert(entry);
 }
 
-bool RGWIndexCompletionManager::handle_completion(completion_t cb, complete_op_data *arg)
+bool RGWIndexCompletionManager::handle_completion(int r, complete_op_data *arg)
 {
   int shard_id = arg->manager_shard_id;
   {
@@ -1017,7 +1229,6 @@ bool RGWIndexCompletionManager::handle_completion(completion_t cb, complete_op_d
     comps.erase(iter);
   }
 
-  int r = rados_aio_get_return_value(cb);
   if (r != -ERR_BUSY_RESHARDING) {
     return true;
   }
@@ -1072,6 +1283,9 @@ void RGWRados::finalize()
   delete obj_expirer;
   obj_expirer = NULL;
 
+  delete datacache;
+  datacache = nullptr;
+
   RGWQuotaHandler::free_handler(quota_handler);
   if (cr_registry) {
     cr_registry->put();
@@ -1208,6 +1422,17 @@ int RGWRados::init_complete(const DoutPrefixProvider *dpp)
 
   obj_expirer = new RGWObjectExpirer(this->store);
 
+  if (cct->_conf.get_val<bool>("rgw_datacache_enabled")) {
+    datacache = new RGWDataCache(cct);
+    ret = datacache->start();
+    if (ret < 0) {
+      ldpp_dout(dpp, 0) << "ERROR: failed to start datacache: "
+                        << cpp_strerror(-ret) << dendl;
+      delete datacache;
+      datacache = nullptr;
+    }
+  }
+
   if (use_gc_thread && use_gc) {
     gc->start_processor();
     obj_expirer->start_processor();
@@ -6340,6 +6565,8 @@ struct get_obj_data {
   uint64_t offset; // next offset to write to client
   rgw::AioResultList completed; // completed read results, sorted by offset
   optional_yield yield;
+  // datacache keys and lengths of rados reads that missed the cache, by id
+  std::map<uint64_t, std::pair<std::string, uint64_t>> fills;
 
   get_obj_data(RGWRados* store, RGWGetDataCB* cb, rgw::Aio* aio,
                uint64_t offset, optional_yield yield)
@@ -6351,6 +6578,19 @@ struct get_obj_data {
       return r;
     }
 
+    if (!fills.empty()) {
+      for (auto& e : results) {
+        auto i = fills.find(e.id);
+        if (i == fills.end()) {
+          continue;
+        }
+        if (e.data.length() == i->second.second) {
+          store->get_datacache()->fill(i->second.first, e.data);
+        }
+        fills.erase(i);
+      }
+    }
+
     auto cmp = [](const auto& lhs, const auto& rhs) { return lhs.id < rhs.id; };
     results.sort(cmp); // merge() requires results to be sorted first
     completed.merge(results, cmp); // merge results in sorted order
@@ -6437,11 +6677,29 @@ int RGWRados::get_obj_iterate_cb(const DoutPrefixProvider *dpp,
     return r;
   }
 
+  const uint64_t cost = len;
+  const uint64_t id = obj_ofs; // use logical object offset for sorting replies
+
+  /* tail objects are immutable, but the head may be rewritten in place so it
+   * can only be cached under the tag we've already read with the attrs */
+  std::string cache_key;
+  if (datacache && (!is_head_obj || (astate && astate->obj_tag.length()))) {
+    cache_key = RGWDataCache::make_key(read_obj, read_ofs, len,
+                                       is_head_obj ? astate->obj_tag.to_str() : "");
+    int fd = datacache->lookup(cache_key, len);
+    if (fd >= 0) {
+      ldpp_dout(dpp, 20) << "datacache->get_obj_iterate_cb oid=" << read_obj.oid << " obj-ofs=" << obj_ofs << " read_ofs=" << read_ofs << " len=" << len << dendl;
+      auto completed = d->aio->get(obj, rgw::Aio::datacache_op(datacache, fd, len, d->yield), cost, id);
+      return d->flush(std::move(completed));
+    }
+  }
+
   ldpp_dout(dpp, 20) << "rados->get_obj_iterate_cb oid=" << read_obj.oid << " obj-ofs=" << obj_ofs << " read_ofs=" << read_ofs << " len=" << len << dendl;
   op.read(read_ofs, len, nullptr, nullptr);
 
-  const uint64_t cost = len;
-  const uint64_t id = obj_ofs; // use logical object offset for sorting replies
+  if (!cache_key.empty()) {
+    d->fills.emplace(id, std::make_pair(std::move(cache_key), (uint64_t)len));
+  }
 
   auto completed = d->aio->get(obj, rgw::Aio::librados_op(std::move(op), d->yield), cost, id);
 
@@ -8237,7 +8495,6 @@ int RGWRados::cls_obj_complete_op(BucketShard& bs, const rgw_obj& obj, RGWModify
                                   rgw_bucket_dir_entry& ent, RGWObjCategory category,
 				  list<rgw_obj_index_key> *remove_objs, uint16_t bilog_flags, rgw_zone_set *_zones_trace)
 {
-  ObjectWriteOperation o;
   rgw_bucket_dir_entry_meta dir_meta;
   dir_meta = ent.meta;
   dir_meta.category = category;
@@ -8252,16 +8509,12 @@ int RGWRados::cls_obj_complete_op(BucketShard& bs, const rgw_obj& obj, RGWModify
   ver.pool = pool;
   ver.epoch = epoch;
   cls_rgw_obj_key key(ent.key.name, ent.key.instance);
-  cls_rgw_guard_bucket_resharding(o, -ERR_BUSY_RESHARDING);
-  cls_rgw_bucket_complete_op(o, op, tag, ver, key, dir_meta, remove_objs,
-                             svc.zone->get_zone().log_data, bilog_flags, &zones_trace);
   complete_op_data *arg;
   index_completion_manager->create_completion(obj, op, tag, ver, key, dir_meta, remove_objs,
                                               svc.zone->get_zone().log_data, bilog_flags, &zones_trace, &arg);
-  librados::AioCompletion *completion = arg->rados_completion;
-  int ret = bs.bucket_obj.aio_operate(arg->rados_completion, &o);
-  completion->release(); /* can't reference arg here, as it might have already been released */
-  return ret;
+  /* can't reference arg after this, as it might have already been released.
+   * concurrent completions to the same shard are sent together */
+  return index_completion_manager->submit(bs.bucket_obj, arg);
 }
 
 int RGWRados::cls_obj_complete_add(BucketShard& bs, const rgw_obj& obj, string& tag,
@@ -8418,25 +8671,47 @@ int RGWRados::cls_bucket_list_ordered(const DoutPrefixProvider *dpp,
     return r;
   }
 
-  // to manage the iterators through each shard's list results
+  // to manage the iterators through each shard's list results; when a
+  // shard that is still truncated runs low, more of it is read and
+  // appended as another segment, so references to entries in earlier
+  // segments remain valid
   struct ShardTracker {
+    using segments_t = std::list<rgw_cls_list_ret>;
+
     const size_t shard_idx;
-    rgw_cls_list_ret& result;
     const std::string& oid_name;
+    segments_t segments;
+    segments_t::iterator segment;
     RGWRados::ent_map_t::iterator cursor;
     RGWRados::ent_map_t::iterator end;
+    cls_rgw_obj_key next_start; // marker to read more from this shard
+    uint32_t last_request; // number of entries last requested
 
     // manages an iterator through a shard and provides other
     // accessors
     ShardTracker(size_t _shard_idx,
-		 rgw_cls_list_ret& _result,
-		 const std::string& _oid_name):
+		 const std::string& _oid_name,
+		 rgw_cls_list_ret&& _result,
+		 uint32_t _requested):
       shard_idx(_shard_idx),
-      result(_result),
-      oid_name(_oid_name),
-      cursor(_result.dir.m.begin()),
-      end(_result.dir.m.end())
-    {}
+      oid_name(_oid_name)
+    {
+      add_segment(std::move(_result), _requested);
+    }
+
+    void add_segment(rgw_cls_list_ret&& result, uint32_t requested) {
+      const bool was_at_end = segments.empty() || at_end();
+      last_request = requested;
+      if (!result.dir.m.empty()) {
+	next_start = result.dir.m.rbegin()->second.key;
+      }
+      segments.push_back(std::move(result));
+      if (was_at_end) {
+	segment = std::prev(segments.end());
+	cursor = segment->dir.m.begin();
+	end = segment->dir.m.end();
+      }
+    }
 
     inline const std::string& entry_name() const {
       return cursor->first;
@@ -8445,10 +8720,23 @@ int RGWRados::cls_bucket_list_ordered(const DoutPrefixProvider *dpp,
       return cursor->second;
     }
     inline bool is_truncated() const {
-      return result.is_truncated;
+      return segments.back().is_truncated;
+    }
+    // entries left before we'd need to read more from this shard
+    inline size_t buffered() const {
+      size_t n = end - cursor;
+      for (auto s = std::next(segment); s != segments.end(); ++s) {
+	n += s->dir.m.size();
+      }
+      return n;
     }
     inline ShardTracker& advance() {
       ++cursor;
+      while (cursor == end && std::next(segment) != segments.end()) {
+	++segment;
+	cursor = segment->dir.m.begin();
+	end = segment->dir.m.end();
+      }
       // return a self-reference to allow for chaining of calls, such
       // as x.advance().at_end()
       return *this;
@@ -8458,60 +8746,147 @@ int RGWRados::cls_bucket_list_ordered(const DoutPrefixProvider *dpp,
     }
   }; // ShardTracker
 
-  // add the next unique candidate, or return false if we reach the end
-  auto next_candidate = [] (CephContext *cct, ShardTracker& t,
-                            std::map<std::string, size_t>& candidates,
-                            size_t tracker_idx) {
-    while (!t.at_end()) {
-      if (candidates.emplace(t.entry_name(), tracker_idx).second) {
-        return;
-      }
-      t.advance(); // skip duplicate common prefixes
-    }
-  };
-
   // one tracker per shard requested (may not be all shards)
   std::vector<ShardTracker> results_trackers;
   results_trackers.reserve(shard_list_results.size());
   for (auto& r : shard_list_results) {
-    results_trackers.emplace_back(r.first, r.second, shard_oids[r.first]);
-
-    // if any *one* shard's result is trucated, the entire result is
-    // truncated
-    *is_truncated = *is_truncated || r.second.is_truncated;
-
     // unless *all* are shards are cls_filtered, the entire result is
     // not filtered
     *cls_filtered = *cls_filtered && r.second.cls_filtered;
-  }
 
-  // create a map to track the next candidate entry from ShardTracker
-  // (key=candidate, value=index into results_trackers); as we consume
-  // entries from shards, we replace them with the next entries in the
-  // shards until we run out
-  map<string, size_t> candidates;
-  size_t tracker_idx = 0;
-  for (auto& t : results_trackers) {
-    // it's important that the values in the map refer to the index
-    // into the results_trackers vector, which may not be the same
-    // as the shard number (i.e., when not all shards are requested)
-    next_candidate(cct, t, candidates, tracker_idx);
-    ++tracker_idx;
-  }
+    results_trackers.emplace_back(r.first, shard_oids[r.first],
+				  std::move(r.second), num_entries_per_shard);
+  }
+  shard_list_results.clear();
+
+  // read more entries from the given shards that ran out before we've
+  // found num_entries; shards that are about to run out are topped up
+  // in the same parallel round. each shard is asked for twice as much
+  // as last time, but never more than the remaining entries we need,
+  // since a shard can't contribute more than that
+  auto top_up = [&](const std::vector<size_t>& exhausted,
+		    const uint32_t remaining) -> int {
+    map<int, CLSRGWIssueBucketListShards::Request> requests;
+    map<int, string> oids;
+    map<int, size_t> idx_by_shard;
+    auto add_request = [&](size_t idx) {
+      auto& t = results_trackers[idx];
+      const uint32_t n = std::min(remaining, 2 * t.last_request);
+      requests[t.shard_idx] = {t.next_start, n};
+      oids[t.shard_idx] = t.oid_name;
+      idx_by_shard[t.shard_idx] = idx;
+    };
+    for (auto idx : exhausted) {
+      add_request(idx);
+    }
+    for (size_t idx = 0; idx < results_trackers.size(); ++idx) {
+      auto& t = results_trackers[idx];
+      if (!t.at_end() && t.is_truncated() &&
+	  t.buffered() <= t.last_request / 4) {
+	add_request(idx);
+      }
+    }
+
+    ldpp_dout(dpp, 20) << "RGWRados::" << __func__ <<
+      ": topping up " << exhausted.size() << " exhausted and " <<
+      (requests.size() - exhausted.size()) << " low shard(s)" << dendl;
+
+    map<int, rgw_cls_list_ret> results;
+    int r = CLSRGWIssueBucketListShards(ioctx, requests, prefix, delimiter,
+					list_versions, oids, results,
+					cct->_conf->rgw_bucket_index_max_aio)();
+    if (r < 0) {
+      return r;
+    }
+    for (auto& [shard, result] : results) {
+      auto& t = results_trackers[idx_by_shard[shard]];
+      *cls_filtered = *cls_filtered && result.cls_filtered;
+      t.add_segment(std::move(result), requests[shard].num_entries);
+    }
+    return 0;
+  };
+
+  // a min-heap of the trackers' current entries, holding indices into
+  // results_trackers (which may not be the same as the shard number,
+  // i.e., when not all shards are requested); as we consume entries
+  // from shards, we push them back with their next entries until we
+  // run out
+  auto heap_cmp = [&results_trackers](size_t lhs, size_t rhs) {
+    return results_trackers[lhs].entry_name() >
+      results_trackers[rhs].entry_name();
+  };
+  std::vector<size_t> heap;
+  heap.reserve(results_trackers.size());
+  for (size_t idx = 0; idx < results_trackers.size(); ++idx) {
+    if (!results_trackers[idx].at_end()) {
+      heap.push_back(idx);
+    }
+  }
+  std::make_heap(heap.begin(), heap.end(), heap_cmp);
+
+  // put an advanced tracker back on the heap, or note that we need to
+  // read more from it before merging can continue
+  std::vector<size_t> exhausted;
+  auto requeue = [&](size_t idx) {
+    auto& t = results_trackers[idx];
+    if (!t.at_end()) {
+      heap.push_back(idx);
+      std::push_heap(heap.begin(), heap.end(), heap_cmp);
+    } else if (t.is_truncated()) {
+      exhausted.push_back(idx);
+    }
+  };
 
   rgw_bucket_dir_entry*
     last_entry_visited = nullptr; // to set last_entry (marker)
+  const string* last_name = nullptr; // to skip duplicate common prefixes
   map<string, bufferlist> updates;
   uint32_t count = 0;
-  while (count < num_entries && !candidates.empty()) {
+  while (count < num_entries) {
+    if (!exhausted.empty()) {
+      // we cannot be certain that one of the next entries doesn't
+      // come from the exhausted shards, so read more from them
+      // before continuing
+      r = top_up(exhausted, num_entries - count);
+      if (r < 0) {
+	return r;
+      }
+      bool stalled = false;
+      for (auto idx : exhausted) {
+	auto& t = results_trackers[idx];
+	if (!t.at_end()) {
+	  heap.push_back(idx);
+	  std::push_heap(heap.begin(), heap.end(), heap_cmp);
+	} else if (t.is_truncated()) {
+	  stalled = true; // shard returned nothing but is still truncated
+	}
+      }
+      exhausted.clear();
+      if (stalled) {
+	// S3 and swift protocols allow returning fewer than what was
+	// requested
+	break;
+      }
+    }
+    if (heap.empty()) {
+      break;
+    }
+
     r = 0;
-    // select the next entry in lexical order (first key in map);
-    // again tracker_idx is not necessarily shard number, but is index
-    // into results_trackers vector
-    tracker_idx = candidates.begin()->second;
+    // select the next entry in lexical order (top of the heap)
+    std::pop_heap(heap.begin(), heap.end(), heap_cmp);
+    const size_t tracker_idx = heap.back();
+    heap.pop_back();
     auto& tracker = results_trackers.at(tracker_idx);
 
     const string& name = tracker.entry_name();
+    if (last_name && name == *last_name) {
+      // skip duplicate common prefixes from other shards
+      tracker.advance();
+      requeue(tracker_idx);
+      continue;
+    }
+    last_name = &name;
     rgw_bucket_dir_entry& dirent = tracker.dir_entry();
 
     ldpp_dout(dpp, 20) << "RGWRados::" << __func__ << " currently processing " <<
@@ -8559,19 +8934,8 @@ int RGWRados::cls_bucket_list_ordered(const DoutPrefixProvider *dpp,
       last_entry_visited = &tracker.dir_entry();
     }
 
-    // refresh the candidates map
-    candidates.erase(candidates.begin());
     tracker.advance();
-
-    next_candidate(cct, tracker, candidates, tracker_idx);
-
-    if (tracker.at_end() && tracker.is_truncated()) {
-      // once we exhaust one shard that is truncated, we need to stop,
-      // as we cannot be certain that one of the next entries needs to
-      // come from that shard; S3 and swift protocols allow returning
-      // fewer than what was requested
-      break;
-    }
+    requeue(tracker_idx);
   } // while we haven't provided requested # of result entries
 
   // suggest updates if there are any
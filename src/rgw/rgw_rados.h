@@ -34,6 +34,7 @@ class RGWWatcher;
 class SafeTimer;
 class ACLOwner;
 class RGWGC;
+class RGWDataCache;
 class RGWMetaNotifier;
 class RGWDataNotifier;
 class RGWLC;
@@ -404,6 +405,7 @@ class RGWRados
   RGWGC *gc = nullptr;
   RGWLC *lc;
   RGWObjectExpirer *obj_expirer;
+  RGWDataCache *datacache = nullptr;
   bool use_gc_thread;
   bool use_lc_thread;
   bool quota_threads;
@@ -511,6 +513,10 @@ public:
     return lc;
   }
 
+  RGWDataCache *get_datacache() {
+    return datacache;
+  }
+
   RGWRados& set_run_gc_thread(bool _use_gc_thread) {
     use_gc_thread = _use_gc_thread;
     return *this;
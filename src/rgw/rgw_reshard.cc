@@ -18,6 +18,7 @@
 
 #include "services/svc_zone.h"
 #include "services/svc_sys_obj.h"
+#include "services/svc_bilog_rados.h"
 #include "services/svc_tier_rados.h"
 
 #define dout_context g_ceph_context
@@ -58,6 +59,28 @@ const std::initializer_list<uint16_t> RGWBucketReshard::reshard_primes = {
   1931, 1933, 1949, 1951, 1973, 1979, 1987, 1993, 1997, 1999
 };
 
+// the index shard of new_bucket_info that an entry for cls_key belongs in
+static int get_target_shard(rgw::sal::RadosStore* store,
+			    const RGWBucketInfo& new_bucket_info,
+			    const cls_rgw_obj_key& cls_key,
+			    int *shard_index)
+{
+  rgw_obj_key key(cls_key);
+  rgw_obj obj(new_bucket_info.bucket, key);
+  RGWMPObj mp;
+  if (key.ns == RGW_OBJ_NS_MULTIPART && mp.from_meta(key.name)) {
+    // place the multipart .meta object on the same shard as its head object
+    obj.index_hash_source = mp.get_key();
+  }
+  int target_shard_id;
+  int ret = store->getRados()->get_target_shard_id(new_bucket_info.layout.current_index.layout.normal, obj.get_hash_object(), &target_shard_id);
+  if (ret < 0) {
+    return ret;
+  }
+  *shard_index = (target_shard_id > 0 ? target_shard_id : 0);
+  return 0;
+}
+
 class BucketReshardShard {
   rgw::sal::RadosStore* store;
   const RGWBucketInfo& bucket_info;
@@ -378,11 +401,50 @@ int RGWBucketReshard::cancel(const DoutPrefixProvider *dpp)
   }
 
   ret = clear_resharding(dpp);
+  if (ret == 0) {
+    // an online reshard may have been interrupted while logging
+    trim_unsynced_bilog(dpp);
+  }
 
   reshard_lock.unlock();
   return ret;
 }
 
+// while the index shards are IN_LOGRECORD every change is logged, even
+// for buckets that aren't synced. nothing reads or trims the bilog of such
+// a bucket, so once a reshard is abandoned drop what it left behind
+void RGWBucketReshard::trim_unsynced_bilog(const DoutPrefixProvider *dpp)
+{
+  int ret = store->ctl()->bucket->bucket_exports_data(bucket_info.bucket,
+						       null_yield, dpp);
+  if (ret != 0) {
+    // either sync consumes the log, or we can't tell
+    return;
+  }
+
+  map<int, string> markers;
+  ret = store->svc()->bilog_rados->get_log_status(dpp, bucket_info, -1,
+						  &markers, null_yield);
+  if (ret < 0) {
+    ldpp_dout(dpp, -1) << "WARNING: " << __func__ <<
+      " failed to read bilog markers: " << cpp_strerror(-ret) << dendl;
+    return;
+  }
+  for (auto& [shard_id, marker] : markers) {
+    if (marker.empty()) {
+      continue;
+    }
+    string start_marker;
+    ret = store->svc()->bilog_rados->log_trim(dpp, bucket_info, shard_id,
+					      start_marker, marker);
+    if (ret < 0 && ret != -ENODATA) {
+      ldpp_dout(dpp, -1) << "WARNING: " << __func__ <<
+	" failed to trim bilog of shard " << shard_id << ": " <<
+	cpp_strerror(-ret) << dendl;
+    }
+  }
+}
+
 class BucketInfoReshardUpdate
 {
   const DoutPrefixProvider *dpp;
@@ -539,9 +601,203 @@ int RGWBucketReshardLock::renew(const Clock::time_point& now) {
 }
 
 
+int RGWBucketReshard::renew_locks(const DoutPrefixProvider *dpp)
+{
+  Clock::time_point now = Clock::now();
+  if (!reshard_lock.should_renew(now)) {
+    return 0;
+  }
+  // assume outer locks have timespans at least the size of ours, so
+  // can call inside conditional
+  if (outer_reshard_lock) {
+    int ret = outer_reshard_lock->renew(now);
+    if (ret < 0) {
+      return ret;
+    }
+  }
+  int ret = reshard_lock.renew(now);
+  if (ret < 0) {
+    ldpp_dout(dpp, -1) << "Error renewing bucket lock: " << ret << dendl;
+    return ret;
+  }
+  return 0;
+}
+
+// make the new index's entries for the object name match the current
+// entries in the source shard, including versioned instance and olh
+// entries, adjusting the new index's stats to match
+int RGWBucketReshard::copy_object_entries(int source_shard,
+					  const std::string& name,
+					  const RGWBucketInfo& new_bucket_info,
+					  const DoutPrefixProvider *dpp)
+{
+  constexpr uint32_t max_list = 1000;
+  auto rados = store->getRados();
+
+  list<rgw_cls_bi_entry> src_entries;
+  string marker;
+  bool is_truncated = true;
+  while (is_truncated) {
+    list<rgw_cls_bi_entry> entries;
+    int ret = rados->bi_list(dpp, bucket_info, source_shard, name, marker,
+			     max_list, &entries, &is_truncated);
+    if (ret < 0 && ret != -ENOENT) {
+      ldpp_dout(dpp, -1) << "ERROR: bi_list() on source shard " <<
+	source_shard << " returned ret=" << ret << dendl;
+      return ret;
+    }
+    if (entries.empty()) {
+      break;
+    }
+    marker = entries.back().idx;
+    src_entries.splice(src_entries.end(), entries);
+  }
+
+  int shard_index;
+  int ret = get_target_shard(store, new_bucket_info, cls_rgw_obj_key(name),
+			     &shard_index);
+  if (ret < 0) {
+    ldpp_dout(dpp, -1) << "ERROR: get_target_shard_id() returned ret=" << ret << dendl;
+    return ret;
+  }
+  RGWRados::BucketShard bs(rados);
+  ret = bs.init(new_bucket_info.bucket, shard_index,
+		new_bucket_info.layout.current_index, nullptr, dpp);
+  if (ret < 0) {
+    return ret;
+  }
+
+  list<rgw_cls_bi_entry> dst_entries;
+  marker.clear();
+  is_truncated = true;
+  while (is_truncated) {
+    list<rgw_cls_bi_entry> entries;
+    ret = rados->bi_list(bs, name, marker, max_list, &entries, &is_truncated);
+    if (ret < 0 && ret != -ENOENT) {
+      ldpp_dout(dpp, -1) << "ERROR: bi_list() on target shard " <<
+	shard_index << " returned ret=" << ret << dendl;
+      return ret;
+    }
+    if (entries.empty()) {
+      break;
+    }
+    marker = entries.back().idx;
+    dst_entries.splice(dst_entries.end(), entries);
+  }
+
+  if (src_entries.empty() && dst_entries.empty()) {
+    return 0;
+  }
+
+  // stats are applied as deltas; unsigned arithmetic wraps, so adding
+  // the two's complement of the old entry's stats subtracts them
+  map<RGWObjCategory, rgw_bucket_category_stats> stats;
+  auto account = [&stats] (rgw_cls_bi_entry& entry, bool add) {
+    cls_rgw_obj_key cls_key;
+    RGWObjCategory category;
+    rgw_bucket_category_stats s;
+    if (!entry.get_info(&cls_key, &category, &s)) {
+      return;
+    }
+    auto& target = stats[category];
+    if (add) {
+      target.num_entries += s.num_entries;
+      target.total_size += s.total_size;
+      target.total_size_rounded += s.total_size_rounded;
+      target.actual_size += s.actual_size;
+    } else {
+      target.num_entries -= s.num_entries;
+      target.total_size -= s.total_size;
+      target.total_size_rounded -= s.total_size_rounded;
+      target.actual_size -= s.actual_size;
+    }
+  };
+
+  librados::ObjectWriteOperation op;
+  set<string> src_keys;
+  for (auto& entry : src_entries) {
+    rados->bi_put(op, bs, entry);
+    account(entry, true);
+    src_keys.insert(entry.idx);
+  }
+  set<string> removed_keys;
+  for (auto& entry : dst_entries) {
+    account(entry, false);
+    if (!src_keys.count(entry.idx)) {
+      removed_keys.insert(entry.idx);
+    }
+  }
+  if (!removed_keys.empty()) {
+    op.omap_rm_keys(removed_keys);
+  }
+  cls_rgw_bucket_update_stats(op, false, stats);
+
+  ret = bs.bucket_obj.operate(dpp, &op, null_yield);
+  if (ret < 0) {
+    ldpp_dout(dpp, -1) << "ERROR: failed to update entries for " << name <<
+      " in target bucket shard " << shard_index << ": " <<
+      cpp_strerror(-ret) << dendl;
+    return ret;
+  }
+  return 0;
+}
+
+// bring the new index up to date with every change recorded in the
+// source shards' bilogs since log_markers, which are advanced past the
+// entries replayed
+int RGWBucketReshard::replay_logs(const RGWBucketInfo& new_bucket_info,
+				  map<int, string>& log_markers,
+				  int max_entries, uint64_t *num_replayed,
+				  const DoutPrefixProvider *dpp)
+{
+  *num_replayed = 0;
+  for (auto& [shard_id, marker] : log_markers) {
+    const int source_shard = shard_id;
+    auto list_page = [&] (const string& after, int max,
+			  list<rgw_bi_log_entry>& entries,
+			  bool *is_truncated) {
+      // log_list() rewrites its marker argument; we track our own
+      string m = after;
+      int ret = store->svc()->bilog_rados->log_list(dpp, bucket_info,
+						    source_shard, m, max,
+						    entries, is_truncated);
+      if (ret < 0) {
+	ldpp_dout(dpp, -1) << "ERROR: failed to list bilog of shard " <<
+	  source_shard << ": " << cpp_strerror(-ret) << dendl;
+      }
+      return ret;
+    };
+    auto replay = [&] (const list<rgw_bi_log_entry>& entries) {
+      // an object may be logged many times; copy its current state once
+      set<string> names;
+      for (const auto& entry : entries) {
+	names.insert(entry.object);
+      }
+      for (const auto& name : names) {
+	int ret = copy_object_entries(source_shard, name, new_bucket_info, dpp);
+	if (ret < 0) {
+	  return ret;
+	}
+	ret = renew_locks(dpp);
+	if (ret < 0) {
+	  return ret;
+	}
+      }
+      return 0;
+    };
+    int ret = replay_log_shard(marker, max_entries, num_replayed,
+			       list_page, replay);
+    if (ret < 0) {
+      return ret;
+    }
+  }
+  return 0;
+}
+
 int RGWBucketReshard::do_reshard(int num_shards,
 				 RGWBucketInfo& new_bucket_info,
 				 int max_entries,
+				 map<int, string>* log_markers,
 				 bool verbose,
 				 ostream *out,
 				 Formatter *formatter,
@@ -619,47 +875,26 @@ int RGWBucketReshard::do_reshard(int num_shards,
 
 	marker = entry.idx;
 
-	int target_shard_id;
 	cls_rgw_obj_key cls_key;
 	RGWObjCategory category;
 	rgw_bucket_category_stats stats;
 	bool account = entry.get_info(&cls_key, &category, &stats);
-	rgw_obj_key key(cls_key);
-	rgw_obj obj(new_bucket_info.bucket, key);
-	RGWMPObj mp;
-	if (key.ns == RGW_OBJ_NS_MULTIPART && mp.from_meta(key.name)) {
-	  // place the multipart .meta object on the same shard as its head object
-	  obj.index_hash_source = mp.get_key();
-	}
-	int ret = store->getRados()->get_target_shard_id(new_bucket_info.layout.current_index.layout.normal, obj.get_hash_object(), &target_shard_id);
+	int shard_index;
+	int ret = get_target_shard(store, new_bucket_info, cls_key, &shard_index);
 	if (ret < 0) {
 	  ldpp_dout(dpp, -1) << "ERROR: get_target_shard_id() returned ret=" << ret << dendl;
 	  return ret;
 	}
 
-	int shard_index = (target_shard_id > 0 ? target_shard_id : 0);
-
 	ret = target_shards_mgr.add_entry(shard_index, entry, account,
 					  category, stats);
 	if (ret < 0) {
 	  return ret;
 	}
 
-	Clock::time_point now = Clock::now();
-	if (reshard_lock.should_renew(now)) {
-	  // assume outer locks have timespans at least the size of ours, so
-	  // can call inside conditional
-	  if (outer_reshard_lock) {
-	    ret = outer_reshard_lock->renew(now);
-	    if (ret < 0) {
-	      return ret;
-	    }
-	  }
-	  ret = reshard_lock.renew(now);
-	  if (ret < 0) {
-	    ldpp_dout(dpp, -1) << "Error renewing bucket lock: " << ret << dendl;
-	    return ret;
-	  }
+	ret = renew_locks(dpp);
+	if (ret < 0) {
+	  return ret;
 	}
 	if (verbose_json_out) {
 	  formatter->close_section();
@@ -684,6 +919,52 @@ int RGWBucketReshard::do_reshard(int num_shards,
     return -EIO;
   }
 
+  if (log_markers) {
+    // writes continued while we copied, so catch up with the bilog
+    // until a pass is small enough to repeat with writes blocked
+    const auto max_passes =
+      store->ctx()->_conf.get_val<uint64_t>("rgw_reshard_online_max_passes");
+    const auto cutover_entries =
+      store->ctx()->_conf.get_val<uint64_t>("rgw_reshard_online_cutover_entries");
+    for (uint64_t pass = 1; pass <= max_passes; ++pass) {
+      uint64_t replayed = 0;
+      ret = replay_logs(new_bucket_info, *log_markers, max_entries,
+			&replayed, dpp);
+      if (ret < 0) {
+	return ret;
+      }
+      ldpp_dout(dpp, 10) << __func__ << ": online pass " << pass <<
+	" replayed " << replayed << " bilog entries" << dendl;
+      if (out) {
+	(*out) << "online pass " << pass << " replayed " << replayed <<
+	  " log entries" << std::endl;
+      }
+      if (replayed <= cutover_entries) {
+	break;
+      }
+    }
+
+    // block writes to the old index, then replay whatever was logged
+    // since the last pass
+    ret = set_resharding_status(dpp, new_bucket_info.bucket.bucket_id,
+				num_shards, cls_rgw_reshard_status::IN_PROGRESS);
+    if (ret < 0) {
+      return ret;
+    }
+    uint64_t replayed = 0;
+    ret = replay_logs(new_bucket_info, *log_markers, max_entries,
+		      &replayed, dpp);
+    if (ret < 0) {
+      return ret;
+    }
+    ldpp_dout(dpp, 10) << __func__ << ": cut-over replayed " << replayed <<
+      " bilog entries" << dendl;
+    if (out) {
+      (*out) << "cut-over replayed " << replayed << " log entries" <<
+	std::endl;
+    }
+  }
+
   ret = store->ctl()->bucket->link_bucket(new_bucket_info.owner, new_bucket_info.bucket, bucket_info.creation_time, null_yield, dpp);
   if (ret < 0) {
     ldpp_dout(dpp, -1) << "failed to link new bucket instance (bucket_id=" << new_bucket_info.bucket.bucket_id << ": " << cpp_strerror(-ret) << ")" << dendl;
@@ -716,6 +997,10 @@ int RGWBucketReshard::execute(int num_shards, int max_op_entries,
     return ret;
   }
 
+  const bool online =
+    store->ctx()->_conf.get_val<bool>("rgw_reshard_online");
+  map<int, string> log_markers;
+
   RGWBucketInfo new_bucket_info;
   ret = create_new_bucket_instance(num_shards, new_bucket_info, dpp);
   if (ret < 0) {
@@ -730,10 +1015,23 @@ int RGWBucketReshard::execute(int num_shards, int max_op_entries,
     }
   }
 
+  if (online) {
+    // changes from here on are replayed into the new index; anything
+    // logged before is already covered by the copy
+    ret = store->svc()->bilog_rados->get_log_status(dpp, bucket_info, -1,
+						    &log_markers, null_yield);
+    if (ret < 0) {
+      goto error_out;
+    }
+  }
+
   // set resharding status of current bucket_info & shards with
-  // information about planned resharding
+  // information about planned resharding; when online, writes continue
+  // and are recorded in the bilog until do_reshard() cuts over
   ret = set_resharding_status(dpp, new_bucket_info.bucket.bucket_id,
-			      num_shards, cls_rgw_reshard_status::IN_PROGRESS);
+			      num_shards,
+			      online ? cls_rgw_reshard_status::IN_LOGRECORD :
+			      cls_rgw_reshard_status::IN_PROGRESS);
   if (ret < 0) {
     goto error_out;
   }
@@ -741,6 +1039,7 @@ int RGWBucketReshard::execute(int num_shards, int max_op_entries,
   ret = do_reshard(num_shards,
 		   new_bucket_info,
 		   max_op_entries,
+		   online ? &log_markers : nullptr,
                    verbose, out, formatter, dpp);
   if (ret < 0) {
     goto error_out;
@@ -780,6 +1079,10 @@ int RGWBucketReshard::execute(int num_shards, int max_op_entries,
 
 error_out:
 
+  if (online) {
+    trim_unsynced_bilog(dpp);
+  }
+
   reshard_lock.unlock();
 
   // since the real problem is the issue that led to this error code
@@ -87,9 +87,19 @@ private:
   int create_new_bucket_instance(int new_num_shards,
 				 RGWBucketInfo& new_bucket_info,
                                  const DoutPrefixProvider *dpp);
+  int renew_locks(const DoutPrefixProvider *dpp);
+  int copy_object_entries(int source_shard, const std::string& name,
+			  const RGWBucketInfo& new_bucket_info,
+			  const DoutPrefixProvider *dpp);
+  int replay_logs(const RGWBucketInfo& new_bucket_info,
+		  std::map<int, std::string>& log_markers,
+		  int max_entries, uint64_t *num_replayed,
+		  const DoutPrefixProvider *dpp);
+  void trim_unsynced_bilog(const DoutPrefixProvider *dpp);
   int do_reshard(int num_shards,
 		 RGWBucketInfo& new_bucket_info,
 		 int max_entries,
+		 std::map<int, std::string>* log_markers,
                  bool verbose,
                  ostream *os,
 		 Formatter *formatter,
@@ -188,6 +198,35 @@ public:
 
     return final_num_shards;
   }
+
+  // replays one source shard's bilog after marker in pages of at most
+  // max_entries, setting marker to the last entry of each page so that
+  // the next call picks up where this one stopped; list_page(marker,
+  // max_entries, entries, &truncated) lists the entries after marker and
+  // replay(entries) applies one page
+  template <typename ListPage, typename Replay>
+  static int replay_log_shard(std::string& marker, int max_entries,
+			      uint64_t *num_replayed,
+			      ListPage&& list_page, Replay&& replay) {
+    bool is_truncated = true;
+    while (is_truncated) {
+      std::list<rgw_bi_log_entry> entries;
+      int ret = list_page(marker, max_entries, entries, &is_truncated);
+      if (ret < 0) {
+	return ret;
+      }
+      if (entries.empty()) {
+	break;
+      }
+      ret = replay(entries);
+      if (ret < 0) {
+	return ret;
+      }
+      *num_replayed += entries.size();
+      marker = entries.back().id;
+    }
+    return 0;
+  }
 }; // RGWBucketReshard
 
 
@@ -740,6 +740,11 @@ class Object {
 			      bool* pmore, optional_yield y) = 0;
     virtual int omap_get_all(const DoutPrefixProvider *dpp, std::map<std::string, bufferlist>* m,
 			     optional_yield y) = 0;
+    /* start an omap_get_vals() without waiting for it; the results are valid
+     * once aio has been drained */
+    virtual int omap_get_vals_aio(const DoutPrefixProvider *dpp, const std::string& marker, uint64_t count,
+				  std::map<std::string, bufferlist>* m,
+				  bool* pmore, Completions* aio) = 0;
     virtual int omap_get_vals_by_keys(const DoutPrefixProvider *dpp, const std::string& oid,
 			      const std::set<std::string>& keys,
 			      Attrs* vals) = 0;
@@ -857,6 +862,8 @@ protected:
     virtual ~GCChain() = default;
 
     virtual void update(const DoutPrefixProvider *dpp, RGWObjManifest* manifest) = 0;
+    /** Add a single raw object, such as a head object, to the chain */
+    virtual void add_raw_obj(const rgw_raw_obj& raw_obj) = 0;
     virtual int send(const std::string& tag) = 0;
     virtual void delete_inline(const DoutPrefixProvider *dpp, const std::string& tag) = 0;
 };
@@ -1395,6 +1395,36 @@ int RadosObject::omap_get_all(const DoutPrefixProvider *dpp, std::map<std::strin
   return sysobj.omap().get_all(dpp, m, y);
 }
 
+int RadosObject::omap_get_vals_aio(const DoutPrefixProvider *dpp, const std::string& marker, uint64_t count,
+				   std::map<std::string, bufferlist> *m,
+				   bool* pmore, Completions* aio)
+{
+  RadosCompletions* raio = static_cast<RadosCompletions*>(aio);
+  rgw_raw_obj raw_obj;
+  get_raw_obj(&raw_obj);
+
+  rgw_rados_ref ref;
+  int ret = store->getRados()->get_raw_obj_ref(dpp, raw_obj, &ref);
+  if (ret < 0) {
+    ldpp_dout(dpp, -1) << "ERROR: failed to get obj ref with ret=" << ret << dendl;
+    return ret;
+  }
+
+  librados::ObjectReadOperation op;
+  op.omap_get_vals2(marker, count, m, pmore, nullptr);
+
+  librados::AioCompletion *c = librados::Rados::aio_create_completion(nullptr, nullptr);
+  ret = ref.pool.ioctx().aio_operate(ref.obj.oid, c, &op, nullptr);
+  if (ret < 0) {
+    ldpp_dout(dpp, -1) << "ERROR: AioOperate failed with ret=" << ret << dendl;
+    c->release();
+    return ret;
+  }
+
+  raio->handles.push_back(c);
+  return 0;
+}
+
 int RadosObject::omap_get_vals_by_keys(const DoutPrefixProvider *dpp, const std::string& oid,
 					  const std::set<std::string>& keys,
 					  Attrs* vals)
@@ -1926,6 +1956,12 @@ void RadosGCChain::update(const DoutPrefixProvider *dpp, RGWObjManifest* manifes
   store->getRados()->update_gc_chain(dpp, target, *manifest, &chain);
 }
 
+void RadosGCChain::add_raw_obj(const rgw_raw_obj& raw_obj)
+{
+  cls_rgw_obj_key key(raw_obj.oid);
+  chain.push_obj(raw_obj.pool.to_str(), key, raw_obj.loc);
+}
+
 int RadosGCChain::send(const std::string& tag)
 {
   return store->getRados()->send_chain_to_gc(chain, tag);
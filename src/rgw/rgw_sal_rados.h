@@ -223,6 +223,9 @@ class RadosObject : public Object {
 			      bool* pmore, optional_yield y) override;
     virtual int omap_get_all(const DoutPrefixProvider *dpp, std::map<std::string, bufferlist> *m,
 			     optional_yield y) override;
+    virtual int omap_get_vals_aio(const DoutPrefixProvider *dpp, const std::string& marker, uint64_t count,
+				  std::map<std::string, bufferlist> *m,
+				  bool* pmore, Completions* aio) override;
     virtual int omap_get_vals_by_keys(const DoutPrefixProvider *dpp, const std::string& oid,
 			      const std::set<std::string>& keys,
 			      Attrs* vals) override;
@@ -555,6 +558,7 @@ protected:
     ~RadosGCChain() = default;
 
     virtual void update(const DoutPrefixProvider *dpp, RGWObjManifest* manifest) override;
+    virtual void add_raw_obj(const rgw_raw_obj& raw_obj) override;
     virtual int send(const std::string& tag) override;
     virtual void delete_inline(const DoutPrefixProvider *dpp, const std::string& tag) override;
 };
@@ -517,7 +517,9 @@ class RGWSI_SysObj_Cache_ASocketHook : public AdminSocketHook {
     { "cache erase name=target,type=CephString,req=true",
       "cache erase target: erase element from cache" },
     { "cache zap",
-      "cache zap: erase all elements from cache" }
+      "cache zap: erase all elements from cache" },
+    { "cache stats",
+      "cache stats: print entries and misses of each cache shard" }
   };
 
 public:
@@ -586,6 +588,11 @@ int RGWSI_SysObj_Cache_ASocketHook::call(
   } else if (command == "cache zap"sv) {
     svc->asocket.call_zap();
     return 0;
+  } else if (command == "cache stats"sv) {
+    f->open_object_section("cache_stats");
+    svc->asocket.call_stats(f);
+    f->close_section();
+    return 0;
   }
   return -ENOSYS;
 }
@@ -643,3 +650,8 @@ int RGWSI_SysObj_Cache::ASocketHandler::call_zap()
   svc->cache.invalidate_all();
   return 0;
 }
+
+void RGWSI_SysObj_Cache::ASocketHandler::call_stats(Formatter* f)
+{
+  svc->cache.dump_stats(f);
+}
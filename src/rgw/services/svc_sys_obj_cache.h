@@ -141,6 +141,10 @@ public:
 
     // `call_zap` must erase the cache.
     int call_zap();
+
+    // `call_stats` must dump the statistics of each cache shard to the
+    // supplied Formatter.
+    void call_stats(Formatter* f);
   } asocket;
 };
 
@@ -1140,3 +1140,255 @@ TEST_F(cls_rgw, bi_log_trim)
     EXPECT_FALSE(truncated);
   }
 }
+
+TEST_F(cls_rgw, reshard_logrecord)
+{
+  string bucket_oid = str_int("bucket", 9);
+
+  ObjectWriteOperation op;
+  cls_rgw_bucket_init_index(op);
+  ASSERT_EQ(0, ioctx.operate(bucket_oid, &op));
+
+  cls_rgw_bucket_instance_entry entry;
+  entry.set_status("new-instance", 7, cls_rgw_reshard_status::IN_LOGRECORD);
+  ASSERT_EQ(0, cls_rgw_set_bucket_resharding(ioctx, bucket_oid, entry));
+
+  // writes are not blocked while the new index is built
+  {
+    ObjectWriteOperation op;
+    cls_rgw_guard_bucket_resharding(op, -EBUSY);
+    op.create(false);
+    ASSERT_EQ(0, ioctx.operate(bucket_oid, &op));
+  }
+
+  // and are logged even if the caller didn't ask for it
+  {
+    cls_rgw_obj_key obj{"obj"};
+    string tag = "tag";
+    string loc = "loc";
+    index_prepare(ioctx, bucket_oid, CLS_RGW_OP_ADD, tag, obj, loc, 0, false);
+    rgw_bucket_dir_entry_meta meta;
+    index_complete(ioctx, bucket_oid, CLS_RGW_OP_ADD, tag, 1, obj, meta, 0, false);
+
+    cls_rgw_bi_log_list_ret bilog;
+    ASSERT_EQ(0, bilog_list(ioctx, bucket_oid, &bilog));
+    ASSERT_EQ(1u, bilog.entries.size());
+    EXPECT_EQ("obj", bilog.entries.front().object);
+  }
+
+  // once the cut-over starts, writers are blocked again
+  entry.set_status("new-instance", 7, cls_rgw_reshard_status::IN_PROGRESS);
+  ASSERT_EQ(0, cls_rgw_set_bucket_resharding(ioctx, bucket_oid, entry));
+  {
+    ObjectWriteOperation op;
+    cls_rgw_guard_bucket_resharding(op, -EBUSY);
+    op.create(false);
+    ASSERT_EQ(-EBUSY, ioctx.operate(bucket_oid, &op));
+  }
+}
+
+// ops without a log_op flag must log as well while resharding online
+TEST_F(cls_rgw, reshard_logrecord_unlogged_ops)
+{
+  string bucket_oid = str_int("bucket", 10);
+
+  ObjectWriteOperation op;
+  cls_rgw_bucket_init_index(op);
+  ASSERT_EQ(0, ioctx.operate(bucket_oid, &op));
+
+  // a versioned object, so there is an olh to trim and clear
+  const cls_rgw_obj_key olh_key{"obj"};
+  const cls_rgw_obj_key instance_key{"obj", "v1"};
+  string tag = "tag";
+  string loc = "loc";
+  index_prepare(ioctx, bucket_oid, CLS_RGW_OP_ADD, tag, instance_key, loc, 0, false);
+  rgw_bucket_dir_entry_meta meta;
+  index_complete(ioctx, bucket_oid, CLS_RGW_OP_ADD, tag, 1, instance_key, meta, 0, false);
+
+  cls_rgw_bi_log_list_ret bilog;
+  ASSERT_EQ(0, bilog_list(ioctx, bucket_oid, &bilog));
+  const size_t logged = bilog.entries.size();
+
+  cls_rgw_bucket_instance_entry entry;
+  entry.set_status("new-instance", 7, cls_rgw_reshard_status::IN_LOGRECORD);
+  ASSERT_EQ(0, cls_rgw_set_bucket_resharding(ioctx, bucket_oid, entry));
+
+  auto expect_logged = [&] (size_t count, const string& name) {
+    cls_rgw_bi_log_list_ret bilog;
+    ASSERT_EQ(0, bilog_list(ioctx, bucket_oid, &bilog));
+    ASSERT_EQ(count, bilog.entries.size());
+    EXPECT_EQ(name, bilog.entries.back().object);
+    // bucket sync skips these
+    EXPECT_EQ(CLS_RGW_OP_CANCEL, bilog.entries.back().op);
+  };
+
+  {
+    ObjectWriteOperation op;
+    cls_rgw_trim_olh_log(op, olh_key, std::numeric_limits<uint64_t>::max(), tag);
+    ASSERT_EQ(0, ioctx.operate(bucket_oid, &op));
+    expect_logged(logged + 1, "obj");
+  }
+  {
+    ASSERT_EQ(0, cls_rgw_clear_olh(ioctx, bucket_oid, olh_key, tag));
+    expect_logged(logged + 2, "obj");
+  }
+  rgw_cls_bi_entry bi_entry;
+  {
+    rgw_bucket_dir_entry dir_entry;
+    dir_entry.key = cls_rgw_obj_key{"put"};
+    dir_entry.exists = true;
+    bi_entry.type = BIIndexType::Plain;
+    bi_entry.idx = "put";
+    encode(dir_entry, bi_entry.data);
+    ASSERT_EQ(0, cls_rgw_bi_put(ioctx, bucket_oid, bi_entry));
+    expect_logged(logged + 3, "put");
+  }
+
+  // and not once resharding is over
+  entry.set_status("", 0, cls_rgw_reshard_status::NOT_RESHARDING);
+  ASSERT_EQ(0, cls_rgw_set_bucket_resharding(ioctx, bucket_oid, entry));
+  ASSERT_EQ(0, cls_rgw_bi_put(ioctx, bucket_oid, bi_entry));
+  ASSERT_EQ(0, bilog_list(ioctx, bucket_oid, &bilog));
+  EXPECT_EQ(logged + 3, bilog.entries.size());
+}
+
+TEST_F(cls_rgw, index_complete_ops)
+{
+  string bucket_oid = str_int("bucket", 8);
+
+  ObjectWriteOperation op;
+  cls_rgw_bucket_init_index(op);
+  ASSERT_EQ(0, ioctx.operate(bucket_oid, &op));
+
+  uint64_t obj_size = 1024;
+
+  std::vector<rgw_cls_obj_complete_op> ops;
+  for (int i = 0; i < NUM_OBJS; i++) {
+    cls_rgw_obj_key obj = str_int("obj", i);
+    string tag = str_int("tag", i);
+    string loc = str_int("loc", i);
+
+    index_prepare(ioctx, bucket_oid, CLS_RGW_OP_ADD, tag, obj, loc);
+
+    auto& c = ops.emplace_back();
+    c.op = CLS_RGW_OP_ADD;
+    c.key = obj;
+    c.tag = tag;
+    c.ver.pool = ioctx.get_id();
+    c.ver.epoch = 1;
+    c.meta.category = RGWObjCategory::None;
+    c.meta.size = obj_size;
+    c.meta.accounted_size = obj_size;
+    c.log_op = true;
+  }
+  // an op without a matching prepare doesn't fail the rest of the batch
+  {
+    auto& c = ops.emplace_back();
+    c.op = CLS_RGW_OP_CANCEL;
+    c.key = cls_rgw_obj_key{"unprepared"};
+    c.tag = "unknown-tag";
+  }
+
+  ObjectWriteOperation wop;
+  cls_rgw_bucket_complete_ops(wop, ops);
+  ASSERT_EQ(0, ioctx.operate(bucket_oid, &wop));
+
+  test_stats(ioctx, bucket_oid, RGWObjCategory::None, NUM_OBJS,
+             obj_size * NUM_OBJS);
+
+  // each op is logged under its own index version
+  cls_rgw_bi_log_list_ret bilog;
+  ASSERT_EQ(0, bilog_list(ioctx, bucket_oid, &bilog));
+  ASSERT_EQ(2u * NUM_OBJS, bilog.entries.size());
+  std::set<string> ids;
+  for (auto& e : bilog.entries) {
+    ids.insert(e.id);
+  }
+  EXPECT_EQ(bilog.entries.size(), ids.size());
+
+  auto make_add = [&] (const cls_rgw_obj_key& key, const string& tag,
+                       uint64_t epoch, uint64_t size) {
+    rgw_cls_obj_complete_op c;
+    c.op = CLS_RGW_OP_ADD;
+    c.key = key;
+    c.tag = tag;
+    c.ver.pool = ioctx.get_id();
+    c.ver.epoch = epoch;
+    c.meta.category = RGWObjCategory::None;
+    c.meta.size = size;
+    c.meta.accounted_size = size;
+    c.log_op = true;
+    return c;
+  };
+  auto read_entry = [&] (cls_rgw_obj_key key, rgw_bucket_dir_entry *entry) {
+    rgw_cls_bi_entry bi;
+    ASSERT_EQ(0, cls_rgw_bi_get(ioctx, bucket_oid, BIIndexType::Plain,
+                                key, &bi));
+    auto p = bi.data.cbegin();
+    decode(*entry, p);
+  };
+
+  // two ops on the same object can't share a batch: the second would
+  // read the entry as it was before the first. the batch is rejected
+  // without applying either
+  cls_rgw_obj_key dup{"dup"};
+  string tag1 = "dup-tag1", tag2 = "dup-tag2", dup_loc = "dup-loc";
+  index_prepare(ioctx, bucket_oid, CLS_RGW_OP_ADD, tag1, dup, dup_loc);
+  index_prepare(ioctx, bucket_oid, CLS_RGW_OP_ADD, tag2, dup, dup_loc);
+  {
+    std::vector<rgw_cls_obj_complete_op> same_key = {
+      make_add(dup, tag1, 2, 10),
+      make_add(dup, tag2, 3, 20),
+    };
+    ObjectWriteOperation wop;
+    cls_rgw_bucket_complete_ops(wop, same_key);
+    ASSERT_EQ(-EINVAL, ioctx.operate(bucket_oid, &wop));
+  }
+  test_stats(ioctx, bucket_oid, RGWObjCategory::None, NUM_OBJS,
+             obj_size * NUM_OBJS);
+  {
+    rgw_bucket_dir_entry entry;
+    read_entry(dup, &entry);
+    EXPECT_EQ(2u, entry.pending_map.size());
+  }
+
+  // sent in separate batches they apply in order, counting the object once
+  for (auto c : {make_add(dup, tag1, 2, 10), make_add(dup, tag2, 3, 20)}) {
+    ObjectWriteOperation wop;
+    cls_rgw_bucket_complete_ops(wop, {c});
+    ASSERT_EQ(0, ioctx.operate(bucket_oid, &wop));
+  }
+  test_stats(ioctx, bucket_oid, RGWObjCategory::None, NUM_OBJS + 1,
+             obj_size * NUM_OBJS + 20);
+  {
+    rgw_bucket_dir_entry entry;
+    read_entry(dup, &entry);
+    EXPECT_TRUE(entry.pending_map.empty());
+    EXPECT_EQ(20u, entry.meta.size);
+  }
+
+  // nor can an op share a batch with another op that removes its object
+  cls_rgw_obj_key head{"head"};
+  string head_tag = "head-tag", head_loc = "head-loc";
+  string part_tag = "part-tag";
+  index_prepare(ioctx, bucket_oid, CLS_RGW_OP_ADD, head_tag, head, head_loc);
+  index_prepare(ioctx, bucket_oid, CLS_RGW_OP_ADD, part_tag, dup, dup_loc);
+  {
+    auto head_op = make_add(head, head_tag, 1, 30);
+    head_op.remove_objs.push_back(dup);
+    std::vector<rgw_cls_obj_complete_op> overlap = {
+      make_add(dup, part_tag, 4, 40),
+      head_op,
+    };
+    ObjectWriteOperation wop;
+    cls_rgw_bucket_complete_ops(wop, overlap);
+    ASSERT_EQ(-EINVAL, ioctx.operate(bucket_oid, &wop));
+  }
+  test_stats(ioctx, bucket_oid, RGWObjCategory::None, NUM_OBJS + 1,
+             obj_size * NUM_OBJS + 20);
+  {
+    rgw_bucket_dir_entry entry;
+    read_entry(dup, &entry);
+    EXPECT_EQ(1u, entry.pending_map.size());
+  }
+}
@@ -0,0 +1,143 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Benchmark whole-pool CRUSH placement: map every PG of a pool through a
+ * replicated rule on a datacenter sized straw2 map, and time the item hash
+ * on its own.
+ *
+ * LGPL-2.1 (see COPYING-LGPL2.1) or later
+ */
+
+#include <iostream>
+#include <memory>
+
+#include "common/ceph_argparse.h"
+#include "common/ceph_time.h"
+#include "common/common_init.h"
+#include "include/stringify.h"
+
+#include "crush/CrushWrapper.h"
+#include "crush/hash.h"
+#include "osd/osd_types.h"
+
+using namespace std;
+
+static unique_ptr<CrushWrapper> build_map(CephContext *cct, int num_rack,
+					  int num_host, int num_osd)
+{
+  unique_ptr<CrushWrapper> c(new CrushWrapper);
+  c->create();
+  c->set_tunables_default();
+  c->set_type_name(3, "root");
+  c->set_type_name(2, "rack");
+  c->set_type_name(1, "host");
+  c->set_type_name(0, "osd");
+
+  int rootno;
+  c->add_bucket(0, CRUSH_BUCKET_STRAW2, CRUSH_HASH_RJENKINS1,
+		3, 0, NULL, NULL, &rootno);
+  c->set_item_name(rootno, "default");
+
+  map<string,string> loc;
+  loc["root"] = "default";
+  int osd = 0;
+  for (int r = 0; r < num_rack; ++r) {
+    loc["rack"] = string("rack-") + stringify(r);
+    for (int h = 0; h < num_host; ++h) {
+      loc["host"] = string("host-") + stringify(r) + "-" + stringify(h);
+      for (int o = 0; o < num_osd; ++o, ++osd) {
+	// mix of drive sizes, as in a cluster that has been expanded
+	float weight = (osd % 3 == 0) ? 3.6 : 7.2;
+	c->insert_item(cct, osd, weight, string("osd.") + stringify(osd), loc);
+      }
+    }
+  }
+  c->add_simple_rule("replicated_rack", "default", "rack", "", "firstn",
+		     pg_pool_t::TYPE_REPLICATED);
+  c->finalize();
+  return c;
+}
+
+static void usage(const char *name)
+{
+  cout << name << " [<pgs> [<racks> <hosts per rack> <osds per host>]]\n"
+       << "\t pgs: the number of PGs to map (default 131072)\n"
+       << "\t racks, hosts, osds: shape of the crush map (default 10 30 10)\n";
+}
+
+int main(int argc, const char **argv)
+{
+  int num_pg = 131072;
+  int num_rack = 10, num_host = 30, num_osd = 10;
+  if (argc > 1) {
+    if (string(argv[1]) == "-h" || string(argv[1]) == "--help") {
+      usage(argv[0]);
+      return EXIT_SUCCESS;
+    }
+    num_pg = atoi(argv[1]);
+  }
+  if (argc > 4) {
+    num_rack = atoi(argv[2]);
+    num_host = atoi(argv[3]);
+    num_osd = atoi(argv[4]);
+  }
+
+  CephInitParameters params(CEPH_ENTITY_TYPE_CLIENT);
+  CephContext *cct = common_preinit(params, CODE_ENVIRONMENT_UTILITY,
+				    CINIT_FLAG_NO_DEFAULT_CONFIG_FILE);
+  auto c = build_map(cct, num_rack, num_host, num_osd);
+  int rule = c->get_rule_id("replicated_rack");
+  int num_osds = num_rack * num_host * num_osd;
+  vector<__u32> weight(num_osds, 0x10000);
+
+  cout << num_pg << " pgs on " << num_osds << " osds ("
+       << num_rack << " racks x " << num_host << " hosts x "
+       << num_osd << " osds)" << std::endl;
+
+  pg_pool_t pool;
+  pool.set_flag(pg_pool_t::FLAG_HASHPSPOOL);
+  pool.set_pg_num(num_pg);
+  pool.set_pgp_num(num_pg);
+  vector<int> xs(num_pg);
+  for (int ps = 0; ps < num_pg; ++ps) {
+    xs[ps] = pool.raw_pg_to_pps(pg_t(ps, 1));
+  }
+
+  auto start = ceph::mono_clock::now();
+  vector<vector<int>> scalar(num_pg);
+  for (int ps = 0; ps < num_pg; ++ps) {
+    c->do_rule(rule, xs[ps], scalar[ps], 3, weight, CrushWrapper::DEFAULT_CHOOSE_ARGS);
+  }
+  auto scalar_dur = ceph::mono_clock::now() - start;
+  cout << "do_rule per pg:\t" << ceph::to_seconds<double>(scalar_dur) << " s"
+       << std::endl;
+
+  // the straw2 draw is dominated by the item hash; time it alone
+  const unsigned n = 1024;
+  const int rounds = 10000;
+  vector<__u32> items(n), out(n);
+  for (unsigned i = 0; i < n; ++i) {
+    items[i] = i;
+  }
+  __u32 sum = 0;
+  start = ceph::mono_clock::now();
+  for (int r = 0; r < rounds; ++r) {
+    for (unsigned i = 0; i < n; ++i) {
+      sum += crush_hash32_3(CRUSH_HASH_RJENKINS1, r, items[i], 0);
+    }
+  }
+  auto hash_dur = ceph::mono_clock::now() - start;
+  start = ceph::mono_clock::now();
+  for (int r = 0; r < rounds; ++r) {
+    crush_hash32_3_vec(CRUSH_HASH_RJENKINS1, r, items.data(), 0,
+		       out.data(), n);
+    sum -= out[r % n];
+  }
+  auto hash_vec_dur = ceph::mono_clock::now() - start;
+  cout << "crush_hash32_3:\t" << ceph::to_seconds<double>(hash_dur) << " s\n"
+       << "crush_hash32_3_vec:\t" << ceph::to_seconds<double>(hash_vec_dur)
+       << " s (" << sum << ")" << std::endl;
+
+  cct->put();
+  return EXIT_SUCCESS;
+}
@@ -18,6 +18,7 @@
 #include "include/stringify.h"
 
 #include "crush/CrushWrapper.h"
+#include "crush/hash.h"
 #include "osd/osd_types.h"
 
 std::unique_ptr<CrushWrapper> build_indep_map(CephContext *cct, int num_rack,
@@ -263,6 +264,21 @@ TEST_F(CRUSHTest, indep_out_progressive) {
 
 }
 
+TEST_F(CRUSHTest, hash32_3_vec) {
+  // the SIMD path must match the scalar hash, including the tail
+  for (unsigned n : {0u, 1u, 7u, 8u, 9u, 64u, 1003u}) {
+    vector<__u32> b(n), out(n);
+    for (unsigned i = 0; i < n; ++i) {
+      b[i] = i * 7919u - 5u;
+    }
+    crush_hash32_3_vec(CRUSH_HASH_RJENKINS1, 12345, b.data(), 678,
+		       out.data(), n);
+    for (unsigned i = 0; i < n; ++i) {
+      ASSERT_EQ(crush_hash32_3(CRUSH_HASH_RJENKINS1, 12345, b[i], 678), out[i]);
+    }
+  }
+}
+
 TEST_F(CRUSHTest, straw_zero) {
   // zero weight items should have no effect on placement.
 
@@ -0,0 +1,351 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include "global/global_context.h"
+#include "messages/MMgrConfigure.h"
+#include "messages/MMgrReport.h"
+#include "mgr/DaemonState.h"
+#include "mgr/MgrClient.h"
+#include "mgr/MgrSession.h"
+
+#include "gtest/gtest.h"
+
+using ceph::bufferlist;
+using ceph::decode;
+using ceph::encode;
+
+static PerfCounterDeltas roundtrip(const PerfCounterDeltas& in)
+{
+  bufferlist bl;
+  encode(in, bl);
+  PerfCounterDeltas out;
+  auto p = bl.cbegin();
+  decode(out, p);
+  EXPECT_TRUE(p.end());
+  return out;
+}
+
+TEST(MgrReport, PerfCounterDeltasEmpty)
+{
+  EXPECT_TRUE(roundtrip({}).empty());
+}
+
+TEST(MgrReport, PerfCounterDeltasRoundtrip)
+{
+  PerfCounterDeltas in;
+  {
+    PerfCounterDelta d;
+    d.idx = 0;
+    d.val = 1;
+    in.push_back(d);
+  }
+  {
+    // gauge going down: applied modulo 2^64
+    PerfCounterDelta d;
+    d.idx = 3;
+    d.val = uint64_t(0) - 17;
+    in.push_back(d);
+  }
+  {
+    PerfCounterDelta d;
+    d.idx = 4;
+    d.avg = true;
+    d.val = 123456789;
+    d.avgcount = 3;
+    d.avgcount2 = 2;
+    in.push_back(d);
+  }
+  {
+    PerfCounterDelta d;
+    d.idx = 100000;
+    d.val = (1ull << 62) + 5;
+    in.push_back(d);
+  }
+
+  auto out = roundtrip(in);
+  ASSERT_EQ(in.size(), out.size());
+  for (size_t i = 0; i < in.size(); ++i) {
+    EXPECT_EQ(in[i].idx, out[i].idx);
+    EXPECT_EQ(in[i].avg, out[i].avg);
+    EXPECT_EQ(in[i].val, out[i].val);
+    EXPECT_EQ(in[i].avgcount, out[i].avgcount);
+    EXPECT_EQ(in[i].avgcount2, out[i].avgcount2);
+  }
+  EXPECT_EQ(983u, uint64_t(1000) + out[1].val);
+}
+
+TEST(MgrReport, PerfCounterDeltasExtremes)
+{
+  // every 64-bit difference, including ones whose magnitude needs the
+  // top bits, survives the trip and stays within the bound
+  const uint64_t vals[] = {
+    0, 1, uint64_t(0) - 1,
+    (1ull << 62) - 1, 1ull << 62, (1ull << 62) + 5,
+    uint64_t(0) - (1ull << 62), uint64_t(0) - (1ull << 62) - 5,
+    (1ull << 63) - 1, 1ull << 63, (1ull << 63) + 1,
+    ~0ull,
+  };
+  PerfCounterDeltas in;
+  uint32_t idx = 0;
+  for (auto v : vals) {
+    PerfCounterDelta d;
+    d.idx = idx++;
+    d.avg = true;
+    d.val = v;
+    d.avgcount = ~v;
+    d.avgcount2 = v ^ (1ull << 63);
+    in.push_back(d);
+  }
+
+  size_t bound = 0;
+  denc_traits<PerfCounterDeltas>::bound_encode(in, bound);
+  bufferlist bl;
+  encode(in, bl);
+  EXPECT_GE(bound, bl.length());
+
+  auto out = roundtrip(in);
+  ASSERT_EQ(in.size(), out.size());
+  for (size_t i = 0; i < in.size(); ++i) {
+    EXPECT_EQ(in[i].val, out[i].val);
+    EXPECT_EQ(in[i].avgcount, out[i].avgcount);
+    EXPECT_EQ(in[i].avgcount2, out[i].avgcount2);
+  }
+}
+
+TEST(MgrReport, PerfCounterDeltasCompact)
+{
+  // small changes to large, sparse counters stay small on the wire
+  PerfCounterDeltas in;
+  for (uint32_t i = 0; i < 100; ++i) {
+    PerfCounterDelta d;
+    d.idx = i * 10;
+    d.val = 1;
+    in.push_back(d);
+  }
+  bufferlist bl;
+  encode(in, bl);
+  EXPECT_GE(100u * 2 + 1, bl.length());
+}
+
+TEST(MgrReport, PerfCounterDeltasCompactNegative)
+{
+  // a gauge dropping by one costs as little as one rising by one
+  PerfCounterDeltas in;
+  for (uint32_t i = 0; i < 100; ++i) {
+    PerfCounterDelta d;
+    d.idx = i * 10;
+    d.val = uint64_t(0) - 1;
+    in.push_back(d);
+  }
+  bufferlist bl;
+  encode(in, bl);
+  EXPECT_GE(100u * 2 + 1, bl.length());
+}
+
+// A daemon reporting a plain counter "a" and a long running average "b",
+// and the mgr's view of it
+class PerfCounterReportTest : public ::testing::Test {
+protected:
+  MgrSessionState client;
+  PerfCounterTypes types;
+  DaemonPerfCounters counters{types};
+  MgrSessionRef session = ceph::make_ref<MgrSession>(g_ceph_context);
+  const std::vector<bool> avg = {false, true};
+
+  ceph::ref_t<MMgrReport> pack(uint64_t a, uint64_t b_sum, uint64_t b_count,
+			       uint32_t full_sync_period = 10) {
+    auto report = ceph::make_message<MMgrReport>();
+    if (client.declared.empty()) {
+      PerfCounterType a_type;
+      a_type.path = "a";
+      a_type.type = PERFCOUNTER_U64;
+      PerfCounterType b_type;
+      b_type.path = "b";
+      b_type.type = perfcounter_type_d(PERFCOUNTER_U64 |
+				       PERFCOUNTER_LONGRUNAVG);
+      for (auto& t : {a_type, b_type}) {
+	report->declare_types.push_back(t);
+	client.declared.insert(t.path);
+      }
+    }
+    std::vector<PerfCounterValue> values(2);
+    values[0].val = a;
+    values[1].val = b_sum;
+    values[1].avgcount = b_count;
+    values[1].avgcount2 = b_count;
+    client.pack_values(report.get(), std::move(values), avg,
+		       full_sync_period);
+    return report;
+  }
+
+  bool update(const ceph::ref_t<MMgrReport>& report) {
+    return counters.update(*report, session.get());
+  }
+
+  uint64_t latest_a() {
+    return counters.instances.at("a").get_latest_data().v;
+  }
+  size_t num_points_a() {
+    return counters.instances.at("a").get_data().size();
+  }
+  std::pair<uint64_t,uint64_t> latest_b() {
+    auto& p = counters.instances.at("b").get_data_avg().back();
+    return {p.s, p.c};
+  }
+};
+
+TEST_F(PerfCounterReportTest, FullThenDeltas)
+{
+  auto r = pack(10, 100, 4);
+  EXPECT_FALSE(r->packed_delta);
+  ASSERT_TRUE(update(r));
+  EXPECT_EQ(10u, latest_a());
+  EXPECT_EQ(std::make_pair(uint64_t(100), uint64_t(4)), latest_b());
+
+  // only b changed
+  r = pack(10, 150, 5);
+  EXPECT_TRUE(r->packed_delta);
+  EXPECT_EQ(1u, r->delta_base_seq);
+  ASSERT_TRUE(update(r));
+  EXPECT_EQ(10u, latest_a());
+  EXPECT_EQ(std::make_pair(uint64_t(150), uint64_t(5)), latest_b());
+  // a still gets a data point for this report
+  EXPECT_EQ(2u, num_points_a());
+
+  // a gauge going down
+  r = pack(3, 150, 5);
+  EXPECT_TRUE(r->packed_delta);
+  ASSERT_TRUE(update(r));
+  EXPECT_EQ(3u, latest_a());
+  EXPECT_EQ(3u, num_points_a());
+  EXPECT_EQ(3u, session->reported_seq);
+}
+
+TEST_F(PerfCounterReportTest, FullSyncPeriod)
+{
+  std::vector<bool> deltas;
+  for (int i = 0; i < 7; ++i) {
+    auto r = pack(i, i * 10, i, 3);
+    deltas.push_back(r->packed_delta);
+    ASSERT_TRUE(update(r));
+    EXPECT_EQ(uint64_t(i), latest_a());
+  }
+  EXPECT_EQ((std::vector<bool>{false, true, true, false, true, true, false}),
+	    deltas);
+}
+
+TEST_F(PerfCounterReportTest, DeclareForcesFull)
+{
+  ASSERT_TRUE(update(pack(1, 1, 1)));
+  ASSERT_TRUE(update(pack(2, 2, 2)));
+
+  // the declared set changing moves the indexes deltas refer to
+  client.declared.clear();
+  auto r = pack(3, 3, 3);
+  EXPECT_FALSE(r->packed_delta);
+  ASSERT_TRUE(update(r));
+  EXPECT_EQ(3u, latest_a());
+}
+
+TEST_F(PerfCounterReportTest, MissingBaseline)
+{
+  ASSERT_TRUE(update(pack(1, 10, 1)));
+
+  // the mgr never applies report 2, so report 3 is against a baseline it
+  // doesn't have
+  auto lost = pack(2, 20, 2);
+  ASSERT_TRUE(lost->packed_delta);
+  auto r = pack(3, 30, 3);
+  ASSERT_TRUE(r->packed_delta);
+  EXPECT_EQ(2u, r->delta_base_seq);
+  EXPECT_FALSE(update(r));
+  EXPECT_EQ(1u, latest_a());
+  EXPECT_EQ(0u, session->reported_seq);
+  EXPECT_TRUE(session->reported_values.empty());
+
+  // and every delta after it is dropped as well
+  r = pack(4, 40, 4);
+  EXPECT_FALSE(update(r));
+  EXPECT_EQ(1u, latest_a());
+
+  // until the daemon is asked for full values
+  client.need_full_report = true;
+  r = pack(5, 50, 5);
+  EXPECT_FALSE(r->packed_delta);
+  EXPECT_FALSE(client.need_full_report);
+  ASSERT_TRUE(update(r));
+  EXPECT_EQ(5u, latest_a());
+  EXPECT_EQ(std::make_pair(uint64_t(50), uint64_t(5)), latest_b());
+
+  r = pack(6, 60, 6);
+  EXPECT_TRUE(r->packed_delta);
+  ASSERT_TRUE(update(r));
+  EXPECT_EQ(6u, latest_a());
+}
+
+TEST_F(PerfCounterReportTest, BadIndex)
+{
+  ASSERT_TRUE(update(pack(1, 1, 1)));
+  auto r = ceph::make_message<MMgrReport>();
+  r->stats_seq = 2;
+  r->packed_delta = true;
+  r->delta_base_seq = 1;
+  PerfCounterDeltas deltas(1);
+  deltas[0].idx = 2;
+  deltas[0].val = 1;
+  ENCODE_START(1, 1, r->packed);
+  encode(deltas, r->packed);
+  ENCODE_FINISH(r->packed);
+  EXPECT_FALSE(update(r));
+  EXPECT_EQ(0u, session->reported_seq);
+}
+
+// the daemon side of a resync: the mgr's MMgrConfigure makes the next
+// report a full one
+class TestMgrClient : public MgrClient {
+public:
+  TestMgrClient() : MgrClient(g_ceph_context, nullptr, nullptr) {
+    session = std::make_unique<MgrSessionState>();
+  }
+
+  MgrSessionState& get_session() {
+    return *session;
+  }
+
+  void configure(bool resync) {
+    auto m = ceph::make_message<MMgrConfigure>();
+    m->stats_full_sync_period = 10;
+    m->stats_resync = resync;
+    std::lock_guard l(lock);
+    handle_mgr_configure(m);
+  }
+};
+
+TEST(MgrClient, ResyncOnMissingBaseline)
+{
+  TestMgrClient mgrc;
+  mgrc.configure(false);
+  auto& s = mgrc.get_session();
+  const std::vector<bool> avg = {false};
+  auto pack = [&](uint64_t v) {
+    auto report = ceph::make_message<MMgrReport>();
+    std::vector<PerfCounterValue> values(1);
+    values[0].val = v;
+    s.pack_values(report.get(), std::move(values), avg, 10);
+    return report;
+  };
+
+  EXPECT_FALSE(pack(1)->packed_delta);
+  EXPECT_TRUE(pack(2)->packed_delta);
+
+  mgrc.configure(true);
+  EXPECT_TRUE(s.need_full_report);
+  auto r = pack(3);
+  EXPECT_FALSE(r->packed_delta);
+  EXPECT_FALSE(s.need_full_report);
+  EXPECT_EQ(3u, r->stats_seq);
+
+  // back to deltas, and a plain configure doesn't change that
+  mgrc.configure(false);
+  EXPECT_TRUE(pack(4)->packed_delta);
+}
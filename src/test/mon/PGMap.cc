@@ -164,3 +164,140 @@ TEST(pgmap, dump_object_stat_sum_2)
   ASSERT_EQ(percentify(0), tbl.get(0, col++));
   ASSERT_EQ(stringify(byte_u_t(avail/pool.size)), tbl.get(0, col++));
 }
+
+TEST(pgmap, purged_snaps_incremental)
+{
+  PGMap pg_map;
+  auto make_stat = [](uint64_t state, snapid_t from, snapid_t len) {
+    pg_stat_t s;
+    s.state = state;
+    s.purged_snaps.insert(from, len);
+    return s;
+  };
+  auto apply = [&pg_map](PGMap::Incremental& inc) {
+    inc.version = pg_map.get_version() + 1;
+    pg_map.apply_incremental(nullptr, inc);
+    pg_map.calc_purged_snaps();
+    // must match a recomputation from scratch
+    PGMap full = pg_map;
+    full.calc_stats();
+    full.calc_purged_snaps();
+    ASSERT_EQ(full.purged_snaps, pg_map.purged_snaps);
+  };
+
+  {
+    PGMap::Incremental inc;
+    inc.pg_stat_updates[pg_t(0, 1)] = make_stat(PG_STATE_ACTIVE, 1, 10);
+    inc.pg_stat_updates[pg_t(1, 1)] = make_stat(PG_STATE_ACTIVE, 1, 20);
+    inc.pg_stat_updates[pg_t(0, 2)] = make_stat(PG_STATE_ACTIVE, 5, 5);
+    apply(inc);
+    ASSERT_EQ(2u, pg_map.purged_snaps.size());
+    ASSERT_EQ(10u, pg_map.purged_snaps[1].size());
+  }
+  {
+    // a pg trims further; the pool intersection must not grow past the
+    // other pg's purged range
+    PGMap::Incremental inc;
+    inc.pg_stat_updates[pg_t(0, 1)] = make_stat(PG_STATE_ACTIVE, 1, 30);
+    apply(inc);
+    ASSERT_EQ(20u, pg_map.purged_snaps[1].size());
+  }
+  {
+    // unknown pg hides the pool
+    PGMap::Incremental inc;
+    inc.pg_stat_updates[pg_t(0, 2)] = make_stat(0, 5, 5);
+    apply(inc);
+    ASSERT_EQ(0u, pg_map.purged_snaps.count(2));
+    ASSERT_EQ(1u, pg_map.purged_snaps.count(1));
+  }
+  {
+    // removing it leaves the pool without pgs
+    PGMap::Incremental inc;
+    inc.pg_remove.insert(pg_t(0, 2));
+    apply(inc);
+    ASSERT_EQ(0u, pg_map.purged_snaps.count(2));
+  }
+  {
+    // a stats-only update keeps the cached result
+    PGMap::Incremental inc;
+    auto s = make_stat(PG_STATE_ACTIVE, 1, 30);
+    s.stats.sum.num_objects = 10;
+    inc.pg_stat_updates[pg_t(0, 1)] = s;
+    apply(inc);
+    ASSERT_EQ(20u, pg_map.purged_snaps[1].size());
+  }
+  {
+    // fragmented sets intersect range by range; 25-34 is beyond the
+    // 1-20 of pg 1.1
+    PGMap::Incremental inc;
+    auto s = make_stat(PG_STATE_ACTIVE, 1, 5);
+    s.purged_snaps.insert(10, 5);
+    s.purged_snaps.insert(25, 10);
+    inc.pg_stat_updates[pg_t(2, 1)] = s;
+    apply(inc);
+    interval_set<snapid_t> expected;
+    expected.insert(1, 5);
+    expected.insert(10, 5);
+    ASSERT_EQ(expected, pg_map.purged_snaps[1]);
+  }
+  {
+    // dropping the pg that limited the intersection lets it grow again
+    PGMap::Incremental inc;
+    inc.pg_remove.insert(pg_t(2, 1));
+    inc.pg_remove.insert(pg_t(1, 1));
+    apply(inc);
+    ASSERT_EQ(30u, pg_map.purged_snaps[1].size());
+  }
+}
+
+TEST(pgmap, health_checks_incremental)
+{
+  PGMap pg_map;
+  OSDMap osdmap;
+  auto make_stat = [](uint64_t state) {
+    pg_stat_t s;
+    s.state = state;
+    s.last_change = ceph_clock_now();
+    return s;
+  };
+  auto apply = [&](PGMap::Incremental& inc) {
+    inc.version = pg_map.get_version() + 1;
+    pg_map.apply_incremental(nullptr, inc);
+    health_check_map_t checks;
+    pg_map.get_health_checks(g_ceph_context, osdmap, &checks);
+    // must match a map whose stats were rebuilt from scratch
+    PGMap full = pg_map;
+    full.calc_stats();
+    health_check_map_t full_checks;
+    full.get_health_checks(g_ceph_context, osdmap, &full_checks);
+    EXPECT_EQ(full_checks, checks);
+    return checks;
+  };
+
+  {
+    PGMap::Incremental inc;
+    inc.pg_stat_updates[pg_t(0, 1)] = make_stat(PG_STATE_ACTIVE | PG_STATE_CLEAN);
+    inc.pg_stat_updates[pg_t(1, 1)] = make_stat(PG_STATE_ACTIVE | PG_STATE_CLEAN);
+    inc.pg_stat_updates[pg_t(2, 1)] = make_stat(PG_STATE_ACTIVE | PG_STATE_CLEAN);
+    auto checks = apply(inc);
+    ASSERT_EQ(0u, checks.checks.count("PG_DEGRADED"));
+  }
+  {
+    PGMap::Incremental inc;
+    inc.pg_stat_updates[pg_t(1, 1)] = make_stat(PG_STATE_ACTIVE | PG_STATE_DEGRADED);
+    inc.pg_stat_updates[pg_t(2, 1)] = make_stat(PG_STATE_ACTIVE | PG_STATE_INCONSISTENT);
+    auto checks = apply(inc);
+    ASSERT_EQ(1u, checks.checks.count("PG_DEGRADED"));
+    ASSERT_EQ(1u, checks.checks["PG_DEGRADED"].detail.size());
+    ASSERT_EQ(1u, checks.checks.count("PG_DAMAGED"));
+  }
+  {
+    // recovered pgs drop out again
+    PGMap::Incremental inc;
+    inc.pg_stat_updates[pg_t(1, 1)] = make_stat(PG_STATE_ACTIVE | PG_STATE_CLEAN);
+    inc.pg_remove.insert(pg_t(2, 1));
+    auto checks = apply(inc);
+    ASSERT_EQ(0u, checks.checks.count("PG_DEGRADED"));
+    ASSERT_EQ(0u, checks.checks.count("PG_DAMAGED"));
+  }
+}
@@ -0,0 +1,301 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+#include <sstream>
+#include "crush/CrushWrapper.h"
+#include "global/global_context.h"
+#include "messages/MConfig.h"
+#include "mon/ConfigMap.h"
+#include "mon/MonClient.h"
+
+#include "gtest/gtest.h"
+
+using std::string;
+using config_t = EntityConfigCache::config_t;
+
+// osd.0 (ssd) on h1 and osd.1 (hdd) on h2 are in rack r1, osd.2 (ssd) on
+// h3 is in rack r2
+class EntityConfigCacheTest : public ::testing::Test {
+protected:
+  ConfigMap config_map;
+  CrushWrapper crush;
+  EntityConfigCache cache;
+
+  void SetUp() override {
+    crush.create();
+    crush.set_type_name(0, "osd");
+    crush.set_type_name(1, "host");
+    crush.set_type_name(2, "rack");
+    crush.set_type_name(3, "root");
+    int rootno;
+    ASSERT_EQ(0, crush.add_bucket(0, CRUSH_BUCKET_STRAW2,
+				  CRUSH_HASH_RJENKINS1, 3, 0, nullptr,
+				  nullptr, &rootno));
+    crush.set_item_name(rootno, "default");
+    add_osd(0, "h1", "r1", "ssd");
+    add_osd(1, "h2", "r1", "hdd");
+    add_osd(2, "h3", "r2", "ssd");
+    crush.finalize();
+  }
+
+  void add_osd(int id, const string& host, const string& rack,
+	       const string& device_class) {
+    const string name = "osd." + std::to_string(id);
+    std::map<string,string> loc = {
+      {"host", host}, {"rack", rack}, {"root", "default"}};
+    ASSERT_EQ(0, crush.insert_item(g_ceph_context, id, 1.0, name, loc));
+    std::ostringstream ss;
+    ASSERT_EQ(0, crush.update_device_class(id, device_class, name, &ss))
+      << ss.str();
+  }
+
+  // what ConfigMonitor::load_config() does for config/<who>/<name>
+  void set(const string& who, const string& name, const string& value) {
+    config_map.stray_options.push_back(
+      std::make_unique<Option>(name, Option::TYPE_STR,
+			       Option::LEVEL_UNKNOWN));
+    MaskedOption mopt(config_map.stray_options.back().get());
+    mopt.raw_value = value;
+    string section_name;
+    ASSERT_TRUE(ConfigMap::parse_mask(who, &section_name, &mopt.mask));
+    Section *section = &config_map.global;
+    if (section_name.size() && section_name != "global") {
+      if (section_name.find('.') != string::npos) {
+	section = &config_map.by_id[section_name];
+      } else {
+	section = &config_map.by_type[section_name];
+      }
+    }
+    section->options.insert(std::make_pair(name, std::move(mopt)));
+  }
+
+  const config_t& get(const string& who, const string& host = "",
+		      epoch_t epoch = 1) {
+    EntityName name;
+    EXPECT_TRUE(name.from_str(who));
+    int osd = name.is_osd() ? std::stoi(name.get_id()) : -1;
+    return cache.get(config_map, epoch, &crush, name, osd, host);
+  }
+};
+
+TEST_F(EntityConfigCacheTest, SharedByType)
+{
+  set("global", "a", "1");
+  set("osd", "b", "2");
+  cache.reset(config_map);
+
+  auto& foo = get("client.foo");
+  auto& bar = get("client.bar");
+  EXPECT_EQ(&foo, &bar);
+  EXPECT_EQ(1u, cache.size());
+  EXPECT_EQ((config_t{{"a", "1"}}), foo);
+
+  auto& osd = get("osd.0", "h1");
+  EXPECT_NE(&foo, &osd);
+  EXPECT_EQ(2u, cache.size());
+  EXPECT_EQ((config_t{{"a", "1"}, {"b", "2"}}), osd);
+}
+
+TEST_F(EntityConfigCacheTest, ById)
+{
+  set("global", "a", "1");
+  set("client.foo", "a", "2");
+  cache.reset(config_map);
+
+  auto& foo = get("client.foo");
+  auto& bar = get("client.bar");
+  EXPECT_NE(&foo, &bar);
+  EXPECT_EQ("2", foo.at("a"));
+  EXPECT_EQ("1", bar.at("a"));
+
+  // a name under client.foo matches the same by-id section and nothing else
+  EXPECT_EQ(&foo, &get("client.foo.x"));
+  EXPECT_EQ(&bar, &get("client.baz"));
+  EXPECT_EQ(2u, cache.size());
+}
+
+TEST_F(EntityConfigCacheTest, LocationMask)
+{
+  // nothing looks at the location, so it doesn't split the cache
+  set("osd", "a", "1");
+  cache.reset(config_map);
+  EXPECT_EQ(&get("osd.0", "h1"), &get("osd.2", "h3"));
+  EXPECT_EQ(1u, cache.size());
+
+  set("osd/rack:r1", "a", "2");
+  cache.reset(config_map);
+  auto& h1 = get("osd.0", "h1");
+  auto& h2 = get("osd.1", "h2");
+  auto& h3 = get("osd.2", "h3");
+  auto& unknown = get("osd.3", "");
+  EXPECT_EQ(&h1, &h2);
+  EXPECT_NE(&h1, &h3);
+  EXPECT_NE(&h3, &unknown);
+  EXPECT_EQ(3u, cache.size());
+  EXPECT_EQ("2", h1.at("a"));
+  EXPECT_EQ("1", h3.at("a"));
+  EXPECT_EQ("1", unknown.at("a"));
+}
+
+TEST_F(EntityConfigCacheTest, DeviceClass)
+{
+  set("osd", "a", "1");
+  cache.reset(config_map);
+  EXPECT_EQ(&get("osd.0", "h1"), &get("osd.1", "h2"));
+  EXPECT_EQ(1u, cache.size());
+
+  set("osd/class:ssd", "a", "2");
+  cache.reset(config_map);
+  auto& ssd = get("osd.0", "h1");
+  auto& hdd = get("osd.1", "h2");
+  EXPECT_NE(&ssd, &hdd);
+  EXPECT_EQ(&ssd, &get("osd.2", "h3"));
+  EXPECT_EQ(2u, cache.size());
+  EXPECT_EQ("2", ssd.at("a"));
+  EXPECT_EQ("1", hdd.at("a"));
+}
+
+TEST_F(EntityConfigCacheTest, Invalidation)
+{
+  set("global", "a", "1");
+  cache.reset(config_map);
+  EXPECT_EQ((config_t{{"a", "1"}}), get("client.foo", "", 1));
+
+  // a change the cache wasn't told about is only seen with a new epoch
+  set("global", "b", "2");
+  EXPECT_EQ((config_t{{"a", "1"}}), get("client.foo", "", 1));
+  EXPECT_EQ((config_t{{"a", "1"}, {"b", "2"}}), get("client.foo", "", 2));
+  EXPECT_EQ(1u, cache.size());
+
+  // or once the config is reloaded
+  set("global", "c", "3");
+  cache.reset(config_map);
+  EXPECT_EQ(0u, cache.size());
+  EXPECT_EQ((config_t{{"a", "1"}, {"b", "2"}, {"c", "3"}}),
+	    get("client.foo", "", 2));
+
+  // a location mask added on reload is looked up from then on
+  set("rack:r2", "d", "4");
+  cache.reset(config_map);
+  EXPECT_EQ(0u, get("osd.0", "h1", 2).count("d"));
+  EXPECT_EQ("4", get("osd.2", "h3", 2).at("d"));
+}
+
+TEST(MConfig, Diff)
+{
+  config_t prev = {{"a", "1"}, {"b", "2"}, {"c", "3"}};
+  config_t cur = {{"a", "1"}, {"b", "20"}, {"d", "4"}};
+
+  auto m = ceph::make_message<MConfig>();
+  m->set_diff(prev, cur);
+  EXPECT_TRUE(m->incremental);
+  EXPECT_EQ((config_t{{"b", "20"}, {"d", "4"}}), m->config);
+  EXPECT_EQ((std::set<string>{"c"}), m->removed);
+
+  m->apply(&prev);
+  EXPECT_EQ(cur, prev);
+}
+
+TEST(MConfig, DiffEdges)
+{
+  auto m = ceph::make_message<MConfig>();
+  m->set_diff({{"a", "1"}}, {{"a", "1"}});
+  EXPECT_TRUE(m->config.empty());
+  EXPECT_TRUE(m->removed.empty());
+
+  m->set_diff({}, {{"a", "1"}, {"b", "2"}});
+  EXPECT_EQ((config_t{{"a", "1"}, {"b", "2"}}), m->config);
+  EXPECT_TRUE(m->removed.empty());
+
+  m->set_diff({{"a", "1"}, {"b", "2"}}, {});
+  EXPECT_TRUE(m->config.empty());
+  EXPECT_EQ((std::set<string>{"a", "b"}), m->removed);
+}
+
+TEST(MConfig, Encoding)
+{
+  auto m = ceph::make_message<MConfig>();
+  m->set_diff({{"a", "1"}, {"c", "3"}}, {{"a", "2"}, {"b", "1"}});
+  m->encode_payload(0);
+
+  auto decoded = ceph::make_message<MConfig>();
+  decoded->set_payload(m->get_payload());
+  decoded->decode_payload();
+  EXPECT_TRUE(decoded->incremental);
+  EXPECT_EQ(m->config, decoded->config);
+  EXPECT_EQ(m->removed, decoded->removed);
+
+  // a v1 message only carries the full set
+  using ceph::encode;
+  ceph::buffer::list bl;
+  encode(config_t{{"a", "1"}}, bl);
+  auto v1 = ceph::make_message<MConfig>();
+  v1->get_header().version = 1;
+  v1->set_payload(bl);
+  v1->decode_payload();
+  EXPECT_FALSE(v1->incremental);
+  EXPECT_EQ((config_t{{"a", "1"}}), v1->config);
+}
+
+// handle_config() hands the expanded message to a waiting
+// get_monmap_and_config(), which is the easiest place to look at it
+class MonClientConfigTest : public ::testing::Test {
+protected:
+  boost::asio::io_context ioctx;
+  MonClient monc{g_ceph_context, ioctx};
+
+  void SetUp() override {
+    monc.want_bootstrap_config = true;
+  }
+
+  config_t handle(MConfig *m) {
+    monc.handle_config(m);
+    EXPECT_TRUE(monc.bootstrap_config);
+    if (!monc.bootstrap_config) {
+      return {};
+    }
+    EXPECT_FALSE(monc.bootstrap_config->incremental);
+    EXPECT_TRUE(monc.bootstrap_config->removed.empty());
+    config_t config = monc.bootstrap_config->config;
+    monc.bootstrap_config.reset();
+    return config;
+  }
+
+  static MConfig *make_diff(const config_t& prev, const config_t& cur) {
+    auto m = new MConfig;
+    m->set_diff(prev, cur);
+    return m;
+  }
+};
+
+TEST_F(MonClientConfigTest, DiffAfterFull)
+{
+  const config_t full = {{"a", "1"}, {"b", "2"}, {"c", "3"}};
+  EXPECT_EQ(full, handle(new MConfig(full)));
+
+  const config_t next = {{"a", "1"}, {"b", "20"}, {"d", "4"}};
+  EXPECT_EQ(next, handle(make_diff(full, next)));
+
+  const config_t last = {{"b", "20"}};
+  EXPECT_EQ(last, handle(make_diff(next, last)));
+}
+
+TEST_F(MonClientConfigTest, FullReplaces)
+{
+  EXPECT_EQ((config_t{{"a", "1"}}), handle(new MConfig(config_t{{"a", "1"}})));
+
+  // a full map, as sent on a new session, drops whatever was there
+  EXPECT_EQ((config_t{{"b", "2"}}), handle(new MConfig(config_t{{"b", "2"}})));
+
+  // and later diffs apply to it
+  EXPECT_EQ((config_t{{"b", "2"}, {"c", "3"}}),
+	    handle(make_diff({{"b", "2"}}, {{"b", "2"}, {"c", "3"}})));
+}
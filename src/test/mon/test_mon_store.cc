@@ -0,0 +1,201 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+#include <filesystem>
+#include <set>
+#include <sstream>
+#include <stdlib.h>
+#include "global/global_context.h"
+#include "mon/MonitorDBStore.h"
+
+#include "gtest/gtest.h"
+
+namespace fs = std::filesystem;
+
+using Transaction = MonitorDBStore::Transaction;
+
+static const std::string prefix = "paxos";
+
+// apply the transaction to the version keys [first, last] and return
+// the versions left behind
+static std::set<version_t> apply(const Transaction& t,
+				 version_t first, version_t last)
+{
+  std::set<std::string> keys;
+  for (version_t v = first; v <= last; ++v) {
+    keys.insert(std::to_string(v));
+  }
+  for (auto& op : t.ops) {
+    EXPECT_EQ(prefix, op.prefix);
+    if (op.type == Transaction::OP_ERASE) {
+      keys.erase(op.key);
+    } else if (op.type == Transaction::OP_ERASE_RANGE) {
+      keys.erase(keys.lower_bound(op.key), keys.lower_bound(op.endkey));
+    } else {
+      ADD_FAILURE() << "unexpected op type " << (int)op.type;
+    }
+  }
+  std::set<version_t> versions;
+  for (auto& k : keys) {
+    versions.insert(std::stoull(k));
+  }
+  return versions;
+}
+
+static void expect_trimmed(version_t first, version_t to, version_t last)
+{
+  Transaction t;
+  t.erase_versions(prefix, "", first, to, last);
+  auto left = apply(t, first, last);
+  ASSERT_EQ(last - to + 1, left.size())
+    << "first " << first << " to " << to << " last " << last;
+  EXPECT_EQ(to, *left.begin());
+  EXPECT_EQ(last, *left.rbegin());
+}
+
+TEST(MonitorDBStore, EraseVersionsEmpty)
+{
+  Transaction t;
+  t.erase_versions(prefix, "", 10, 10, 20);
+  EXPECT_TRUE(t.ops.empty());
+  uint64_t erases, ranges;
+  t.count_erases(&erases, &ranges);
+  EXPECT_EQ(0u, erases);
+  EXPECT_EQ(0u, ranges);
+}
+
+TEST(MonitorDBStore, EraseVersionsSingle)
+{
+  Transaction t;
+  t.erase_versions(prefix, "", 150, 151, 200);
+  uint64_t erases, ranges;
+  t.count_erases(&erases, &ranges);
+  EXPECT_EQ(1u, erases);
+  EXPECT_EQ(0u, ranges);
+}
+
+TEST(MonitorDBStore, EraseVersionsRange)
+{
+  Transaction t;
+  t.erase_versions(prefix, "", 100, 200, 250);
+  ASSERT_EQ(1u, t.ops.size());
+  auto& op = t.ops.front();
+  EXPECT_EQ(Transaction::OP_ERASE_RANGE, op.type);
+  EXPECT_EQ("100", op.key);
+  EXPECT_EQ(std::string("199") + '\0', op.endkey);
+}
+
+TEST(MonitorDBStore, EraseVersionsCoversLive)
+{
+  // ["1", "9\0") would also cover the live "10" ... "15"
+  Transaction t;
+  t.erase_versions(prefix, "", 1, 10, 15);
+  uint64_t erases, ranges;
+  t.count_erases(&erases, &ranges);
+  EXPECT_EQ(9u, erases);
+  EXPECT_EQ(0u, ranges);
+  EXPECT_EQ(6u, apply(t, 1, 15).size());
+}
+
+TEST(MonitorDBStore, EraseVersionsSkipsMissing)
+{
+  Transaction t;
+  t.erase_versions(prefix, "full_", 1, 10, 15,
+		   [](version_t v) { return v % 5 == 0; });
+  uint64_t erases, ranges;
+  t.count_erases(&erases, &ranges);
+  EXPECT_EQ(1u, erases);
+  EXPECT_EQ(0u, ranges);
+  EXPECT_EQ("full_5", t.ops.front().key);
+}
+
+TEST(MonitorDBStore, EraseVersionsAcrossWidths)
+{
+  for (version_t first : {1, 7, 9, 10, 95, 99, 100, 995}) {
+    for (version_t to = first; to < first + 130; ++to) {
+      for (version_t last : {to, to + 1, to + 9, to + 95, to * 10 + 5,
+			     to * 100 + 50}) {
+	expect_trimmed(first, to, last);
+      }
+    }
+  }
+}
+
+// range deletes are applied key by key below the store's
+// delete_range_threshold and as a DeleteRange from there on; either
+// way exactly the trimmed versions must go
+class MonitorDBStoreTest : public ::testing::Test {
+protected:
+  std::string dir;
+  std::unique_ptr<MonitorDBStore> store;
+
+  void SetUp() override {
+    char path[] = "/tmp/unittest_mon_store.XXXXXX";
+    ASSERT_NE(nullptr, ::mkdtemp(path));
+    dir = path;
+    store = std::make_unique<MonitorDBStore>(dir);
+    std::ostringstream err;
+    ASSERT_EQ(0, store->create_and_open(err)) << err.str();
+  }
+  void TearDown() override {
+    if (store) {
+      store->close();
+      store.reset();
+    }
+    fs::remove_all(dir);
+  }
+
+  void trim(version_t first, version_t to, version_t last) {
+    auto t = std::make_shared<Transaction>();
+    for (version_t v = first; v <= last; ++v) {
+      ceph::buffer::list bl;
+      bl.append("x");
+      t->put(prefix, v, bl);
+    }
+    ASSERT_EQ(0, store->apply_transaction(t));
+
+    t = std::make_shared<Transaction>();
+    t->erase_versions(prefix, "", first, to, last);
+    ASSERT_EQ(0, store->apply_transaction(t));
+
+    for (version_t v = first; v <= last; ++v) {
+      EXPECT_EQ(v >= to, store->exists(prefix, v)) << "version " << v;
+    }
+  }
+};
+
+TEST_F(MonitorDBStoreTest, EraseVersionsBelowThreshold)
+{
+  const auto threshold = g_conf().get_val<uint64_t>(
+    "mon_rocksdb_delete_range_threshold");
+  trim(1000, 1000 + threshold - 1, 1000 + threshold + 10);
+}
+
+TEST_F(MonitorDBStoreTest, EraseVersionsAtThreshold)
+{
+  const auto threshold = g_conf().get_val<uint64_t>(
+    "mon_rocksdb_delete_range_threshold");
+  trim(1000, 1000 + threshold, 1000 + threshold + 10);
+}
+
+TEST_F(MonitorDBStoreTest, EraseVersionsAboveThreshold)
+{
+  const auto threshold = g_conf().get_val<uint64_t>(
+    "mon_rocksdb_delete_range_threshold");
+  trim(1000, 1000 + 4 * threshold, 1000 + 4 * threshold + 10);
+}
+
+TEST_F(MonitorDBStoreTest, EraseVersionsAboveThresholdCoversLive)
+{
+  // the trimmed run is three digits wide and the live keys four, so
+  // most of the trim falls back to single key deletes
+  trim(100, 999, 1200);
+}
@@ -20,6 +20,7 @@
 
 #include <fcntl.h>
 #include <sys/socket.h>
+#include <unistd.h>
 #include <pthread.h>
 #include <stdint.h>
 #include <arpa/inet.h>
@@ -330,6 +331,36 @@ TEST(EventCenterTest, DispatchTest) {
   worker2.join();
 }
 
+TEST(EventCenterTest, BusyPollDispatchTest) {
+  g_ceph_context->_conf.set_val_or_die("ms_async_busy_poll_us", "1000");
+  Worker worker1(g_ceph_context, 1), worker2(g_ceph_context, 2);
+  g_ceph_context->_conf.set_val_or_die("ms_async_busy_poll_us", "0");
+  ASSERT_TRUE(worker1.center.is_busy_polling());
+  std::atomic<unsigned> count = { 0 };
+  ceph::mutex lock = ceph::make_mutex("BusyPollDispatchTest::lock");
+  ceph::condition_variable cond;
+  worker1.create("worker_1");
+  worker2.create("worker_2");
+  for (int i = 0; i < 10000; ++i) {
+    count++;
+    worker1.center.dispatch_event_external(EventCallbackRef(new CountEvent(&count, &lock, &cond)));
+    count++;
+    worker2.center.dispatch_event_external(EventCallbackRef(new CountEvent(&count, &lock, &cond)));
+    std::unique_lock l{lock};
+    cond.wait(l, [&] { return count == 0; });
+    if (i % 1000 == 0) {
+      // let the spin window expire so that both the spinning and the
+      // blocking wakeup paths are exercised
+      l.unlock();
+      usleep(2000);
+    }
+  }
+  worker1.stop();
+  worker2.stop();
+  worker1.join();
+  worker2.join();
+}
+
 INSTANTIATE_TEST_SUITE_P(
   AsyncMessenger,
   EventDriverTest,
@@ -12,6 +12,7 @@
 #include "common/ceph_json.h"
 
 #include <iostream>
+#include <thread>
 
 using namespace std;
 
@@ -452,6 +453,159 @@ TEST_F(OSDMapTest, KeepsNecessaryTemps) {
   EXPECT_FALSE(pending_inc.new_primary_temp.count(pgid));
 }
 
+TEST_F(OSDMapTest, IncrementalMapping) {
+  set_up_map();
+  ThreadPool tp(g_ceph_context, "IncrementalMapping::tp", "mapping_tp", 4);
+  tp.start();
+  ParallelPGMapper mapper(g_ceph_context, &tp);
+  mapping.update(osdmap);
+
+  auto check = [&]() {
+    OSDMapMapping full;
+    full.update(osdmap);
+    for (auto& p : osdmap.get_pools()) {
+      for (unsigned ps = 0; ps < p.second.get_pg_num(); ++ps) {
+        pg_t pgid(ps, p.first);
+        vector<int> up, acting, up2, acting2;
+        int up_primary, acting_primary, up_primary2, acting_primary2;
+        full.get(pgid, &up, &up_primary, &acting, &acting_primary);
+        mapping.get(pgid, &up2, &up_primary2, &acting2, &acting_primary2);
+        ASSERT_EQ(up, up2) << pgid;
+        ASSERT_EQ(up_primary, up_primary2) << pgid;
+        ASSERT_EQ(acting, acting2) << pgid;
+        ASSERT_EQ(acting_primary, acting_primary2) << pgid;
+      }
+    }
+    ASSERT_EQ(osdmap.get_epoch(), mapping.get_epoch());
+  };
+  auto apply = [&](OSDMap::Incremental& inc) {
+    mapping.note_incremental(osdmap, inc);
+    osdmap.apply_incremental(inc);
+    auto job = mapping.start_update(osdmap, mapper, 16, true);
+    job->wait();
+  };
+
+  pg_t pgid = osdmap.raw_pg_to_pg(pg_t(0, my_rep_pool));
+  vector<int> up;
+  osdmap.pg_to_raw_up(pgid, &up);
+  ASSERT_EQ(3u, up.size());
+  int spare = -1;
+  for (int i = 0; i < (int)get_num_osds(); ++i) {
+    if (std::find(up.begin(), up.end(), i) == up.end()) {
+      spare = i;
+      break;
+    }
+  }
+  ASSERT_NE(-1, spare);
+  {
+    // upmap items
+    OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+    inc.new_pg_upmap_items[pgid] =
+      mempool::osdmap::vector<pair<int32_t,int32_t>>{{up[0], spare}};
+    apply(inc);
+    check();
+  }
+  {
+    // osd marked down; pgs upmapped to it must also be recomputed
+    OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+    inc.new_state[spare] = CEPH_OSD_UP;
+    apply(inc);
+    check();
+  }
+  {
+    // pg_temp, and an osd marked out
+    OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+    inc.new_pg_temp[pgid] =
+      mempool::osdmap::vector<int32_t>{up[1], up[2]};
+    inc.new_weight[up[1]] = CEPH_OSD_OUT;
+    apply(inc);
+    check();
+  }
+  {
+    // nothing placement related
+    OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+    apply(inc);
+    check();
+  }
+  {
+    // an epoch that was never noted forces a full update
+    OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+    inc.old_pg_upmap_items.insert(pgid);
+    inc.new_weight[up[1]] = CEPH_OSD_IN;
+    osdmap.apply_incremental(inc);
+    auto job = mapping.start_update(osdmap, mapper, 16, true);
+    job->wait();
+    check();
+  }
+  tp.stop();
+}
+
+TEST_F(OSDMapTest, IncrementalMappingDuringUpdate) {
+  set_up_map();
+  ThreadPool tp(g_ceph_context, "IncrementalMapping::tp", "mapping_tp", 4);
+  tp.start();
+  ParallelPGMapper mapper(g_ceph_context, &tp);
+  mapping.update(osdmap);
+
+  auto check = [&]() {
+    OSDMapMapping full;
+    full.update(osdmap);
+    for (auto& p : osdmap.get_pools()) {
+      for (unsigned ps = 0; ps < p.second.get_pg_num(); ++ps) {
+        pg_t pgid(ps, p.first);
+        vector<int> up, acting, up2, acting2;
+        int up_primary, acting_primary, up_primary2, acting_primary2;
+        full.get(pgid, &up, &up_primary, &acting, &acting_primary);
+        mapping.get(pgid, &up2, &up_primary2, &acting2, &acting_primary2);
+        ASSERT_EQ(up, up2) << pgid;
+        ASSERT_EQ(up_primary, up_primary2) << pgid;
+        ASSERT_EQ(acting, acting2) << pgid;
+        ASSERT_EQ(acting_primary, acting_primary2) << pgid;
+      }
+    }
+    ASSERT_EQ(osdmap.get_epoch(), mapping.get_epoch());
+  };
+
+  pg_t pgid = osdmap.raw_pg_to_pg(pg_t(0, my_rep_pool));
+  vector<int> up;
+  osdmap.pg_to_raw_up(pgid, &up);
+  ASSERT_EQ(3u, up.size());
+  {
+    // the job can't finish before the note, so completing it drops the
+    // note and the next update recomputes every pg
+    tp.pause();
+    auto job = mapping.start_update(osdmap, mapper, 16);
+    OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+    inc.new_pg_temp[pgid] =
+      mempool::osdmap::vector<int32_t>{up[1], up[2]};
+    mapping.note_incremental(osdmap, inc);
+    ASSERT_FALSE(job->is_done());
+    tp.unpause();
+    job->wait();
+    osdmap.apply_incremental(inc);
+    job = mapping.start_update(osdmap, mapper, 16, true);
+    job->wait();
+    check();
+  }
+  for (int i = 0; i < 20; ++i) {
+    // note from another thread while the job runs; whichever finishes
+    // first, the following update must end up with the right mapping
+    auto job = mapping.start_update(osdmap, mapper, 1);
+    OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+    inc.new_weight[up[i % 3]] = i % 2 ? CEPH_OSD_IN : CEPH_OSD_OUT;
+    std::thread noter([&] {
+      mapping.note_incremental(osdmap, inc);
+    });
+    noter.join();
+    job->wait();
+    osdmap.apply_incremental(inc);
+    job = mapping.start_update(osdmap, mapper, 16, true);
+    job->wait();
+    check();
+  }
+  tp.stop();
+}
+
 TEST_F(OSDMapTest, PrimaryAffinity) {
   set_up_map();
 
@@ -1395,6 +1549,53 @@ TEST_F(OSDMapTest, BUG_40104) {
   }
 }
 
+TEST_F(OSDMapTest, CalcPGUpmapsParallel) {
+  // parallel candidate evaluation must not change the result
+  set_up_map(60, true);
+  int64_t pool_id;
+  {
+    OSDMap::Incremental pending_inc(osdmap.get_epoch() + 1);
+    pending_inc.new_pool_max = osdmap.get_pool_max();
+    pool_id = ++pending_inc.new_pool_max;
+    pg_pool_t empty;
+    auto p = pending_inc.get_new_pool(pool_id, &empty);
+    p->size = 3;
+    p->min_size = 1;
+    p->set_pg_num(1024);
+    p->set_pgp_num(1024);
+    p->type = pg_pool_t::TYPE_REPLICATED;
+    p->crush_rule = 0;
+    p->set_flag(pg_pool_t::FLAG_HASHPSPOOL);
+    pending_inc.new_pool_names[pool_id] = "upmap_pool";
+    osdmap.apply_incremental(pending_inc);
+  }
+  // the aggressive mode shuffles candidates at random
+  g_ceph_context->_conf.set_val("osd_calc_pg_upmaps_aggressively", "false");
+
+  OSDMap::Incremental serial_inc(osdmap.get_epoch() + 1);
+  int serial = osdmap.calc_pg_upmaps(g_ceph_context, 1, 100, {pool_id},
+                                     &serial_inc);
+  ASSERT_GT(serial, 0);
+
+  ThreadPool tp(g_ceph_context, "CalcPGUpmapsParallel::tp", "upmap_tp", 4);
+  tp.start();
+  ParallelPGMapper mapper(g_ceph_context, &tp);
+  OSDMap::Incremental parallel_inc(osdmap.get_epoch() + 1);
+  int parallel = osdmap.calc_pg_upmaps(g_ceph_context, 1, 100, {pool_id},
+                                       &parallel_inc, &mapper);
+
+  // nothing to map: the mapper must not be handed an empty job
+  OSDMap::Incremental none_inc(osdmap.get_epoch() + 1);
+  ASSERT_EQ(0, osdmap.calc_pg_upmaps(g_ceph_context, 1, 100, {pool_id + 1},
+                                     &none_inc, &mapper));
+  tp.stop();
+  g_ceph_context->_conf.rm_val("osd_calc_pg_upmaps_aggressively");
+
+  ASSERT_EQ(serial, parallel);
+  ASSERT_EQ(serial_inc.old_pg_upmap_items, parallel_inc.old_pg_upmap_items);
+  ASSERT_EQ(serial_inc.new_pg_upmap_items, parallel_inc.new_pg_upmap_items);
+}
+
 TEST_F(OSDMapTest, BUG_42052) {
   // https://tracker.ceph.com/issues/42052
   set_up_map(6, true);
@@ -0,0 +1,227 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation. See file COPYING.
+ *
+ */
+#include <chrono>
+#include <thread>
+#include "global/global_init.h"
+#include "common/ceph_argparse.h"
+#include "rgw/rgw_cache.h"
+#include <gtest/gtest.h>
+
+using namespace std;
+
+// rgw_cache_shards can't change at runtime, so main() sets it once for all
+// tests. each test then picks names by the shard they hash to.
+static constexpr size_t num_shards = 4;
+
+static size_t shard_of(const string& name)
+{
+  return std::hash<string>{}(name) % num_shards;
+}
+
+// the first count names that hash to the given shard
+static vector<string> names_in_shard(size_t shard, size_t count)
+{
+  vector<string> names;
+  for (int i = 0; names.size() < count; ++i) {
+    string name = "obj" + std::to_string(i);
+    if (shard_of(name) == shard) {
+      names.push_back(name);
+    }
+  }
+  return names;
+}
+
+struct CacheFixture : public ::testing::Test {
+  const DoutPrefix dp{g_ceph_context, 1, "test rgw cache: "};
+  ObjectCache cache;
+
+  // lru_size is split evenly across the shards
+  void init(uint64_t lru_size, uint64_t expiry_secs = 0) {
+    auto& conf = g_ceph_context->_conf;
+    conf.set_val_or_die("rgw_cache_lru_size", std::to_string(lru_size));
+    conf.set_val_or_die("rgw_cache_expiry_interval",
+			std::to_string(expiry_secs));
+    cache.set_ctx(g_ceph_context);
+    cache.set_enabled(true);
+  }
+
+  void put(const string& name, rgw_cache_entry_info *cache_info = nullptr) {
+    ObjectCacheInfo info;
+    info.flags = CACHE_FLAG_DATA;
+    info.data.append(name);
+    cache.put(&dp, name, info, cache_info);
+  }
+
+  int get(const string& name, rgw_cache_entry_info *cache_info = nullptr) {
+    ObjectCacheInfo info;
+    return cache.get(&dp, name, info, 0, cache_info);
+  }
+};
+
+TEST_F(CacheFixture, PerShardCapacity)
+{
+  init(2 * num_shards);
+
+  // fill each shard past its share of lru_size. without hits the hand
+  // evicts in insertion order, so only the last two names of each survive
+  vector<vector<string>> names;
+  for (size_t s = 0; s < num_shards; ++s) {
+    names.push_back(names_in_shard(s, 5));
+  }
+  for (size_t i = 0; i < 5; ++i) {
+    for (size_t s = 0; s < num_shards; ++s) {
+      put(names[s][i]);
+    }
+  }
+  for (size_t s = 0; s < num_shards; ++s) {
+    EXPECT_EQ(-ENOENT, get(names[s][0]));
+    EXPECT_EQ(-ENOENT, get(names[s][1]));
+    EXPECT_EQ(-ENOENT, get(names[s][2]));
+    EXPECT_EQ(0, get(names[s][3]));
+    EXPECT_EQ(0, get(names[s][4]));
+  }
+}
+
+TEST_F(CacheFixture, FullShardDoesNotEvictOtherShards)
+{
+  init(2 * num_shards);
+
+  auto other = names_in_shard(1, 2);
+  put(other[0]);
+  put(other[1]);
+
+  for (auto& name : names_in_shard(0, 20)) {
+    put(name);
+  }
+  EXPECT_EQ(0, get(other[0]));
+  EXPECT_EQ(0, get(other[1]));
+}
+
+TEST_F(CacheFixture, SecondChance)
+{
+  init(3 * num_shards);
+
+  auto names = names_in_shard(0, 6);
+  const auto& a = names[0];
+  const auto& b = names[1];
+  const auto& c = names[2];
+  const auto& d = names[3];
+  const auto& e = names[4];
+  const auto& f = names[5];
+
+  put(a);
+  put(b);
+  put(c);
+  // the hit marks a as referenced, so the hand passes over it once
+  ASSERT_EQ(0, get(a));
+  put(d);
+  put(e);
+  EXPECT_EQ(-ENOENT, get(b));
+  EXPECT_EQ(-ENOENT, get(c));
+
+  // a's flag was cleared on the first pass and it wasn't hit again
+  put(f);
+  EXPECT_EQ(-ENOENT, get(a));
+  EXPECT_EQ(0, get(d));
+  EXPECT_EQ(0, get(e));
+  EXPECT_EQ(0, get(f));
+}
+
+TEST_F(CacheFixture, NegativeEntry)
+{
+  init(2 * num_shards);
+
+  ObjectCacheInfo info;
+  info.status = -ENOENT;
+  cache.put(&dp, "missing", info, nullptr);
+  EXPECT_EQ(-ENODATA, get("missing"));
+}
+
+TEST_F(CacheFixture, Expiry)
+{
+  init(2 * num_shards, 1);
+
+  put("obj");
+  ASSERT_EQ(0, get("obj"));
+  std::this_thread::sleep_for(std::chrono::seconds(2));
+  EXPECT_EQ(-ENOENT, get("obj"));
+}
+
+struct TestChainedCache : public RGWChainedCache {
+  vector<string> chained;
+  vector<string> invalidated;
+
+  void chain_cb(const string& key, void *data) override {
+    chained.push_back(key);
+  }
+  void invalidate(const string& key) override {
+    invalidated.push_back(key);
+  }
+  void invalidate_all() override {}
+};
+
+TEST_F(CacheFixture, ChainAcrossShards)
+{
+  init(2 * num_shards);
+
+  TestChainedCache chained;
+  cache.chain_cache(&chained);
+
+  const string first = names_in_shard(0, 1).front();
+  const string second = names_in_shard(1, 1).front();
+  ASSERT_NE(shard_of(first), shard_of(second));
+
+  rgw_cache_entry_info first_info, second_info;
+  put(first, &first_info);
+  put(second, &second_info);
+
+  const string key = "chained";
+  RGWChainedCache::Entry entry(&chained, key, nullptr);
+  ASSERT_TRUE(cache.chain_cache_entry(&dp, {&first_info, &second_info}, &entry));
+  ASSERT_EQ(1u, chained.chained.size());
+
+  // updating either entry invalidates the chained one
+  put(second);
+  ASSERT_EQ(1u, chained.invalidated.size());
+  EXPECT_EQ(key, chained.invalidated.front());
+
+  // and chaining against the old generation fails
+  EXPECT_FALSE(cache.chain_cache_entry(&dp, {&first_info, &second_info}, &entry));
+  EXPECT_EQ(1u, chained.chained.size());
+
+  ASSERT_EQ(0, get(second, &second_info));
+  EXPECT_TRUE(cache.chain_cache_entry(&dp, {&first_info, &second_info}, &entry));
+
+  // removing an entry invalidates it as well
+  chained.invalidated.clear();
+  EXPECT_TRUE(cache.remove(&dp, first));
+  ASSERT_FALSE(chained.invalidated.empty());
+  EXPECT_EQ(key, chained.invalidated.back());
+
+  cache.unchain_cache(&chained);
+}
+
+int main(int argc, char** argv)
+{
+  vector<const char*> args;
+  argv_to_vec(argc, (const char **)argv, args);
+
+  auto cct = global_init(NULL, args, CEPH_ENTITY_TYPE_CLIENT,
+			 CODE_ENVIRONMENT_UTILITY,
+			 CINIT_FLAG_NO_DEFAULT_CONFIG_FILE);
+  g_ceph_context->_conf.set_val_or_die("rgw_cache_shards",
+				       std::to_string(num_shards));
+  common_init_finish(g_ceph_context);
+
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,198 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation. See file COPYING.
+ *
+ */
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <thread>
+#include <stdlib.h>
+#include <unistd.h>
+#include "global/global_init.h"
+#include "common/ceph_argparse.h"
+#include "rgw/rgw_datacache.h"
+#include <gtest/gtest.h>
+
+using namespace std;
+namespace fs = std::filesystem;
+
+// the datacache options can't change at runtime, so main() sets them once
+static string cache_dir;
+static constexpr uint64_t capacity = 16 * 1024;
+
+static ceph::bufferlist make_data(char c, size_t len)
+{
+  ceph::bufferlist bl;
+  bl.append(string(len, c));
+  return bl;
+}
+
+// fills are written asynchronously, so poll until the entry shows up
+static int wait_for(RGWDataCache& cache, const string& key, uint64_t len)
+{
+  for (int i = 0; i < 1000; ++i) {
+    int fd = cache.lookup(key, len);
+    if (fd >= 0) {
+      return fd;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  return -ETIMEDOUT;
+}
+
+static bool cached(RGWDataCache& cache, const string& key, uint64_t len)
+{
+  int fd = cache.lookup(key, len);
+  if (fd < 0) {
+    return false;
+  }
+  ::close(fd);
+  return true;
+}
+
+static pair<int, string> read_fd(RGWDataCache& cache, int fd, uint64_t len)
+{
+  std::promise<pair<int, string>> done;
+  auto result = done.get_future();
+  cache.read(fd, len, [&done] (int r, ceph::bufferlist&& bl) {
+    done.set_value({r, bl.to_str()});
+  });
+  return result.get();
+}
+
+TEST(DataCache, WipesDirectoryOnStart)
+{
+  fs::create_directories(cache_dir + "/stale_dir");
+  std::ofstream(cache_dir + "/0") << "stale";
+  std::ofstream(cache_dir + "/stale_dir/file") << "stale";
+
+  RGWDataCache cache(g_ceph_context);
+  ASSERT_EQ(0, cache.start());
+  EXPECT_TRUE(fs::is_directory(cache_dir));
+  EXPECT_TRUE(fs::is_empty(cache_dir));
+
+  // nothing from a previous run is served either
+  EXPECT_EQ(-ENOENT, cache.lookup("0", 5));
+}
+
+TEST(DataCache, FillAndRead)
+{
+  RGWDataCache cache(g_ceph_context);
+  ASSERT_EQ(0, cache.start());
+
+  const auto data = make_data('a', 4096);
+  EXPECT_EQ(-ENOENT, cache.lookup("obj", data.length()));
+  cache.fill("obj", data);
+
+  int fd = wait_for(cache, "obj", data.length());
+  ASSERT_LE(0, fd);
+  auto [r, str] = read_fd(cache, fd, data.length());
+  ASSERT_EQ(0, r);
+  EXPECT_EQ(data.to_str(), str);
+
+  // the length is part of the match
+  EXPECT_EQ(-ENOENT, cache.lookup("obj", data.length() - 1));
+}
+
+TEST(DataCache, TooLargeIsNotCached)
+{
+  RGWDataCache cache(g_ceph_context);
+  ASSERT_EQ(0, cache.start());
+
+  const auto big = make_data('b', capacity + 1);
+  cache.fill("big", big);
+  const auto small = make_data('s', 16);
+  cache.fill("small", small);
+
+  // a single worker writes fills in order, so by the time small is in
+  // big would have been too
+  int fd = wait_for(cache, "small", small.length());
+  ASSERT_LE(0, fd);
+  ::close(fd);
+  EXPECT_FALSE(cached(cache, "big", big.length()));
+}
+
+TEST(DataCache, EvictsLeastRecentlyUsed)
+{
+  RGWDataCache cache(g_ceph_context);
+  ASSERT_EQ(0, cache.start());
+
+  // two entries fit, a third needs one of them to go
+  const uint64_t len = capacity * 3 / 8;
+  cache.fill("a", make_data('a', len));
+  int fd = wait_for(cache, "a", len);
+  ASSERT_LE(0, fd);
+  ::close(fd);
+  cache.fill("b", make_data('b', len));
+  fd = wait_for(cache, "b", len);
+  ASSERT_LE(0, fd);
+  ::close(fd);
+
+  // the hit makes a more recently used than b
+  ASSERT_TRUE(cached(cache, "a", len));
+
+  cache.fill("c", make_data('c', len));
+  fd = wait_for(cache, "c", len);
+  ASSERT_LE(0, fd);
+  ::close(fd);
+
+  EXPECT_FALSE(cached(cache, "b", len));
+  EXPECT_TRUE(cached(cache, "a", len));
+}
+
+TEST(DataCache, ReadAfterEviction)
+{
+  RGWDataCache cache(g_ceph_context);
+  ASSERT_EQ(0, cache.start());
+
+  const uint64_t len = capacity * 3 / 4;
+  const auto data = make_data('x', len);
+  cache.fill("x", data);
+  int fd = wait_for(cache, "x", len);
+  ASSERT_LE(0, fd);
+
+  // the descriptor stays valid after the entry is evicted
+  cache.fill("y", make_data('y', len));
+  int yfd = wait_for(cache, "y", len);
+  ASSERT_LE(0, yfd);
+  ::close(yfd);
+  EXPECT_FALSE(cached(cache, "x", len));
+
+  auto [r, str] = read_fd(cache, fd, len);
+  ASSERT_EQ(0, r);
+  EXPECT_EQ(data.to_str(), str);
+}
+
+int main(int argc, char** argv)
+{
+  vector<const char*> args;
+  argv_to_vec(argc, (const char **)argv, args);
+
+  auto cct = global_init(NULL, args, CEPH_ENTITY_TYPE_CLIENT,
+			 CODE_ENVIRONMENT_UTILITY,
+			 CINIT_FLAG_NO_DEFAULT_CONFIG_FILE);
+
+  char tmpl[] = "/tmp/unittest_rgw_datacache.XXXXXX";
+  if (!::mkdtemp(tmpl)) {
+    return EXIT_FAILURE;
+  }
+  cache_dir = string(tmpl) + "/cache";
+  auto& conf = g_ceph_context->_conf;
+  conf.set_val_or_die("rgw_datacache_path", cache_dir);
+  conf.set_val_or_die("rgw_datacache_size", std::to_string(capacity));
+  conf.set_val_or_die("rgw_datacache_threads", "1");
+  common_init_finish(g_ceph_context);
+
+  ::testing::InitGoogleTest(&argc, argv);
+  int r = RUN_ALL_TESTS();
+  fs::remove_all(tmpl);
+  return r;
+}
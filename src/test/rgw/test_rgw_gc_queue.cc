@@ -0,0 +1,145 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation. See file COPYING.
+ *
+ */
+
+#include "rgw/rgw_gc.h"
+
+#include <gtest/gtest.h>
+
+using Batch = RGWGCQueueBatches::Batch;
+
+TEST(GCQueueBatches, Empty)
+{
+  RGWGCQueueBatches batches;
+  EXPECT_EQ(nullptr, batches.io_started());
+  int num_entries = -1;
+  EXPECT_EQ(0, batches.pop_done(&num_entries));
+  EXPECT_EQ(0, num_entries);
+}
+
+TEST(GCQueueBatches, NoTails)
+{
+  // entries without tail objects are done as soon as they're listed
+  RGWGCQueueBatches batches;
+  batches.start(5);
+  batches.finish();
+  int num_entries = 0;
+  EXPECT_EQ(0, batches.pop_done(&num_entries));
+  EXPECT_EQ(5, num_entries);
+  EXPECT_EQ(0u, batches.size());
+}
+
+TEST(GCQueueBatches, WaitsForScheduling)
+{
+  // ios done before the whole run was sent don't make it removable
+  RGWGCQueueBatches batches;
+  batches.start(3);
+  Batch *b = batches.io_started();
+  ASSERT_NE(nullptr, b);
+  batches.io_done(b, 0);
+  int num_entries = 0;
+  EXPECT_EQ(0, batches.pop_done(&num_entries));
+  EXPECT_EQ(0, num_entries);
+
+  batches.finish();
+  EXPECT_EQ(0, batches.pop_done(&num_entries));
+  EXPECT_EQ(3, num_entries);
+}
+
+TEST(GCQueueBatches, TrimsLeadingRuns)
+{
+  RGWGCQueueBatches batches;
+  batches.start(2);
+  Batch *first = batches.io_started();
+  batches.finish();
+  batches.start(4);
+  Batch *second = batches.io_started();
+  Batch *second2 = batches.io_started();
+  batches.finish();
+  batches.start(8);
+  Batch *third = batches.io_started();
+  batches.finish();
+  ASSERT_EQ(second, second2);
+
+  // the later runs complete first, but only the head can be removed
+  batches.io_done(third, 0);
+  batches.io_done(second, 0);
+  int num_entries = 0;
+  EXPECT_EQ(0, batches.pop_done(&num_entries));
+  EXPECT_EQ(0, num_entries);
+  EXPECT_EQ(3u, batches.size());
+
+  batches.io_done(first, 0);
+  EXPECT_EQ(0, batches.pop_done(&num_entries));
+  EXPECT_EQ(2, num_entries);
+  EXPECT_EQ(2u, batches.size());
+
+  // the pointers handed out stay valid as runs are popped
+  batches.io_done(second2, 0);
+  EXPECT_EQ(0, batches.pop_done(&num_entries));
+  EXPECT_EQ(12, num_entries);
+  EXPECT_EQ(0u, batches.size());
+}
+
+TEST(GCQueueBatches, PartialFailure)
+{
+  RGWGCQueueBatches batches;
+  batches.start(2);
+  Batch *ok = batches.io_started();
+  batches.finish();
+  batches.start(3);
+  Batch *failed = batches.io_started();
+  Batch *failed2 = batches.io_started();
+  batches.finish();
+  batches.start(4);
+  Batch *after = batches.io_started();
+  batches.finish();
+
+  batches.io_done(ok, 0);
+  batches.io_done(failed, -EIO);
+  batches.io_done(failed2, -ETIMEDOUT);
+  batches.io_done(after, 0);
+
+  // the runs ahead of the failure are still trimmed, and the first error
+  // of the failed run is reported
+  int num_entries = 0;
+  EXPECT_EQ(-EIO, batches.pop_done(&num_entries));
+  EXPECT_EQ(2, num_entries);
+
+  // the failed run and the one after it stay, since their entries can't
+  // be removed from the head of the queue
+  EXPECT_EQ(2u, batches.size());
+  EXPECT_EQ(-EIO, batches.pop_done(&num_entries));
+  EXPECT_EQ(0, num_entries);
+
+  batches.clear();
+  EXPECT_EQ(0u, batches.size());
+  EXPECT_EQ(nullptr, batches.io_started());
+}
+
+TEST(GCQueueBatches, FailureWaitsForPending)
+{
+  // a failed run isn't reported until its other ios are done
+  RGWGCQueueBatches batches;
+  batches.start(3);
+  Batch *b = batches.io_started();
+  Batch *b2 = batches.io_started();
+  batches.finish();
+
+  batches.io_done(b, -EIO);
+  int num_entries = 0;
+  EXPECT_EQ(0, batches.pop_done(&num_entries));
+  EXPECT_EQ(0, num_entries);
+
+  batches.io_done(b2, 0);
+  EXPECT_EQ(-EIO, batches.pop_done(&num_entries));
+  EXPECT_EQ(0, num_entries);
+}
@@ -13,6 +13,7 @@
  */
 
 #include "rgw/rgw_putobj.h"
+#include "rgw/rgw_putobj_pipeline.h"
 #include <gtest/gtest.h>
 
 inline bufferlist string_buf(const char* buf) {
@@ -194,3 +195,54 @@ TEST(PutObj_Stripe, SkipFirstChunk)
   ASSERT_EQ(4u, mock.ops.size());
   EXPECT_EQ(Op({"", 4}), mock.ops[3]); // flush
 }
+
+static std::string md5_hex(ceph::crypto::MD5& hash)
+{
+  unsigned char m[CEPH_CRYPTO_MD5_DIGESTSIZE];
+  char hex[CEPH_CRYPTO_MD5_DIGESTSIZE * 2 + 1];
+  hash.Final(m);
+  buf_to_hex(m, CEPH_CRYPTO_MD5_DIGESTSIZE, hex);
+  return hex;
+}
+
+TEST(PutObj_Pipeline, Filter)
+{
+  boost::asio::thread_pool pool(2);
+  MockProcessor mock;
+  ceph::crypto::MD5 hash;
+  rgw::putobj::PipelineProcessor pipeline(pool, 16, null_yield, &hash, &mock);
+  rgw::putobj::ChunkProcessor chunk(pipeline.get_sink(), 4);
+  pipeline.set_filter(&chunk);
+
+  ASSERT_EQ(0, pipeline.process(string_buf("22"), 0));
+  ASSERT_EQ(0, pipeline.process(string_buf("4444"), 2));
+  ASSERT_EQ(0, pipeline.process({}, 6)); // flush
+  ASSERT_EQ(3u, mock.ops.size());
+  EXPECT_EQ(Op({"2244", 0}), mock.ops[0]);
+  EXPECT_EQ(Op({"44", 4}), mock.ops[1]);
+  EXPECT_EQ(Op({"", 6}), mock.ops[2]);
+
+  ceph::crypto::MD5 expected;
+  expected.Update((const unsigned char*)"224444", 6);
+  EXPECT_EQ(md5_hex(expected), md5_hex(hash));
+}
+
+TEST(PutObj_Pipeline, HashOnly)
+{
+  boost::asio::thread_pool pool(2);
+  MockProcessor mock;
+  ceph::crypto::MD5 hash;
+  rgw::putobj::PipelineProcessor pipeline(pool, 16, null_yield, &hash, &mock);
+
+  ASSERT_EQ(0, pipeline.process(string_buf("22"), 0));
+  ASSERT_EQ(1u, mock.ops.size()); // passed on before it's hashed
+  EXPECT_EQ(Op({"22", 0}), mock.ops[0]);
+  ASSERT_EQ(0, pipeline.process(string_buf("4444"), 2));
+  ASSERT_EQ(0, pipeline.process({}, 6)); // flush
+  ASSERT_EQ(3u, mock.ops.size());
+  EXPECT_EQ(Op({"", 6}), mock.ops[2]);
+
+  ceph::crypto::MD5 expected;
+  expected.Update((const unsigned char*)"224444", 6);
+  EXPECT_EQ(md5_hex(expected), md5_hex(hash));
+}
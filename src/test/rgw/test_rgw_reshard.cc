@@ -66,3 +66,103 @@ TEST(TestRGWReshard, dynamic_reshard_shard_count)
   ASSERT_EQ(499u, RGWBucketReshard::get_preferred_shards(2000, 500));
   ASSERT_EQ(499u, RGWBucketReshard::get_preferred_shards(2001, 500));
 }
+
+// a shard's bilog: entries with ids "00000", "00001", ... listed after a
+// marker the way cls_rgw_bi_log_list does
+struct FakeBILog {
+  std::vector<std::string> ids;
+  int lists = 0;
+
+  void append(int n) {
+    for (int i = 0; i < n; ++i) {
+      char buf[16];
+      snprintf(buf, sizeof(buf), "%05d", (int)ids.size());
+      ids.push_back(buf);
+    }
+  }
+
+  int list(const std::string& marker, int max,
+	   std::list<rgw_bi_log_entry>& entries, bool *truncated) {
+    ++lists;
+    auto i = std::upper_bound(ids.begin(), ids.end(), marker);
+    for (; i != ids.end() && (int)entries.size() < max; ++i) {
+      rgw_bi_log_entry e;
+      e.id = *i;
+      e.object = "obj" + *i;
+      entries.push_back(e);
+    }
+    *truncated = (i != ids.end());
+    return 0;
+  }
+};
+
+TEST(TestRGWReshard, replay_log_shard_pages)
+{
+  FakeBILog log;
+  log.append(25);
+
+  std::string marker;
+  std::vector<std::string> replayed;
+  auto list_page = [&] (const std::string& m, int max,
+			std::list<rgw_bi_log_entry>& entries, bool *truncated) {
+    return log.list(m, max, entries, truncated);
+  };
+  auto replay = [&] (const std::list<rgw_bi_log_entry>& entries) {
+    for (const auto& e : entries) {
+      replayed.push_back(e.id);
+    }
+    return 0;
+  };
+
+  // three pages, each entry replayed once, marker at the last entry
+  uint64_t num = 0;
+  ASSERT_EQ(0, RGWBucketReshard::replay_log_shard(marker, 10, &num,
+						   list_page, replay));
+  EXPECT_EQ(25u, num);
+  EXPECT_EQ(log.ids, replayed);
+  EXPECT_EQ("00024", marker);
+  EXPECT_EQ(3, log.lists);
+
+  // a later pass only sees what was logged since
+  log.append(12);
+  replayed.clear();
+  num = 0;
+  ASSERT_EQ(0, RGWBucketReshard::replay_log_shard(marker, 10, &num,
+						   list_page, replay));
+  EXPECT_EQ(12u, num);
+  ASSERT_EQ(12u, replayed.size());
+  EXPECT_EQ("00025", replayed.front());
+  EXPECT_EQ("00036", marker);
+
+  // and nothing once caught up
+  replayed.clear();
+  num = 0;
+  ASSERT_EQ(0, RGWBucketReshard::replay_log_shard(marker, 10, &num,
+						   list_page, replay));
+  EXPECT_EQ(0u, num);
+  EXPECT_TRUE(replayed.empty());
+  EXPECT_EQ("00036", marker);
+}
+
+TEST(TestRGWReshard, replay_log_shard_error)
+{
+  FakeBILog log;
+  log.append(25);
+
+  std::string marker;
+  int pages = 0;
+  auto list_page = [&] (const std::string& m, int max,
+			std::list<rgw_bi_log_entry>& entries, bool *truncated) {
+    return log.list(m, max, entries, truncated);
+  };
+  auto replay = [&] (const std::list<rgw_bi_log_entry>& entries) {
+    return ++pages == 2 ? -EIO : 0;
+  };
+
+  // a failed page leaves the marker after the last page that applied
+  uint64_t num = 0;
+  ASSERT_EQ(-EIO, RGWBucketReshard::replay_log_shard(marker, 10, &num,
+						      list_page, replay));
+  EXPECT_EQ(10u, num);
+  EXPECT_EQ("00009", marker);
+}
@@ -25,6 +25,7 @@
 
 #include "global/global_init.h"
 #include "osd/OSDMap.h"
+#include "osd/OSDMapMapping.h"
 
 
 void usage()
@@ -467,6 +468,18 @@ int main(int argc, const char **argv)
       cout << "No pools available" << std::endl;
       goto skip_upmap;
     }
+    // evaluate upmap candidates in parallel, see osd_calc_pg_upmaps_threads
+    auto upmap_threads =
+      g_conf().get_val<uint64_t>("osd_calc_pg_upmaps_threads");
+    std::unique_ptr<ThreadPool> upmap_tp;
+    std::unique_ptr<ParallelPGMapper> upmap_mapper;
+    if (upmap_threads > 1) {
+      upmap_tp = std::make_unique<ThreadPool>(
+        g_ceph_context, "osdmaptool::upmap_tp", "upmap_tp", upmap_threads);
+      upmap_tp->start();
+      upmap_mapper = std::make_unique<ParallelPGMapper>(g_ceph_context,
+                                                        upmap_tp.get());
+    }
     int rounds = 0;
     struct timespec round_start;
     [[maybe_unused]] int r = clock_gettime(CLOCK_MONOTONIC, &round_start);
@@ -491,7 +504,7 @@ int main(int argc, const char **argv)
         int did = osdmap.calc_pg_upmaps(
           g_ceph_context, upmap_deviation,
           left, one_pool,
-          &pending_inc);
+          &pending_inc, upmap_mapper.get());
         total_did += did;
         left -= did;
         if (left <= 0)
@@ -540,6 +553,9 @@ int main(int argc, const char **argv)
       }
       ++rounds;
     } while(upmap_active);
+    if (upmap_tp) {
+      upmap_tp->stop();
+    }
   }
 skip_upmap:
   if (upmap_file != "-") {